@@ -0,0 +1,77 @@
+
+// Compares the bandwidth of a threaded per-patch stream triad (the access
+// pattern of the field solver / moment loops) between field storage that was
+// zeroed by the main thread, as std::vector<float>(n) does, and storage that
+// was first-touched patch by patch on the owning threads.
+//
+// On a multi-socket node, run with one rank per node and as many threads as
+// cores, e.g.
+//   OMP_NUM_THREADS=32 OMP_PROC_BIND=true ./bench_first_touch 256 64
+// (256 patches of 64^3 cells)
+
+#include "PatchAffinity.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using Storage = std::vector<float, psc::numa::NoInitAllocator<float>>;
+
+static double triad(Storage& a, const Storage& b, const Storage& c,
+                    size_t stride, int n_patches, int n_reps)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < n_reps; r++) {
+#pragma omp parallel for
+    for (int p = 0; p < n_patches; p++) {
+      float* pa = &a[p * stride];
+      const float* pb = &b[p * stride];
+      const float* pc = &c[p * stride];
+      for (size_t i = 0; i < stride; i++) {
+        pa[i] = pb[i] + .5f * pc[i];
+      }
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double secs = std::chrono::duration<double>(t1 - t0).count();
+  return 3. * sizeof(float) * stride * n_patches * n_reps / secs / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+  int n_patches = argc > 1 ? atoi(argv[1]) : 64;
+  int n_cells = argc > 2 ? atoi(argv[2]) : 32;
+  int n_reps = argc > 3 ? atoi(argv[3]) : 10;
+  size_t stride = size_t(n_cells) * n_cells * n_cells;
+  size_t size = stride * n_patches;
+
+  psc::numa::pinThreads();
+  printf("%d threads, %d patches of %d^3 cells, %.1f MB per array\n",
+         psc::numa::nThreads(), n_patches, n_cells,
+         size * sizeof(float) / 1e6);
+
+  {
+    // zeroed by the main thread
+    Storage a(size), b(size), c(size);
+    for (auto* s : {&a, &b, &c}) {
+      std::fill(s->begin(), s->end(), 0.f);
+    }
+    triad(a, b, c, stride, n_patches, 1); // warm up
+    printf("main thread touch:  %8.2f GB/s\n",
+           triad(a, b, c, stride, n_patches, n_reps));
+  }
+
+  {
+    // first touched by the owner threads
+    Storage a(size), b(size), c(size);
+    for (auto* s : {&a, &b, &c}) {
+      psc::numa::firstTouch(s->data(), stride, n_patches);
+    }
+    triad(a, b, c, stride, n_patches, 1);
+    printf("owner thread touch: %8.2f GB/s\n",
+           triad(a, b, c, stride, n_patches, n_reps));
+  }
+
+  return 0;
+}
@@ -0,0 +1,409 @@
+
+// Micro-benchmarks for the PSC hot kernels
+//
+// Each benchmark is run on a domain of 2 patches per non-invariant
+// direction, with the patch size (cells per direction) and the number of
+// particles per cell as arguments, e.g.
+//   ./psc_bench --benchmark_filter='BM_PushParticles.*xyz'
+//
+// Particle kernels report particles/s ("items_per_second"), field kernels
+// cells/s, and both report the bytes of particle / field data moved per
+// second (counting each particle / field value as read and written once).
+//
+// Kernels that change the particles' positions (push, bnd exchange, sort)
+// are timed manually, so that the state can be put back in order (bnd
+// exchange, sort) between iterations without that being counted.
+
+#include <benchmark/benchmark.h>
+
+#include "psc_config.hxx"
+#include "setup_fields.hxx"
+
+#include <chrono>
+#include <memory>
+#include <random>
+
+// ======================================================================
+// variants of the 1vbec pusher, to compare against the default one
+
+template <typename Dim>
+struct PscConfig1vbecSingleAccumulate : PscConfig1vbecSingle<Dim>
+{
+  using PushParticles = PushParticlesVb<
+    Config1vbecSplitAccumulate<MparticlesSingle, MfieldsStateSingle, Dim>>;
+};
+
+// ======================================================================
+// BenchSetup
+//
+// a grid with fields set to something non-trivial, and particles loaded
+// uniformly with a small thermal spread, sorted by cell
+
+template <typename Config>
+struct BenchSetup
+{
+  using Dim = typename Config::Dim;
+  using Mparticles = typename Config::Mparticles;
+  using MfieldsState = typename Config::MfieldsState;
+  using Particle = typename Mparticles::Particle;
+
+  BenchSetup(int n_cells, int n_ppc)
+  {
+    Int3 ldims = {n_cells, n_cells, n_cells};
+    Int3 np = {2, 2, 2};
+    Int3 ibn = {2, 2, 2};
+    if (Dim::InvarX::value) { ldims[0] = 1; np[0] = 1; ibn[0] = 0; }
+    if (Dim::InvarY::value) { ldims[1] = 1; np[1] = 1; ibn[1] = 0; }
+    if (Dim::InvarZ::value) { ldims[2] = 1; np[2] = 1; ibn[2] = 0; }
+    Int3 gdims = ldims * np;
+
+    auto domain = Grid_t::Domain{gdims, Vec3<double>(gdims), {}, np};
+    auto bc = psc::grid::BC{{BND_FLD_PERIODIC, BND_FLD_PERIODIC, BND_FLD_PERIODIC},
+                            {BND_FLD_PERIODIC, BND_FLD_PERIODIC, BND_FLD_PERIODIC},
+                            {BND_PRT_PERIODIC, BND_PRT_PERIODIC, BND_PRT_PERIODIC},
+                            {BND_PRT_PERIODIC, BND_PRT_PERIODIC, BND_PRT_PERIODIC}};
+    auto kinds = Grid_t::Kinds{{-1., 1., "e"}, {1., 100., "i"}};
+    auto norm_params = Grid_t::NormalizationParams::dimensionless();
+    norm_params.nicell = std::max(n_ppc, 1);
+    double dt = .5;
+    grid_.reset(new Grid_t{domain, bc, kinds, Grid_t::Normalization{norm_params},
+                           dt, -1, ibn});
+
+    mflds_.reset(new MfieldsState{grid()});
+    setupFields(*mflds_, [](int m, double crd[3]) {
+      switch (m) {
+        case EX: return .01 * sin(.1 * crd[1]);
+        case EY: return .01 * cos(.1 * crd[2]);
+        case HX: return .1;
+        case HZ: return .01 * sin(.1 * crd[0]);
+        default: return 0.;
+      }
+    });
+
+    mprts_.reset(new Mparticles{grid()});
+    std::mt19937 gen{42};
+    std::uniform_real_distribution<double> uniform{0., 1.};
+    std::normal_distribution<double> thermal{0., .1};
+    auto inj = mprts_->injector();
+    for (int p = 0; p < grid().n_patches(); p++) {
+      auto injector = inj[p];
+      auto& patch = grid().patches[p];
+      grid().Foreach_3d(0, 0, [&](int i, int j, int k) {
+        Int3 idx = {i, j, k};
+        for (int n = 0; n < n_ppc; n++) {
+          Double3 x, u;
+          for (int d = 0; d < 3; d++) {
+            x[d] = patch.xb[d] + (idx[d] + uniform(gen)) * grid().domain.dx[d];
+            u[d] = thermal(gen);
+          }
+          injector({x, u, 1., n % 2});
+        }
+      });
+    }
+    sort_(*mprts_);
+  }
+
+  const Grid_t& grid() const { return *grid_; }
+  MfieldsState& mflds() { return *mflds_; }
+  Mparticles& mprts() { return *mprts_; }
+
+  void advanceTimestep() { grid_->timestep_++; }
+
+  int n_prts() const { return mprts_->size(); }
+  int n_cells() const { return grid().n_patches() * grid().ldims[0] * grid().ldims[1] * grid().ldims[2]; }
+  int64_t prtBytes() const { return 2 * int64_t(sizeof(Particle)) * n_prts(); }
+
+private:
+  std::unique_ptr<Grid_t> grid_;
+  std::unique_ptr<MfieldsState> mflds_;
+  std::unique_ptr<Mparticles> mprts_;
+  typename Config::Sort sort_;
+};
+
+template <typename F>
+static double timeIt(F&& f)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  f();
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(t1 - t0).count();
+}
+
+template <typename Setup>
+static void setParticleCounters(benchmark::State& state, const Setup& setup)
+{
+  state.SetItemsProcessed(state.iterations() * setup.n_prts());
+  state.SetBytesProcessed(state.iterations() * setup.prtBytes());
+}
+
+// n_values is the number of field values read or written per cell
+
+template <typename Setup>
+static void setFieldCounters(benchmark::State& state, int64_t n_cells,
+                             int n_values)
+{
+  using Real = typename Setup::MfieldsState::real_t;
+  state.SetItemsProcessed(state.iterations() * n_cells);
+  state.SetBytesProcessed(state.iterations() * int64_t(sizeof(Real)) *
+                          n_values * n_cells);
+}
+
+// ======================================================================
+// particle kernels
+
+template <typename Config>
+static void BM_PushParticles(benchmark::State& state)
+{
+  BenchSetup<Config> setup(state.range(0), state.range(1));
+  typename Config::PushParticles pushp;
+  typename Config::BndParticles bndp{setup.grid()};
+  typename Config::Sort sort;
+
+  for (auto _ : state) {
+    state.SetIterationTime(timeIt([&]() { pushp.push_mprts(setup.mprts(), setup.mflds()); }));
+    bndp(setup.mprts());
+    sort(setup.mprts());
+  }
+  setParticleCounters(state, setup);
+}
+
+// the ions (half of the particles) subcycled by a factor given as third
+// argument, timed as the average over a whole cycle of steps
+
+template <typename Config>
+static void BM_PushParticlesSubcycle(benchmark::State& state)
+{
+  BenchSetup<Config> setup(state.range(0), state.range(1));
+  int n_sub = state.range(2);
+  typename Config::PushParticles pushp;
+  pushp.set_subcycle({1, n_sub});
+  typename Config::BndParticles bndp{setup.grid()};
+  typename Config::Sort sort;
+
+  for (auto _ : state) {
+    double t = 0.;
+    for (int n = 0; n < n_sub; n++) {
+      t += timeIt([&]() { pushp.push_mprts(setup.mprts(), setup.mflds()); });
+      bndp(setup.mprts());
+      sort(setup.mprts());
+      setup.advanceTimestep();
+    }
+    state.SetIterationTime(t / n_sub);
+  }
+  setParticleCounters(state, setup);
+}
+
+template <typename Config>
+static void BM_Sort(benchmark::State& state)
+{
+  BenchSetup<Config> setup(state.range(0), state.range(1));
+  typename Config::PushParticles pushp;
+  typename Config::BndParticles bndp{setup.grid()};
+  typename Config::Sort sort;
+
+  for (auto _ : state) {
+    pushp.push_mprts(setup.mprts(), setup.mflds());
+    bndp(setup.mprts());
+    state.SetIterationTime(timeIt([&]() { sort(setup.mprts()); }));
+  }
+  setParticleCounters(state, setup);
+}
+
+template <typename Config>
+static void BM_BndParticles(benchmark::State& state)
+{
+  BenchSetup<Config> setup(state.range(0), state.range(1));
+  typename Config::PushParticles pushp;
+  typename Config::BndParticles bndp{setup.grid()};
+  typename Config::Sort sort;
+
+  for (auto _ : state) {
+    pushp.push_mprts(setup.mprts(), setup.mflds());
+    state.SetIterationTime(timeIt([&]() { bndp(setup.mprts()); }));
+    sort(setup.mprts());
+  }
+  setParticleCounters(state, setup);
+}
+
+template <typename Config>
+static void BM_Collision(benchmark::State& state)
+{
+  BenchSetup<Config> setup(state.range(0), state.range(1));
+  typename Config::Collision collision{setup.grid(), 1, .1};
+
+  for (auto _ : state) {
+    collision(setup.mprts());
+  }
+  setParticleCounters(state, setup);
+}
+
+template <typename Config>
+static void BM_Moment_n(benchmark::State& state)
+{
+  using Moment = Moment_n_1st<typename Config::Mparticles, typename Config::Mfields>;
+  BenchSetup<Config> setup(state.range(0), state.range(1));
+
+  for (auto _ : state) {
+    Moment moment{setup.mprts()};
+    benchmark::DoNotOptimize(moment);
+  }
+  state.SetItemsProcessed(state.iterations() * setup.n_prts());
+  state.SetBytesProcessed(state.iterations() * setup.prtBytes() / 2);
+}
+
+// ======================================================================
+// field kernels
+
+template <typename Config>
+static void BM_PushE(benchmark::State& state)
+{
+  BenchSetup<Config> setup(state.range(0), 0);
+  typename Config::PushFields pushf;
+
+  for (auto _ : state) {
+    pushf.push_E(setup.mflds(), .5, typename Config::Dim{});
+  }
+  // reads E, H, J, writes E
+  setFieldCounters<decltype(setup)>(state, setup.n_cells(), 12);
+}
+
+template <typename Config>
+static void BM_PushH(benchmark::State& state)
+{
+  BenchSetup<Config> setup(state.range(0), 0);
+  typename Config::PushFields pushf;
+
+  for (auto _ : state) {
+    pushf.push_H(setup.mflds(), .5, typename Config::Dim{});
+  }
+  // reads E, H, writes H
+  setFieldCounters<decltype(setup)>(state, setup.n_cells(), 9);
+}
+
+template <typename Config>
+static void BM_FillGhosts(benchmark::State& state)
+{
+  BenchSetup<Config> setup(state.range(0), 0);
+  typename Config::Bnd bnd{setup.grid(), setup.grid().ibn};
+
+  for (auto _ : state) {
+    bnd.fill_ghosts(setup.mflds(), EX, HX + 3);
+  }
+  // copies E, H into the ghost cells
+  auto& grid = setup.grid();
+  Int3 im = grid.ldims + 2 * grid.ibn;
+  int64_t n_ghosts = grid.n_patches() * (int64_t(im[0]) * im[1] * im[2] - setup.n_cells() / grid.n_patches());
+  setFieldCounters<decltype(setup)>(state, n_ghosts, 2 * 6);
+}
+
+// ======================================================================
+// registration
+
+static void particleArgs(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"cells", "ppc"});
+  for (int n_cells : {16, 32}) {
+    for (int n_ppc : {16, 64}) {
+      b->Args({n_cells, n_ppc});
+    }
+  }
+}
+
+static void particleArgs3d(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"cells", "ppc"});
+  for (int n_cells : {8, 16}) {
+    for (int n_ppc : {16, 64}) {
+      b->Args({n_cells, n_ppc});
+    }
+  }
+}
+
+static void subcycleArgs(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"cells", "ppc", "subcycle"});
+  for (int n_sub : {1, 2, 4, 8}) {
+    b->Args({32, 64, n_sub});
+  }
+}
+
+static void subcycleArgs3d(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"cells", "ppc", "subcycle"});
+  for (int n_sub : {1, 2, 4, 8}) {
+    b->Args({16, 16, n_sub});
+  }
+}
+
+static void fieldArgs(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"cells"});
+  for (int n_cells : {32, 128}) {
+    b->Args({n_cells});
+  }
+}
+
+static void fieldArgs3d(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"cells"});
+  for (int n_cells : {16, 32}) {
+    b->Args({n_cells});
+  }
+}
+
+#define PSC_BENCH_PRTS(BM, CONFIG, ARGS)                                       \
+  BENCHMARK_TEMPLATE(BM, CONFIG)->Apply(ARGS)->UseManualTime()->Unit(benchmark::kMillisecond)
+
+#define PSC_BENCH(BM, CONFIG, ARGS)                                            \
+  BENCHMARK_TEMPLATE(BM, CONFIG)->Apply(ARGS)->Unit(benchmark::kMillisecond)
+
+PSC_BENCH_PRTS(BM_PushParticles, PscConfig1vbecSingle<dim_yz>, particleArgs);
+PSC_BENCH_PRTS(BM_PushParticles, PscConfig1vbecSingle<dim_xz>, particleArgs);
+PSC_BENCH_PRTS(BM_PushParticles, PscConfig1vbecSingle<dim_xyz>, particleArgs3d);
+PSC_BENCH_PRTS(BM_PushParticles, PscConfig1vbecSingleAccumulate<dim_yz>, particleArgs);
+PSC_BENCH_PRTS(BM_PushParticles, PscConfig1vbecSingleAccumulate<dim_xyz>, particleArgs3d);
+PSC_BENCH_PRTS(BM_PushParticles, PscConfig2ndDouble<dim_yz>, particleArgs);
+PSC_BENCH_PRTS(BM_PushParticlesSubcycle, PscConfig1vbecSingle<dim_yz>, subcycleArgs);
+PSC_BENCH_PRTS(BM_PushParticlesSubcycle, PscConfig1vbecSingle<dim_xyz>, subcycleArgs3d);
+
+PSC_BENCH_PRTS(BM_Sort, PscConfig1vbecSingle<dim_yz>, particleArgs);
+PSC_BENCH_PRTS(BM_Sort, PscConfig1vbecSingle<dim_xyz>, particleArgs3d);
+PSC_BENCH_PRTS(BM_Sort, PscConfig2ndDouble<dim_yz>, particleArgs);
+
+PSC_BENCH_PRTS(BM_BndParticles, PscConfig1vbecSingle<dim_yz>, particleArgs);
+PSC_BENCH_PRTS(BM_BndParticles, PscConfig1vbecSingle<dim_xyz>, particleArgs3d);
+PSC_BENCH_PRTS(BM_BndParticles, PscConfig2ndDouble<dim_yz>, particleArgs);
+
+PSC_BENCH(BM_Collision, PscConfig1vbecSingle<dim_yz>, particleArgs);
+PSC_BENCH(BM_Collision, PscConfig2ndDouble<dim_yz>, particleArgs);
+
+PSC_BENCH(BM_Moment_n, PscConfig1vbecSingle<dim_yz>, particleArgs);
+PSC_BENCH(BM_Moment_n, PscConfig1vbecSingle<dim_xyz>, particleArgs3d);
+
+PSC_BENCH(BM_PushE, PscConfig1vbecSingle<dim_yz>, fieldArgs);
+PSC_BENCH(BM_PushE, PscConfig1vbecSingle<dim_xyz>, fieldArgs3d);
+PSC_BENCH(BM_PushE, PscConfig2ndDouble<dim_yz>, fieldArgs);
+PSC_BENCH(BM_PushH, PscConfig1vbecSingle<dim_yz>, fieldArgs);
+PSC_BENCH(BM_PushH, PscConfig1vbecSingle<dim_xyz>, fieldArgs3d);
+PSC_BENCH(BM_PushH, PscConfig2ndDouble<dim_yz>, fieldArgs);
+
+PSC_BENCH(BM_FillGhosts, PscConfig1vbecSingle<dim_yz>, fieldArgs);
+PSC_BENCH(BM_FillGhosts, PscConfig1vbecSingle<dim_xyz>, fieldArgs3d);
+
+// ======================================================================
+// main
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  pr_time_step_no_comm = prof_register("time step w/o comm", 1., 0, 0);
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,129 @@
+
+#pragma once
+
+#include <mpi.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// ======================================================================
+// AsyncWriter
+//
+// Runs output jobs on a background thread, so that the simulation can keep
+// advancing while data that has already been staged (copied into buffers
+// owned by the job) is written out.
+//
+// At most one job is in flight: submitting a new job first waits for the
+// previous one to finish, so memory use is bounded by a single staged output,
+// and jobs never run concurrently with each other.
+//
+// The main thread isn't stopped while a job runs, so anything a job shares
+// with it has to be thread-safe: jobs that use HDF5 should only be run in the
+// background if H5is_library_threadsafe() says so, and jobs that do MPI
+// communication need MPI_THREAD_MULTIPLE (see isThreadMultiple()) and must
+// use their own communicator.
+
+class AsyncWriter
+{
+public:
+  AsyncWriter() = default;
+  AsyncWriter(const AsyncWriter&) = delete;
+  AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+  ~AsyncWriter()
+  {
+    wait();
+    if (thread_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        done_ = true;
+      }
+      cv_.notify_all();
+      thread_.join();
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // submit
+  //
+  // runs job in the background if async, otherwise right away (but still
+  // only after any previous job has finished)
+
+  void submit(std::function<void()> job, bool async)
+  {
+    wait();
+    if (!async) {
+      job();
+      return;
+    }
+
+    if (!thread_.joinable()) {
+      thread_ = std::thread{[this]() { run(); }};
+    }
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      job_ = std::move(job);
+      busy_ = true;
+    }
+    cv_.notify_all();
+  }
+
+  // ----------------------------------------------------------------------
+  // wait
+  //
+  // blocks until the job in flight, if any, has finished
+
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock{mutex_};
+    cv_.wait(lock, [this]() { return !busy_; });
+  }
+
+  // ----------------------------------------------------------------------
+  // isThreadMultiple
+
+  static bool isThreadMultiple()
+  {
+    int provided;
+    MPI_Query_thread(&provided);
+    return provided == MPI_THREAD_MULTIPLE;
+  }
+
+private:
+  void run()
+  {
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (true) {
+      cv_.wait(lock, [this]() { return busy_ || done_; });
+      if (!busy_) { // done_
+        return;
+      }
+      lock.unlock();
+      job_();
+      lock.lock();
+      job_ = nullptr;
+      busy_ = false;
+      cv_.notify_all();
+    }
+  }
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::function<void()> job_;
+  bool busy_ = false;
+  bool done_ = false;
+};
+
+// ----------------------------------------------------------------------
+// asyncWriter
+//
+// the writer shared by all output, so that their jobs are serialized
+
+inline AsyncWriter& asyncWriter()
+{
+  static AsyncWriter writer;
+  return writer;
+}
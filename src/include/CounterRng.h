@@ -0,0 +1,63 @@
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace psc
+{
+namespace rng
+{
+
+// ======================================================================
+// Philox4x32
+//
+// Counter-based random number generator (Philox4x32-10, Salmon et al.,
+// SC'11). Each (key, counter) pair maps to four independent 32-bit random
+// numbers, so a stream can be addressed directly by e.g. a global cell index
+// rather than being advanced serially. That makes results independent of
+// the order in which (and the thread / rank on which) they're drawn.
+
+class Philox4x32
+{
+public:
+  using Counter = std::array<uint32_t, 4>;
+  using Key = std::array<uint32_t, 2>;
+
+  explicit Philox4x32(uint64_t key) : key_{uint32_t(key), uint32_t(key >> 32)}
+  {}
+
+  Counter operator()(Counter ctr) const
+  {
+    Key key = key_;
+    for (int r = 0; r < 10; r++) {
+      ctr = round(ctr, key);
+      key[0] += W0;
+      key[1] += W1;
+    }
+    return ctr;
+  }
+
+  // maps a 32-bit random number to a uniform double in the open interval
+  // (0, 1), so that it's safe to take the log of
+  static double uniform(uint32_t r) { return (r + .5) * (1. / 4294967296.); }
+
+private:
+  static Counter round(const Counter& ctr, const Key& key)
+  {
+    uint64_t prod0 = uint64_t(M0) * ctr[0];
+    uint64_t prod1 = uint64_t(M1) * ctr[2];
+    return {uint32_t(prod1 >> 32) ^ ctr[1] ^ key[0], uint32_t(prod1),
+            uint32_t(prod0 >> 32) ^ ctr[3] ^ key[1], uint32_t(prod0)};
+  }
+
+  static const uint32_t M0 = 0xD2511F53;
+  static const uint32_t M1 = 0xCD9E8D57;
+  static const uint32_t W0 = 0x9E3779B9;
+  static const uint32_t W1 = 0xBB67AE85;
+
+  Key key_;
+};
+
+} // namespace rng
+} // namespace psc
@@ -0,0 +1,310 @@
+
+#pragma once
+
+#include "grid.hxx"
+
+#include <hdf5.h>
+#include <hdf5_hl.h>
+#include <mpi.h>
+#include <mrc_profile.h>
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// ======================================================================
+// DiagDistributionAxis
+//
+// One dimension of a DiagDistribution histogram: the quantity that is
+// binned, in n_bins equal bins between lo and hi (equal in log(quantity) if
+// log is set, e.g., for energy spectra). Particles outside of lo..hi aren't
+// counted. Positions are global, and PITCH is the cosine of the angle
+// between u and DiagDistributionParams::pitch_dir. For KIND, there's one
+// bin per kind, and n_bins / lo / hi are ignored.
+
+struct DiagDistributionAxis
+{
+  enum Quantity
+  {
+    X,
+    Y,
+    Z,
+    UX,
+    UY,
+    UZ,
+    U_ABS,
+    GAMMA_M1,
+    PITCH,
+    KIND,
+  };
+
+  Quantity quantity;
+  int n_bins = 1;
+  double lo = 0.;
+  double hi = 1.;
+  bool log = false;
+};
+
+struct DiagDistributionParams
+{
+  const char* data_dir = ".";
+  const char* basename = "dist";
+  int every_step = 0;
+  std::vector<DiagDistributionAxis> axes;
+  Double3 pitch_dir = {0., 0., 1.};
+};
+
+// ======================================================================
+// DiagDistribution
+//
+// In-situ histogram of the particles over the given axes, e.g., f(x, ux) in
+// slabs along x, or an energy spectrum per kind, as a replacement for
+// dumping all particles and binning them in post-processing. The histogram
+// holds the total particle weight in each bin (in the same units as
+// DiagEnergiesParticle), and every every_step steps gets written by rank 0
+// to <data_dir>/<basename>.<timestep>.h5, as "hist" with dimensions in the
+// order of the axes, together with each axis' bin edges.
+
+class DiagDistribution
+{
+public:
+  DiagDistribution(const Grid_t& grid, MPI_Comm comm,
+                   const DiagDistributionParams& prm)
+    : prm_{prm}, comm_{comm}
+  {
+    MPI_Comm_rank(comm_, &rank_);
+    for (auto& axis : prm_.axes) {
+      if (axis.quantity == DiagDistributionAxis::KIND) {
+        axis.n_bins = grid.kinds.size();
+        axis.lo = 0.;
+        axis.hi = axis.n_bins;
+        axis.log = false;
+      }
+      assert(axis.n_bins > 0);
+      assert(axis.hi > axis.lo);
+      assert(!axis.log || axis.lo > 0.);
+    }
+    double len = std::sqrt(sqr(prm_.pitch_dir[0]) + sqr(prm_.pitch_dir[1]) +
+                           sqr(prm_.pitch_dir[2]));
+    assert(len > 0.);
+    for (int d = 0; d < 3; d++) {
+      prm_.pitch_dir[d] /= len;
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // operator()
+
+  template <typename Mparticles>
+  void operator()(Mparticles& mprts)
+  {
+    const auto& grid = mprts.grid();
+    if (prm_.every_step <= 0 || grid.timestep() % prm_.every_step != 0) {
+      return;
+    }
+
+    static int pr;
+    if (!pr) {
+      pr = prof_register("diag_distribution", 1., 0, 0);
+    }
+    prof_start(pr);
+
+    auto hist = histogram(mprts);
+    if (rank_ == 0) {
+      MPI_Reduce(MPI_IN_PLACE, hist.data(), hist.size(), MPI_DOUBLE, MPI_SUM,
+                 0, comm_);
+      write(grid, hist);
+    } else {
+      MPI_Reduce(hist.data(), nullptr, hist.size(), MPI_DOUBLE, MPI_SUM, 0,
+                 comm_);
+    }
+
+    prof_stop(pr);
+  }
+
+  // ----------------------------------------------------------------------
+  // histogram
+  //
+  // this rank's part of the histogram, flattened with the last axis
+  // varying fastest. Patches are binned in parallel, each thread into its
+  // own copy of the bins, which are added up at the end.
+
+  template <typename Mparticles>
+  std::vector<double> histogram(Mparticles& mprts) const
+  {
+    const auto& grid = mprts.grid();
+    double scale = grid.norm.fnqs * grid.domain.dx[0] * grid.domain.dx[1] *
+                   grid.domain.dx[2];
+    int n_bins = size();
+    std::vector<double> hist(n_bins);
+
+    auto accessor = mprts.accessor();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+      std::vector<double> local(n_bins);
+#ifdef _OPENMP
+#pragma omp for
+#endif
+      for (int p = 0; p < mprts.n_patches(); p++) {
+        const auto& xb = grid.patches[p].xb;
+        for (auto prt : accessor[p]) {
+          int idx = binIndex(prt, xb);
+          if (idx >= 0) {
+            local[idx] += prt.w();
+          }
+        }
+      }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+      for (int i = 0; i < n_bins; i++) {
+        hist[i] += scale * local[i];
+      }
+    }
+    return hist;
+  }
+
+  // total number of bins
+  int size() const
+  {
+    int n = 1;
+    for (auto& axis : prm_.axes) {
+      n *= axis.n_bins;
+    }
+    return n;
+  }
+
+  const std::vector<DiagDistributionAxis>& axes() const { return prm_.axes; }
+
+private:
+  // ----------------------------------------------------------------------
+  // binIndex
+  //
+  // flat index of the particle's bin, or -1 if it's outside the histogram
+
+  template <typename Particle>
+  int binIndex(const Particle& prt, const Vec3<double>& xb) const
+  {
+    int idx = 0;
+    for (auto& axis : prm_.axes) {
+      int b;
+      if (axis.quantity == DiagDistributionAxis::KIND) {
+        b = prt.kind();
+      } else {
+        double val = value(prt, xb, axis.quantity);
+        double t;
+        if (axis.log) {
+          if (val <= 0.) {
+            return -1;
+          }
+          t = std::log(val / axis.lo) / std::log(axis.hi / axis.lo);
+        } else {
+          t = (val - axis.lo) / (axis.hi - axis.lo);
+        }
+        // compare before converting, so huge values don't overflow the int;
+        // the last bin includes hi, e.g., a pitch angle cosine of 1
+        if (!(t >= 0. && t <= 1.)) {
+          return -1;
+        }
+        b = std::min(int(t * axis.n_bins), axis.n_bins - 1);
+      }
+      idx = idx * axis.n_bins + b;
+    }
+    return idx;
+  }
+
+  template <typename Particle>
+  double value(const Particle& prt, const Vec3<double>& xb,
+               DiagDistributionAxis::Quantity quantity) const
+  {
+    auto u = prt.u();
+    double u2 = sqr(double(u[0])) + sqr(double(u[1])) + sqr(double(u[2]));
+    switch (quantity) {
+      case DiagDistributionAxis::X: return xb[0] + prt.x()[0];
+      case DiagDistributionAxis::Y: return xb[1] + prt.x()[1];
+      case DiagDistributionAxis::Z: return xb[2] + prt.x()[2];
+      case DiagDistributionAxis::UX: return u[0];
+      case DiagDistributionAxis::UY: return u[1];
+      case DiagDistributionAxis::UZ: return u[2];
+      case DiagDistributionAxis::U_ABS: return std::sqrt(u2);
+      case DiagDistributionAxis::GAMMA_M1:
+        // u^2 / (gamma + 1) == gamma - 1, without the cancellation
+        return u2 / (std::sqrt(1. + u2) + 1.);
+      case DiagDistributionAxis::PITCH: {
+        if (u2 == 0.) {
+          return 0.;
+        }
+        auto& b = prm_.pitch_dir;
+        return (u[0] * b[0] + u[1] * b[1] + u[2] * b[2]) / std::sqrt(u2);
+      }
+      default: assert(0);
+    }
+    return 0.;
+  }
+
+  // ----------------------------------------------------------------------
+  // write
+
+  void write(const Grid_t& grid, const std::vector<double>& hist) const
+  {
+    static const char* quantity_names[] = {
+      "x", "y", "z", "ux", "uy", "uz", "u_abs", "gamma_m1", "pitch", "kind"};
+
+    char step[20];
+    snprintf(step, sizeof(step), ".%06d.h5", grid.timestep());
+    std::string filename =
+      std::string(prm_.data_dir) + "/" + prm_.basename + step;
+    hid_t file =
+      H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    assert(file >= 0);
+
+    int n_axes = prm_.axes.size();
+    std::vector<hsize_t> dims(n_axes);
+    for (int a = 0; a < n_axes; a++) {
+      dims[a] = prm_.axes[a].n_bins;
+    }
+    herr_t ierr;
+    if (n_axes > 0) {
+      ierr = H5LTmake_dataset_double(file, "hist", n_axes, dims.data(),
+                                     hist.data());
+    } else {
+      hsize_t one = 1;
+      ierr = H5LTmake_dataset_double(file, "hist", 1, &one, hist.data());
+    }
+    assert(ierr >= 0);
+    int timestep = grid.timestep();
+    double time = grid.timestep() * grid.dt;
+    ierr = H5LTset_attribute_int(file, "hist", "timestep", &timestep, 1);
+    assert(ierr >= 0);
+    ierr = H5LTset_attribute_double(file, "hist", "time", &time, 1);
+    assert(ierr >= 0);
+
+    for (int a = 0; a < n_axes; a++) {
+      auto& axis = prm_.axes[a];
+      std::vector<double> edges(axis.n_bins + 1);
+      for (int b = 0; b <= axis.n_bins; b++) {
+        double t = double(b) / axis.n_bins;
+        edges[b] = axis.log ? axis.lo * std::pow(axis.hi / axis.lo, t)
+                            : axis.lo + t * (axis.hi - axis.lo);
+      }
+      std::string name = "axis" + std::to_string(a);
+      hsize_t n_edges = edges.size();
+      ierr = H5LTmake_dataset_double(file, name.c_str(), 1, &n_edges,
+                                     edges.data());
+      assert(ierr >= 0);
+      ierr = H5LTset_attribute_string(file, name.c_str(), "quantity",
+                                      quantity_names[axis.quantity]);
+      assert(ierr >= 0);
+    }
+
+    ierr = H5Fclose(file);
+    assert(ierr >= 0);
+  }
+
+  DiagDistributionParams prm_;
+  MPI_Comm comm_;
+  int rank_;
+};
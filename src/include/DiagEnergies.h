@@ -19,8 +19,7 @@ private:
   template <typename Item>
   static std::string legend(const Item& item);
 
-  template <typename Item, typename Mparticles, typename MfieldsState>
-  void write_one(const Item& item, Mparticles& mprts, MfieldsState& mflds);
+  void write(std::vector<double>& vals);
 
 private:
   MPI_Comm comm_;
@@ -44,8 +44,14 @@ inline void DiagEnergies::operator()(Mparticles& mprts, MfieldsState& mflds)
     fprintf(file_.get(), "%g", grid.timestep() * grid.dt);
   }
 
-  write_one(ef_, mprts, mflds);
-  write_one(ep_, mprts, mflds);
+  // all particle items are evaluated in a single sweep over the particles,
+  // and all field items in a single sweep over the cells; all the results
+  // then get reduced across ranks at once
+  auto vals = reduceCells(grid, mflds, ef_);
+  auto vals_prts = reduceParticles(mprts, ep_);
+  vals.insert(vals.end(), vals_prts.begin(), vals_prts.end());
+
+  write(vals);
 
   if (rank_ == 0) {
     fprintf(file_.get(), "\n");
@@ -67,14 +73,10 @@ inline std::string DiagEnergies::legend(const Item& item)
 }
 
 // ----------------------------------------------------------------------
-// write_one
+// write
 
-template <typename Item, typename Mparticles, typename MfieldsState>
-inline void DiagEnergies::write_one(const Item& item, Mparticles& mprts,
-                                    MfieldsState& mflds)
+inline void DiagEnergies::write(std::vector<double>& vals)
 {
-  auto vals = item(mprts, mflds);
-
   if (rank_ == 0) {
     MPI_Reduce(MPI_IN_PLACE, vals.data(), vals.size(), MPI_DOUBLE, MPI_SUM, 0,
                comm_);
@@ -4,39 +4,41 @@
 #include <string>
 #include <vector>
 
+#include "DiagReduction.h"
 #include "psc_particles_double.h"
 
 class DiagEnergiesParticle
 {
 public:
+  static const int n_vals = 2;
+
   std::vector<std::string> names() const { return {"E_electron", "E_ion"}; }
 
-  template <typename Mparticles, typename MfieldsState>
-  std::vector<double> operator()(Mparticles& mprts, MfieldsState& mflds) const
+  double scale(const Grid_t& grid) const
+  {
+    return grid.norm.fnqs * grid.domain.dx[0] * grid.domain.dx[1] *
+           grid.domain.dx[2];
+  }
+
+  template <typename Particle>
+  void particle(const Particle& prt, KahanSum* sums) const
   {
-    std::vector<double> vals(2);
-
-    const auto& grid = mprts.grid();
-    double fnqs = grid.norm.fnqs;
-    double fac = grid.domain.dx[0] * grid.domain.dx[1] * grid.domain.dx[2];
-
-    auto accessor = mprts.accessor();
-    for (int p = 0; p < mprts.n_patches(); p++) {
-      for (auto prt : accessor[p]) {
-        double gamma =
-          sqrt(1.f + sqr(prt.u()[0]) + sqr(prt.u()[1]) + sqr(prt.u()[2]));
-        double Ekin = (gamma - 1.) * prt.m() * prt.w() * fnqs;
-        double q = prt.q();
-        if (q < 0.) {
-          vals[0] += Ekin * fac;
-        } else if (q > 0.) {
-          vals[1] += Ekin * fac;
-        } else {
-          assert(0);
-        }
-      }
+    double gamma =
+      sqrt(1.f + sqr(prt.u()[0]) + sqr(prt.u()[1]) + sqr(prt.u()[2]));
+    double Ekin = (gamma - 1.) * prt.m() * prt.w();
+    double q = prt.q();
+    if (q < 0.) {
+      sums[0] += Ekin;
+    } else if (q > 0.) {
+      sums[1] += Ekin;
+    } else {
+      assert(0);
     }
+  }
 
-    return vals;
+  template <typename Mparticles, typename MfieldsState>
+  std::vector<double> operator()(Mparticles& mprts, MfieldsState& mflds) const
+  {
+    return reduceParticles(mprts, *this);
   }
 };
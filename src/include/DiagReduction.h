@@ -0,0 +1,186 @@
+
+#pragma once
+
+#include "grid.hxx"
+
+#include <mpi.h>
+
+#include <vector>
+
+// ======================================================================
+// KahanSum
+//
+// compensated summation, so that adding up 1e9 particle contributions
+// doesn't lose most of the significant digits
+
+class KahanSum
+{
+public:
+  KahanSum& operator+=(double val)
+  {
+    double y = val - c_;
+    double t = sum_ + y;
+    c_ = (t - sum_) - y;
+    sum_ = t;
+    return *this;
+  }
+
+  double value() const { return sum_; }
+
+private:
+  double sum_ = 0.;
+  double c_ = 0.;
+};
+
+// ----------------------------------------------------------------------
+// pairwiseSum
+//
+// sums vals[beg] .. vals[end-1] by recursive halving
+
+inline double pairwiseSum(const std::vector<double>& vals, int beg, int end)
+{
+  if (end - beg == 0) {
+    return 0.;
+  } else if (end - beg == 1) {
+    return vals[beg];
+  }
+  int mid = beg + (end - beg) / 2;
+  return pairwiseSum(vals, beg, mid) + pairwiseSum(vals, mid, end);
+}
+
+// ======================================================================
+// Fused diagnostics reductions
+//
+// A diagnostics item provides
+//   static const int n_vals;          // number of scalars it reduces to
+//   std::vector<std::string> names(); // names of those scalars
+//   double scale(const Grid_t&);      // normalization applied to all its sums
+// and either (particle items)
+//   void particle(const Particle& prt, KahanSum* sums);
+// or (field items)
+//   void cell(F& F, int i, int j, int k, KahanSum* sums);
+//
+// reduceParticles() / reduceCells() evaluate any number of items in a single
+// sweep over the particles / cells. Each patch is summed separately (in
+// parallel if OpenMP is enabled), and the per-patch partial sums are then
+// combined pairwise, so the result doesn't depend on the number of threads.
+
+namespace detail
+{
+
+template <typename Particle>
+inline void particleAll(const Particle& prt, KahanSum* sums)
+{}
+
+template <typename Particle, typename Item, typename... Items>
+inline void particleAll(const Particle& prt, KahanSum* sums, const Item& item,
+                        const Items&... items)
+{
+  item.particle(prt, sums);
+  particleAll(prt, sums + Item::n_vals, items...);
+}
+
+template <typename F>
+inline void cellAll(F& F_, int i, int j, int k, KahanSum* sums)
+{}
+
+template <typename F, typename Item, typename... Items>
+inline void cellAll(F& F_, int i, int j, int k, KahanSum* sums,
+                    const Item& item, const Items&... items)
+{
+  item.cell(F_, i, j, k, sums);
+  cellAll(F_, i, j, k, sums + Item::n_vals, items...);
+}
+
+inline void scaleAll(const Grid_t& grid, double* vals) {}
+
+template <typename Item, typename... Items>
+inline void scaleAll(const Grid_t& grid, double* vals, const Item& item,
+                     const Items&... items)
+{
+  double scale = item.scale(grid);
+  for (int m = 0; m < Item::n_vals; m++) {
+    vals[m] *= scale;
+  }
+  scaleAll(grid, vals + Item::n_vals, items...);
+}
+
+inline int nValsAll() { return 0; }
+
+template <typename Item, typename... Items>
+inline int nValsAll(const Item& item, const Items&... items)
+{
+  return Item::n_vals + nValsAll(items...);
+}
+
+// combines per-patch sums (stored as sums_by_patch[p * n_vals + m])
+
+inline std::vector<double> combinePatches(
+  const std::vector<KahanSum>& sums_by_patch, int n_patches, int n_vals)
+{
+  std::vector<double> vals(n_vals), by_patch(n_patches);
+  for (int m = 0; m < n_vals; m++) {
+    for (int p = 0; p < n_patches; p++) {
+      by_patch[p] = sums_by_patch[p * n_vals + m].value();
+    }
+    vals[m] = pairwiseSum(by_patch, 0, n_patches);
+  }
+  return vals;
+}
+
+} // namespace detail
+
+// ----------------------------------------------------------------------
+// reduceParticles
+
+template <typename Mparticles, typename... Items>
+std::vector<double> reduceParticles(Mparticles& mprts, const Items&... items)
+{
+  const auto& grid = mprts.grid();
+  int n_vals = detail::nValsAll(items...);
+  int n_patches = mprts.n_patches();
+  std::vector<KahanSum> sums_by_patch(n_patches * n_vals);
+
+  auto accessor = mprts.accessor();
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (int p = 0; p < n_patches; p++) {
+    KahanSum* sums = &sums_by_patch[p * n_vals];
+    for (auto prt : accessor[p]) {
+      detail::particleAll(prt, sums, items...);
+    }
+  }
+
+  auto vals = detail::combinePatches(sums_by_patch, n_patches, n_vals);
+  detail::scaleAll(grid, vals.data(), items...);
+  return vals;
+}
+
+// ----------------------------------------------------------------------
+// reduceCells
+
+template <typename MfieldsState, typename... Items>
+std::vector<double> reduceCells(const Grid_t& grid, MfieldsState& mflds,
+                                const Items&... items)
+{
+  int n_vals = detail::nValsAll(items...);
+  int n_patches = grid.n_patches();
+  std::vector<KahanSum> sums_by_patch(n_patches * n_vals);
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (int p = 0; p < n_patches; p++) {
+    KahanSum* sums = &sums_by_patch[p * n_vals];
+    auto F = mflds[p];
+    // FIXME, this doesn't handle non-periodic b.c. right
+    grid.Foreach_3d(0, 0, [&](int ix, int iy, int iz) {
+      detail::cellAll(F, ix, iy, iz, sums, items...);
+    });
+  }
+
+  auto vals = detail::combinePatches(sums_by_patch, n_patches, n_vals);
+  detail::scaleAll(grid, vals.data(), items...);
+  return vals;
+}
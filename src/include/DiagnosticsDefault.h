@@ -1,18 +1,22 @@
 
 #pragma once
 
+#include "DiagDistribution.h"
 #include "DiagEnergies.h"
 
 // ======================================================================
 // DiagnosticsDefault
+//
+// runs the field, particle and energy output, and optionally a
+// DiagDistribution, at every step (each decides itself whether it's due)
 
 template <typename OutputFields, typename OutputParticles, typename OutputEnergies>
 class DiagnosticsDefault
 {
 public:
   DiagnosticsDefault(OutputFields& outf, OutputParticles& outp,
-                     OutputEnergies& oute)
-    : outf_{outf}, outp_{outp}, oute_{oute}
+                     OutputEnergies& oute, DiagDistribution* distf = nullptr)
+    : outf_{outf}, outp_{outp}, oute_{oute}, distf_{distf}
   {}
 
   template <typename Mparticles, typename MfieldsState>
@@ -29,6 +33,9 @@ public:
 #endif
     outp_(mprts);
     oute_(mprts, mflds);
+    if (distf_) {
+      (*distf_)(mprts);
+    }
     psc_stats_stop(st_time_output);
   }
 
@@ -36,6 +43,7 @@ private:
   OutputFields& outf_;
   OutputParticles& outp_;
   OutputEnergies& oute_;
+  DiagDistribution* distf_;
 };
 
 template <typename OutputFields, typename OutputParticles, typename OutputEnergies>
@@ -44,3 +52,11 @@ DiagnosticsDefault<OutputFields, OutputParticles, OutputEnergies> makeDiagnostic
 {
   return {outf, outp, oute};
 }
+
+template <typename OutputFields, typename OutputParticles, typename OutputEnergies>
+DiagnosticsDefault<OutputFields, OutputParticles, OutputEnergies> makeDiagnosticsDefault(
+  OutputFields& outf, OutputParticles& outp, OutputEnergies& oute,
+  DiagDistribution& distf)
+{
+  return {outf, outp, oute, &distf};
+}
@@ -0,0 +1,335 @@
+
+#pragma once
+
+#include <mpi.h>
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace psc
+{
+namespace mem
+{
+
+// ======================================================================
+// MemoryPool
+//
+// Keeps freed blocks around, binned by size class, and hands them out again,
+// rather than returning them to the general heap. Particle buffers are
+// continuously grown, shrunk, and, after rebalancing, thrown away and
+// reallocated in different sizes, which over long runs fragments the heap
+// badly.
+//
+// There are eight size classes per power of two (from 256 bytes up), so
+// rounding up wastes at most 1/8 of a block.
+//
+// Blocks of at least hugePageSize() are aligned to it and advised to be
+// backed by (transparent) huge pages. Memory isn't touched here, so pages of
+// a new block end up on the NUMA node of the thread that first writes them,
+// normally the thread that owns the patch. Reused blocks keep their original
+// placement.
+//
+// Free memory kept for reuse is limited to maxFree(), by default a quarter of
+// the high-water mark of memory in use; blocks freed beyond that go straight
+// back to the system. setMaxFree() sets a fixed limit instead, and trim()
+// gives all free memory back.
+//
+// Every size class has its own lock, and the counters are atomic, so threads
+// working on blocks of different sizes don't wait for each other. A size
+// class with no free blocks isn't locked at all.
+
+class MemoryPool
+{
+public:
+  struct Stats
+  {
+    size_t in_use = 0;     // bytes currently handed out
+    size_t held = 0;       // bytes allocated from the system (in use + free)
+    size_t high_water = 0; // max bytes in use so far
+    size_t n_alloc = 0;    // number of allocations
+    size_t n_reused = 0;   // ... of which were served from the pool
+    size_t n_trimmed = 0;  // number of free blocks given back to the system
+  };
+
+  MemoryPool() = default;
+  MemoryPool(const MemoryPool&) = delete;
+  MemoryPool& operator=(const MemoryPool&) = delete;
+
+  ~MemoryPool() { trim(); }
+
+  static size_t hugePageSize() { return size_t(2) << 20; }
+
+  // ----------------------------------------------------------------------
+  // allocate
+
+  void* allocate(size_t bytes)
+  {
+    size_t bin = sizeClass(bytes);
+    size_t size = binSize(bin);
+
+    n_alloc_++;
+    size_t in_use = in_use_ += size;
+    size_t high_water = high_water_;
+    while (in_use > high_water &&
+           !high_water_.compare_exchange_weak(high_water, in_use)) {
+    }
+
+    auto& b = bins_[bin];
+    if (pooling_ && b.n_free > 0) {
+      std::lock_guard<std::mutex> lock{b.mutex};
+      if (!b.free.empty()) {
+        void* p = b.free.back();
+        b.free.pop_back();
+        b.n_free--;
+        free_bytes_ -= size;
+        n_reused_++;
+        return p;
+      }
+    }
+
+    void* p = systemAllocate(size);
+    held_ += size;
+    return p;
+  }
+
+  // ----------------------------------------------------------------------
+  // deallocate
+
+  void deallocate(void* p, size_t bytes)
+  {
+    if (!p) {
+      return;
+    }
+    size_t bin = sizeClass(bytes);
+    size_t size = binSize(bin);
+
+    assert(in_use_ >= size);
+    in_use_ -= size;
+    if (pooling_) {
+      if ((free_bytes_ += size) <= maxFree()) {
+        auto& b = bins_[bin];
+        std::lock_guard<std::mutex> lock{b.mutex};
+        b.free.push_back(p);
+        b.n_free++;
+        return;
+      }
+      free_bytes_ -= size;
+      n_trimmed_++;
+    }
+    held_ -= size;
+    free(p);
+  }
+
+  // ----------------------------------------------------------------------
+  // trim
+  //
+  // returns all free blocks to the system
+
+  void trim() { trimTo(0); }
+
+  // ----------------------------------------------------------------------
+  // setMaxFree
+  //
+  // limits the free memory kept for reuse to the given number of bytes,
+  // giving back what's beyond that right away (largest blocks first)
+
+  void setMaxFree(size_t bytes)
+  {
+    max_free_ = bytes;
+    trimTo(bytes);
+  }
+
+  size_t maxFree() const
+  {
+    size_t max_free = max_free_;
+    return max_free == DEFAULT ? high_water_ / 4 : max_free;
+  }
+
+  // ----------------------------------------------------------------------
+  // setPooling
+  //
+  // with pooling off, freed blocks go straight back to the system
+
+  void setPooling(bool pooling)
+  {
+    pooling_ = pooling;
+    if (!pooling) {
+      trim();
+    }
+  }
+
+  Stats stats() const
+  {
+    Stats s;
+    s.in_use = in_use_;
+    s.held = held_;
+    s.high_water = high_water_;
+    s.n_alloc = n_alloc_;
+    s.n_reused = n_reused_;
+    s.n_trimmed = n_trimmed_;
+    return s;
+  }
+
+  // ----------------------------------------------------------------------
+  // print
+  //
+  // prints the max over all ranks of the pool's usage (on rank 0)
+
+  void print(MPI_Comm comm, const char* name) const
+  {
+    auto s = stats();
+    double local[3] = {double(s.in_use), double(s.held), double(s.high_water)};
+    double global[3];
+    MPI_Reduce(local, global, 3, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if (rank == 0) {
+      printf("***** %s memory pool (max / rank): in use %.1f MB held %.1f MB "
+             "high water %.1f MB\n",
+             name, global[0] / 1e6, global[1] / 1e6, global[2] / 1e6);
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // sizeClass / binSize
+  //
+  // bin 0 holds blocks of 256 bytes, after that every power of two is split
+  // into 8 equal steps: 288, 320, ..., 512, 576, 640, ...
+
+  static size_t sizeClass(size_t bytes)
+  {
+    if (bytes <= 256) {
+      return 0;
+    }
+    size_t n = bytes - 1;
+    int e = 63 - __builtin_clzll(n); // n in [2^e, 2^(e+1))
+    return (e - 8) * 8 + ((n >> (e - 3)) & 7) + 1;
+  }
+
+  static size_t binSize(size_t bin)
+  {
+    if (bin == 0) {
+      return 256;
+    }
+    int e = (bin - 1) / 8 + 8;
+    return (9 + (bin - 1) % 8) << (e - 3);
+  }
+
+private:
+  // frees blocks, largest first, until at most limit bytes are free
+  void trimTo(size_t limit)
+  {
+    for (size_t bin = N_BINS; bin-- > 0 && free_bytes_ > limit;) {
+      auto& b = bins_[bin];
+      if (b.n_free == 0) {
+        continue;
+      }
+      std::lock_guard<std::mutex> lock{b.mutex};
+      while (!b.free.empty() && free_bytes_ > limit) {
+        free(b.free.back());
+        b.free.pop_back();
+        b.n_free--;
+        held_ -= binSize(bin);
+        free_bytes_ -= binSize(bin);
+        n_trimmed_++;
+      }
+    }
+  }
+
+  static void* systemAllocate(size_t size)
+  {
+    size_t align = size >= hugePageSize() ? hugePageSize() : 64;
+    void* p;
+    if (posix_memalign(&p, align, size) != 0) {
+      throw std::bad_alloc{};
+    }
+#ifdef MADV_HUGEPAGE
+    if (align == hugePageSize()) {
+      madvise(p, size, MADV_HUGEPAGE);
+    }
+#endif
+    return p;
+  }
+
+  struct Bin
+  {
+    std::mutex mutex;
+    std::vector<void*> free;
+    std::atomic<size_t> n_free{0}; // free.size(), readable without the lock
+  };
+
+  // up to blocks of 2^64 bytes
+  static const size_t N_BINS = 1 + (64 - 8) * 8;
+
+  std::array<Bin, N_BINS> bins_;
+  std::atomic<size_t> in_use_{0};
+  std::atomic<size_t> held_{0};
+  std::atomic<size_t> high_water_{0};
+  std::atomic<size_t> n_alloc_{0};
+  std::atomic<size_t> n_reused_{0};
+  std::atomic<size_t> n_trimmed_{0};
+  std::atomic<size_t> free_bytes_{0}; // held, but not in use
+  std::atomic<bool> pooling_{true};
+
+  static const size_t DEFAULT = ~size_t(0);
+  std::atomic<size_t> max_free_{DEFAULT};
+};
+
+// ----------------------------------------------------------------------
+// particlePool
+//
+// the pool shared by particle storage, bnd exchange and sort buffers
+
+inline MemoryPool& particlePool()
+{
+  static MemoryPool pool;
+  return pool;
+}
+
+// ======================================================================
+// PoolAllocator
+//
+// std::allocator replacement that gets its memory from particlePool()
+
+template <typename T>
+struct PoolAllocator
+{
+  using value_type = T;
+
+  PoolAllocator() = default;
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&)
+  {}
+
+  T* allocate(size_t n)
+  {
+    return static_cast<T*>(particlePool().allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t n) { particlePool().deallocate(p, n * sizeof(T)); }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&)
+{
+  return false;
+}
+
+} // namespace mem
+} // namespace psc
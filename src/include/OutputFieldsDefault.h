@@ -4,10 +4,12 @@
 #include "../libpsc/psc_output_fields/fields_item_fields.hxx"
 #include "../libpsc/psc_output_fields/fields_item_moments_1st.hxx"
 #include "fields_item.hxx"
+#include "OutputFieldsView.h"
 
 #include <mrc_io.hxx>
 
 #include <memory>
+#include <vector>
 
 template <typename Mparticles>
 using FieldsItem_Moments_1st_cc = Moments_1st<Mparticles>;
@@ -28,7 +30,12 @@ struct OutputFieldsParams
   int tfield_every = 1;
 
   Int3 rn = {};
-  Int3 rx = {1000000, 1000000, 100000};
+  Int3 rx = {1000000, 1000000, 1000000};
+
+  // if given, these views are written rather than the full fields (in the
+  // rn..rx box); a view with default settings but for its name is the same
+  // as the full output
+  std::vector<OutputFieldsView> views;
 };
 
 // ======================================================================
@@ -50,11 +57,16 @@ public:
       pfield_next_{pfield_first},
       tfield_next_{tfield_first}
   {
-    if (pfield_step > 0) {
-      io_pfd_.reset(new MrcIo{"pfd", data_dir});
+    if (views.empty()) {
+      views.push_back({"", {1, 1, 1}, rn, rx});
     }
-    if (tfield_step > 0) {
-      io_tfd_.reset(new MrcIo{"tfd", data_dir});
+    for (auto& view : views) {
+      if (pfield_step > 0) {
+        io_pfd_.emplace_back("pfd", data_dir, view);
+      }
+      if (tfield_step > 0) {
+        io_tfd_.emplace_back("tfd", data_dir, view);
+      }
     }
   }
 
@@ -91,10 +103,12 @@ public:
       mpi_printf(grid.comm(), "***** Writing PFD output\n");
       pfield_next_ += pfield_step;
 
-      io_pfd_->open(grid, rn, rx);
-      _write_pfd(pfd_jeh);
-      _write_pfd(pfd_moments);
-      io_pfd_->close();
+      for (auto& io : io_pfd_) {
+        io.open(grid);
+        _write_pfd(io, pfd_jeh);
+        _write_pfd(io, pfd_moments);
+        io.close();
+      }
     }
 
     if (doaccum_tfield) {
@@ -107,10 +121,17 @@ public:
       mpi_printf(grid.comm(), "***** Writing TFD output\n");
       tfield_next_ += tfield_step;
 
-      io_tfd_->open(grid, rn, rx);
-      _write_tfd(tfd_jeh_, pfd_jeh);
-      _write_tfd(tfd_moments_, pfd_moments);
-      io_tfd_->close();
+      // convert accumulated values to correct temporal mean
+      tfd_jeh_.scale(1. / naccum_);
+      tfd_moments_.scale(1. / naccum_);
+      for (auto& io : io_tfd_) {
+        io.open(grid);
+        _write_tfd(io, tfd_jeh_, pfd_jeh);
+        _write_tfd(io, tfd_moments_, pfd_moments);
+        io.close();
+      }
+      tfd_jeh_.zero();
+      tfd_moments_.zero();
       naccum_ = 0;
     }
 
@@ -119,27 +140,23 @@ public:
 
 private:
   template <typename EXP>
-  void _write_pfd(EXP& pfd)
+  void _write_pfd(OutputFieldsViewWriter& io, EXP& pfd)
   {
-    MrcIo::write_mflds(io_pfd_->io_, adaptMfields(pfd), pfd.grid(), pfd.name(),
-                       pfd.comp_names());
+    io.write(adaptMfields(pfd), pfd.grid(), pfd.name(), pfd.comp_names());
   }
 
   template <typename EXP>
-  void _write_tfd(MfieldsC& tfd, EXP& pfd)
+  void _write_tfd(OutputFieldsViewWriter& io, MfieldsC& tfd, EXP& pfd)
   {
-    // convert accumulated values to correct temporal mean
-    tfd.scale(1. / naccum_);
-    tfd.write_as_mrc_fld(io_tfd_->io_, pfd.name(), pfd.comp_names());
-    tfd.zero();
+    io.write(tfd, tfd.grid(), pfd.name(), pfd.comp_names());
   }
 
 private:
   // tfd -- FIXME?! always MfieldsC
   MfieldsC tfd_jeh_;
   MfieldsC tfd_moments_;
-  std::unique_ptr<MrcIo> io_pfd_;
-  std::unique_ptr<MrcIo> io_tfd_;
+  std::vector<OutputFieldsViewWriter> io_pfd_;
+  std::vector<OutputFieldsViewWriter> io_tfd_;
   int pfield_next_, tfield_next_;
   int naccum_ = 0;
 };
@@ -0,0 +1,198 @@
+
+#pragma once
+
+#include "grid.hxx"
+#include "mrc_domain.hxx"
+
+#include <mrc_io.hxx>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// ======================================================================
+// OutputFieldsView
+//
+// A reduced version of the fields that OutputFields writes: only the box
+// rn..rx (in cells of the simulation grid, so rx[d] = rn[d] + 1 gives a
+// plane or line), with the fields averaged over blocks of coarsen cells in
+// each direction. Each view is written to its own set of files, named
+// <pfd|tfd>_<name> (or just pfd / tfd for an empty name).
+//
+// The box is applied by the xdmf_collective writer, which then only
+// gathers and writes that part of the domain; other mrc_io types write the
+// whole (coarsened) domain.
+
+struct OutputFieldsView
+{
+  std::string name;
+  Int3 coarsen = {1, 1, 1};
+  Int3 rn = {};
+  Int3 rx = {1000000, 1000000, 1000000};
+};
+
+// ======================================================================
+// OutputFieldsViewWriter
+
+class OutputFieldsViewWriter
+{
+public:
+  OutputFieldsViewWriter(const std::string& pfx, const char* data_dir,
+                         const OutputFieldsView& view)
+    : view_{view},
+      io_{new MrcIo{(view.name.empty() ? pfx : pfx + "_" + view.name).c_str(),
+                    data_dir}}
+  {
+    for (int d = 0; d < 3; d++) {
+      assert(view_.coarsen[d] >= 1);
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // open
+
+  void open(const Grid_t& grid)
+  {
+    Int3 coarsen = coarsenFor(grid);
+    Int3 rn, rx;
+    for (int d = 0; d < 3; d++) {
+      int gdims = grid.domain.gdims[d] / coarsen[d];
+      rn[d] = std::min(view_.rn[d], grid.domain.gdims[d] - 1) / coarsen[d];
+      rx[d] = (std::min(view_.rx[d], grid.domain.gdims[d]) + coarsen[d] - 1) /
+              coarsen[d];
+      rx[d] = std::max(std::min(rx[d], gdims), rn[d] + 1);
+    }
+    if (!(coarsen == Int3{1, 1, 1})) {
+      updateCoarseDomain(grid, coarsen);
+    }
+    io_->open(grid, rn, rx);
+  }
+
+  void close() { io_->close(); }
+
+  // ----------------------------------------------------------------------
+  // write
+  //
+  // mflds is anything that can be indexed like Mfields, without ghosts
+
+  template <typename Mfields>
+  void write(const Mfields& mflds, const Grid_t& grid, const std::string& name,
+             const std::vector<std::string>& comp_names)
+  {
+    if (coarsenFor(grid) == Int3{1, 1, 1}) {
+      MrcIo::write_mflds(io_->io_, mflds, grid, name, comp_names);
+      return;
+    }
+
+    mrc_fld* fld = coarsened(mflds, grid, name, comp_names);
+    mrc_fld_write(fld, io_->io_);
+    mrc_fld_destroy(fld);
+  }
+
+  // ----------------------------------------------------------------------
+  // coarsened
+  //
+  // the block averaged fields on the coarse domain, as written; to be
+  // destroyed by the caller
+
+  template <typename Mfields>
+  mrc_fld* coarsened(const Mfields& _mflds, const Grid_t& grid,
+                     const std::string& name,
+                     const std::vector<std::string>& comp_names)
+  {
+    Int3 coarsen = coarsenFor(grid);
+    updateCoarseDomain(grid, coarsen);
+
+    auto& mflds = const_cast<Mfields&>(_mflds);
+    int n_comps = comp_names.size();
+    mrc_fld* fld = coarse_domain_.m3_create();
+    mrc_fld_set_name(fld, name.c_str());
+    mrc_fld_set_param_int(fld, "nr_ghosts", 0);
+    mrc_fld_set_param_int(fld, "nr_comps", n_comps);
+    mrc_fld_setup(fld);
+    for (int m = 0; m < n_comps; m++) {
+      mrc_fld_set_comp_name(fld, m, comp_names[m].c_str());
+    }
+
+    // block average straight into the output field
+    double fac = 1. / (coarsen[0] * coarsen[1] * coarsen[2]);
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      auto flds = mflds[p];
+      mrc_fld_patch* m3p = mrc_fld_patch_get(fld, p);
+      mrc_fld_foreach(fld, i, j, k, 0, 0)
+      {
+        for (int m = 0; m < n_comps; m++) {
+          double sum = 0.;
+          for (int kk = 0; kk < coarsen[2]; kk++) {
+            for (int jj = 0; jj < coarsen[1]; jj++) {
+              for (int ii = 0; ii < coarsen[0]; ii++) {
+                sum += flds(m, i * coarsen[0] + ii, j * coarsen[1] + jj,
+                            k * coarsen[2] + kk);
+              }
+            }
+          }
+          MRC_M3(m3p, m, i, j, k) = fac * sum;
+        }
+      }
+      mrc_fld_foreach_end;
+      mrc_fld_patch_put(fld);
+    }
+    return fld;
+  }
+
+private:
+  // invariant directions can't be coarsened
+  Int3 coarsenFor(const Grid_t& grid) const
+  {
+    Int3 coarsen = view_.coarsen;
+    for (int d = 0; d < 3; d++) {
+      if (grid.isInvar(d)) {
+        coarsen[d] = 1;
+      }
+    }
+    return coarsen;
+  }
+
+  // ----------------------------------------------------------------------
+  // updateCoarseDomain
+  //
+  // the coarse domain has the same patches as the grid, with the same number
+  // on each rank, so it ends up with the same patch -> rank mapping. It's
+  // recreated when the grid changes, e.g., after load balancing.
+
+  void updateCoarseDomain(const Grid_t& grid, const Int3& coarsen)
+  {
+    auto offs = grid.mrc_domain().offs();
+    if (coarse_domain_valid_ && offs == offs_ && coarsen == coarse_coarsen_) {
+      return;
+    }
+
+    for (int d = 0; d < 3; d++) {
+      if (grid.ldims[d] % coarsen[d] != 0) {
+        mprintf("OutputFieldsView '%s': ldims[%d] = %d not divisible by %d\n",
+                view_.name.c_str(), d, grid.ldims[d], coarsen[d]);
+        assert(0);
+      }
+    }
+    auto domain = Grid_t::Domain{grid.domain.gdims / coarsen,
+                                 grid.domain.length, grid.domain.corner,
+                                 grid.domain.np};
+    coarse_domain_ = MrcDomain{domain, grid.bc, grid.n_patches()};
+
+    auto coarse_offs = coarse_domain_.offs();
+    assert(coarse_offs.size() == offs.size());
+    for (int p = 0; p < int(offs.size()); p++) {
+      assert(coarse_offs[p] * coarsen == offs[p]);
+    }
+    offs_ = offs;
+    coarse_coarsen_ = coarsen;
+    coarse_domain_valid_ = true;
+  }
+
+  OutputFieldsView view_;
+  std::unique_ptr<MrcIo> io_;
+  MrcDomain coarse_domain_;
+  bool coarse_domain_valid_ = false;
+  std::vector<Int3> offs_;
+  Int3 coarse_coarsen_;
+};
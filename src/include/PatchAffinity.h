@@ -0,0 +1,255 @@
+
+#pragma once
+
+#include <mpi.h>
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace psc
+{
+namespace numa
+{
+
+// ======================================================================
+// Patch -> thread affinity
+//
+// Patch loops are parallelized with a plain "#pragma omp parallel for",
+// i.e., a static schedule, which assigns each thread one contiguous block of
+// patches. On a NUMA machine, a patch's data should therefore live on the
+// socket of the thread that owns that block, which under the usual
+// first-touch policy means that thread has to be the one that first writes
+// it. The helpers below use the same patch -> thread mapping, so memory
+// initialized with firstTouch() / forEachPatchOnOwner() ends up where the
+// patch loops will use it -- as long as threads don't migrate between
+// sockets (see pinThreads()).
+
+inline int nThreads()
+{
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+// ----------------------------------------------------------------------
+// patchRange
+//
+// the block of patches [*p_begin, *p_end) owned by the given thread, matching
+// how libgomp / LLVM split a schedule(static) loop
+
+inline void patchRange(int thread, int n_threads, int n_patches, int* p_begin,
+                       int* p_end)
+{
+  int q = n_patches / n_threads, r = n_patches % n_threads;
+  if (thread < r) {
+    *p_begin = thread * (q + 1);
+    *p_end = *p_begin + q + 1;
+  } else {
+    *p_begin = thread * q + r;
+    *p_end = *p_begin + q;
+  }
+}
+
+// ----------------------------------------------------------------------
+// patchThread
+//
+// the thread that owns patch p
+
+inline int patchThread(int p, int n_patches, int n_threads = nThreads())
+{
+  int q = n_patches / n_threads, r = n_patches % n_threads;
+  if (p < r * (q + 1)) {
+    return p / (q + 1);
+  }
+  return r + (p - r * (q + 1)) / q;
+}
+
+// ----------------------------------------------------------------------
+// forEachPatchOnOwner
+//
+// calls f(p) for all patches, each on the thread that owns it
+
+template <typename F>
+inline void forEachPatchOnOwner(int n_patches, F&& f)
+{
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+#ifdef _OPENMP
+    int thread = omp_get_thread_num(), n_threads = omp_get_num_threads();
+#else
+    int thread = 0, n_threads = 1;
+#endif
+    int p_begin, p_end;
+    patchRange(thread, n_threads, n_patches, &p_begin, &p_end);
+    for (int p = p_begin; p < p_end; p++) {
+      f(p);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// firstTouch
+//
+// zeroes n_patches consecutive slices of size stride starting at data, each
+// on the thread that owns that patch
+
+template <typename T>
+inline void firstTouch(T* data, size_t stride, int n_patches)
+{
+  forEachPatchOnOwner(n_patches, [&](int p) {
+    std::memset(static_cast<void*>(data + p * stride), 0, stride * sizeof(T));
+  });
+}
+
+// ======================================================================
+// NoInitAllocator
+//
+// std::allocator, except that it default-initializes, so that a
+// std::vector<float> etc of a given size can be created without touching
+// the memory (which firstTouch() then does in the right place)
+
+template <typename T>
+struct NoInitAllocator : std::allocator<T>
+{
+  template <typename U>
+  struct rebind
+  {
+    using other = NoInitAllocator<U>;
+  };
+
+  NoInitAllocator() = default;
+
+  template <typename U>
+  NoInitAllocator(const NoInitAllocator<U>&)
+  {}
+
+  template <typename U>
+  void construct(U* p)
+  {
+    ::new (static_cast<void*>(p)) U;
+  }
+
+  template <typename U, typename... Args>
+  void construct(U* p, Args&&... args)
+  {
+    ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+};
+
+// ----------------------------------------------------------------------
+// pinnedCpu
+//
+// which of the n_cpus CPUs a rank is allowed to run on thread `thread` gets
+// bound to, where ranks that share the same set of CPUs each get their own
+// consecutive block of n_threads of them (local_rank is the rank's index
+// among those sharing, n_sharing how many there are). Returns -1 if there
+// aren't enough CPUs to give every thread its own.
+
+inline int pinnedCpu(int thread, int n_threads, int local_rank, int n_sharing,
+                     int n_cpus)
+{
+  if (n_threads * n_sharing > n_cpus) {
+    return -1;
+  }
+  return local_rank * n_threads + thread;
+}
+
+// ----------------------------------------------------------------------
+// pinThreads
+//
+// binds each OpenMP thread to its own CPU, so that threads don't migrate
+// away from the memory they touched. If the launcher bound each rank to
+// its own set of CPUs, threads are spread over that set. If ranks on the
+// same node share the same set (typically, all of the node), each rank
+// uses its own part of it, based on its node-local rank. If neither is
+// the case, or there are more threads than CPUs, nothing gets pinned.
+// Does nothing if OMP_PROC_BIND / OMP_PLACES already handle this, or without
+// OpenMP.
+
+inline void pinThreads(MPI_Comm comm = MPI_COMM_WORLD)
+{
+#if defined(_OPENMP) && defined(__linux__)
+  if (omp_get_proc_bind() != omp_proc_bind_false) {
+    return;
+  }
+
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return;
+  }
+  int cpus[CPU_SETSIZE], n_cpus = 0;
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &allowed)) {
+      cpus[n_cpus++] = cpu;
+    }
+  }
+
+  // find the other ranks on this node that were allowed the same CPUs
+  int local_rank = 0, n_sharing = 1;
+  int initialized;
+  MPI_Initialized(&initialized);
+  if (initialized) {
+    MPI_Comm node;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+    int node_rank, node_size;
+    MPI_Comm_rank(node, &node_rank);
+    MPI_Comm_size(node, &node_size);
+    std::vector<cpu_set_t> sets(node_size);
+    MPI_Allgather(&allowed, sizeof(allowed), MPI_BYTE, sets.data(),
+                  sizeof(allowed), MPI_BYTE, node);
+    MPI_Comm_free(&node);
+
+    n_sharing = 0;
+    for (int r = 0; r < node_size; r++) {
+      if (CPU_EQUAL(&sets[r], &allowed)) {
+        if (r < node_rank) {
+          local_rank++;
+        }
+        n_sharing++;
+      } else {
+        cpu_set_t common;
+        CPU_AND(&common, &sets[r], &allowed);
+        if (CPU_COUNT(&common) > 0) {
+          return; // partially overlapping, can't tell who should go where
+        }
+      }
+    }
+  }
+
+  int n_threads = omp_get_max_threads();
+  if (pinnedCpu(n_threads - 1, n_threads, local_rank, n_sharing, n_cpus) < 0) {
+    return;
+  }
+
+#pragma omp parallel
+  {
+    int idx = pinnedCpu(omp_get_thread_num(), omp_get_num_threads(),
+                        local_rank, n_sharing, n_cpus);
+    if (idx >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus[idx], &set);
+      sched_setaffinity(0, sizeof(set), &set);
+    }
+  }
+#endif
+}
+
+} // namespace numa
+} // namespace psc
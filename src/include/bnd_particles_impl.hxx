@@ -23,6 +23,7 @@ struct BndParticlesCommon : BndParticlesBase
   using real_t = typename Mparticles::real_t;
   using ddcp_t = ddc_particles<Mparticles>;
   using BndBuffers = typename Mparticles::BndBuffers;
+  using CellIndices = std::vector<std::vector<int>>;
 
   // ----------------------------------------------------------------------
   // ctor
@@ -54,8 +55,13 @@ struct BndParticlesCommon : BndParticlesBase
 
   // ----------------------------------------------------------------------
   // process_and_exchange
+  //
+  // if cidx is given, the per-particle cell indices in it are used (if
+  // cidx_valid) and kept in sync with the particles, including the ones that
+  // are received
 
-  void process_and_exchange(Mparticles& mprts, BndBuffers& bufs)
+  void process_and_exchange(Mparticles& mprts, BndBuffers& bufs,
+			    CellIndices* cidx = nullptr, bool cidx_valid = false)
   {
     static int pr_B, pr_C;
     if (!pr_B) {
@@ -68,7 +74,8 @@ struct BndParticlesCommon : BndParticlesBase
 #pragma omp parallel for
     for (int p = 0; p < ddcp->nr_patches; p++) {
       if (psc_balance_comp_time_by_patch) psc_balance_comp_time_by_patch[p] -= MPI_Wtime();
-      process_patch(mprts.grid(), mprts.particleIndexer(), bufs, p);
+      process_patch(mprts.grid(), mprts.particleIndexer(), bufs, p,
+		    cidx ? &(*cidx)[p] : nullptr, cidx_valid);
       if (psc_balance_comp_time_by_patch) psc_balance_comp_time_by_patch[p] += MPI_Wtime();
     }
     prof_stop(pr_B);
@@ -77,10 +84,24 @@ struct BndParticlesCommon : BndParticlesBase
     prof_start(pr_C);
     ddcp->comm(bufs);
     prof_stop(pr_C);
+
+    if (cidx) {
+      const auto& pi = mprts.particleIndexer();
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (int p = 0; p < ddcp->nr_patches; p++) {
+	auto& ci = (*cidx)[p];
+	for (size_t n = ci.size(); n < bufs[p].size(); n++) {
+	  ci.push_back(pi.validCellIndex(bufs[p][n].x));
+	}
+      }
+    }
   }
   
 protected:
-  void process_patch(const Grid_t& grid, const ParticleIndexer<real_t>& pi, BndBuffers& buf, int p);
+  void process_patch(const Grid_t& grid, const ParticleIndexer<real_t>& pi, BndBuffers& buf, int p,
+		     std::vector<int>* cidx, bool cidx_valid);
 
 protected:
   ddcp_t* ddcp;
@@ -92,7 +113,8 @@ protected:
 
 template<typename MP>
 void BndParticlesCommon<MP>::process_patch(const Grid_t& grid, const ParticleIndexer<real_t>& pi,
-					   BndBuffers& bufs, int p)
+					   BndBuffers& bufs, int p,
+					   std::vector<int>* cidx, bool cidx_valid)
 {
   // New-style boundary requirements.
   // These will need revisiting when it comes to non-periodic domains.
@@ -114,23 +136,37 @@ void BndParticlesCommon<MP>::process_patch(const Grid_t& grid, const ParticleInd
   unsigned int n_begin = 0;
   unsigned int n_end = buf.size();
   unsigned int head = n_begin;
+  if (cidx) {
+    assert(!cidx_valid || cidx->size() == n_end);
+    cidx->resize(n_end);
+  }
 
   for (int n = n_begin; n < n_end; n++) {
     auto *prt = &buf[n];
     real_t *xi = prt->x;
     real_t *pxi = prt->u;
     
-    Int3 pos = pi.cellPosition(xi);
+    Int3 pos;
+    int cell;
+    if (cidx_valid) {
+      cell = (*cidx)[n];
+    } else {
+      pos = pi.cellPosition(xi);
+      cell = pi.cellIndex(pos);
+    }
     
-    if (pos[0] >= 0 && pos[0] < ldims[0] && // OPT, could be optimized with casts to unsigned
-	pos[1] >= 0 && pos[1] < ldims[1] &&
-	pos[2] >= 0 && pos[2] < ldims[2]) {
+    if (cell >= 0) {
       // fast path
       // particle is still inside patch: move into right position
-      pi.validCellIndex(xi);
+      if (cidx) {
+	(*cidx)[head] = cell;
+      }
       buf[head++] = *prt;
       continue;
     }
+    if (cidx_valid) {
+      pos = pi.cellPosition(xi);
+    }
 
     // slow path
     // handle particles which (seemingly) left the patch
@@ -203,7 +239,10 @@ void BndParticlesCommon<MP>::process_patch(const Grid_t& grid, const ParticleInd
     }
     if (!drop) {
       if (dir[0] == 0 && dir[1] == 0 && dir[2] == 0) {
-	pi.validCellIndex(xi);
+	cell = pi.validCellIndex(xi);
+	if (cidx) {
+	  (*cidx)[head] = cell;
+	}
 	buf[head++] = *prt;
       } else {
 	auto* nei = &dpatch->nei[mrc_ddc_dir2idx(dir)];
@@ -212,6 +251,9 @@ void BndParticlesCommon<MP>::process_patch(const Grid_t& grid, const ParticleInd
     }
   }
   buf.resize(head);
+  if (cidx) {
+    cidx->resize(head);
+  }
 }
 
 // ======================================================================
@@ -236,7 +278,9 @@ struct BndParticles_ : BndParticlesCommon<MP>
     }
 
     auto&& bufs = mprts.bndBuffers();
-    this->process_and_exchange(mprts, bufs);
+    this->process_and_exchange(mprts, bufs, &mprts.cellIndices(),
+			       mprts.hasCellIndices());
+    mprts.setCellIndicesValid();
     
     //struct psc_mfields *mflds = psc_mfields_get_as(psc->flds, "c", JXI, JXI + 3);
     //psc_bnd_particles_open_boundary(bnd, particles, mflds);
@@ -5,6 +5,7 @@
 #include <mrc_ddc.h>
 #include <mrc_domain.h>
 #include <mpi_dtype_traits.hxx>
+#include "MemoryPool.h"
 
 // ======================================================================
 // ddc_particles
@@ -18,7 +19,7 @@ struct ddc_particles
   using BndBuffer = typename Mparticles::BndBuffer;
   using BndBuffers = typename Mparticles::BndBuffers;
   using Particle = typename Mparticles::BndpParticle;
-  using Buffer = std::vector<Particle>;
+  using Buffer = std::vector<Particle, psc::mem::PoolAllocator<Particle>>;
   using real_t = typename Particle::real_t;
   
   ddc_particles(const Grid_t& grid);
@@ -5,6 +5,7 @@
 #include "psc.h"
 
 #include "grid.hxx"
+#include "PatchAffinity.h"
 #include <mrc_io.hxx>
 #include <kg/SArrayView.h>
 
@@ -432,7 +433,7 @@ struct Mfields;
 template <typename R>
 struct MfieldsCRTPInnerTypes<Mfields<R>>
 {
-  using Storage = std::vector<R>;
+  using Storage = std::vector<R, psc::numa::NoInitAllocator<R>>;
 };
 
 template<typename R>
@@ -447,7 +448,11 @@ struct Mfields : MfieldsBase, MfieldsCRTP<Mfields<R>>
       Base(n_fields, {-ibn, domain.ldims() + 2 * ibn}, domain.n_patches()),
       storage_(size_t(Base::box().size() * n_fields * Base::n_patches())),
       domain_{domain}
-  {}
+  {
+    // zero each patch's data on the thread that'll work on it
+    psc::numa::firstTouch(storage_.data(), Base::box().size() * n_fields,
+                          Base::n_patches());
+  }
 
   Int3 ldims() const { return domain_.ldims(); }
   Int3 gdims() const { return domain_.gdims(); }
@@ -464,6 +469,15 @@ struct Mfields : MfieldsBase, MfieldsCRTP<Mfields<R>>
   virtual void reset(const Grid_t& grid) override
   {
     MfieldsBase::reset(grid);
+    // rather than resizing, reallocate and first-touch again, since patches
+    // will generally have changed owner threads
+    size_t stride = Base::box().size() * Base::n_comps();
+    Storage storage(stride * grid.n_patches());
+    psc::numa::firstTouch(storage.data(), stride, grid.n_patches());
+    std::copy(storage_.begin(),
+              storage_.begin() + std::min(storage_.size(), storage.size()),
+              storage.begin());
+    storage_ = std::move(storage);
     Base::reset(grid.n_patches());
     domain_ = MfieldsDomain(grid);
   }
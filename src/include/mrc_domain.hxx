@@ -64,6 +64,9 @@ struct MrcDomain
   MrcDomain& operator=(MrcDomain&& o)
   {
     if (this != &o) {
+      if (domain_) {
+	mrc_domain_destroy(domain_);
+      }
       domain_ = o.domain_;
       o.domain_ = nullptr;
     }
@@ -2,6 +2,10 @@
 #pragma once
 
 #include "particles.hxx"
+#include "CounterRng.h"
+
+#include <algorithm>
+#include <vector>
 
 struct OutputParticlesParams
 {
@@ -13,6 +17,105 @@ struct OutputParticlesParams
   bool use_independent_io;
   const char *romio_cb_write;
   const char *romio_ds_write;
+
+  // further selection of the particles to be written, applied in addition to
+  // the lo / hi box
+  int stride = 1;        // only write every stride'th particle per cell and kind
+  double fraction = 1.;  // randomly sub-sample this fraction of particles
+  double p_min = 0.;     // only write particles with |p| >= p_min
+  std::vector<int> kinds;                // only write these kinds (all if empty)
+  std::vector<psc::particle::Tag> tags;  // only write these tags (all if empty)
+  std::vector<psc::particle::Id> ids;    // only write these ids (all if empty)
+
+  // stage the particles to be written and write them in the background while
+  // the simulation continues (needs MPI_THREAD_MULTIPLE, see psc_init(), and
+  // a thread-safe HDF5)
+  bool write_async = false;
+
+  // compress the particle data: "deflate", "lz4" or "zstd" (see
+  // mrc_io_compress_dcpl()), in chunks of about one rank's particles each
+  const char* compression = nullptr;
+  int compression_level = 0; // 0: the compressor's default
+};
+
+// ======================================================================
+// OutputParticlesSelection
+//
+// Decides which particles get written, according to the selection criteria
+// in OutputParticlesParams. It is meant to be evaluated while packing the
+// output buffer, so particles that aren't selected never get copied.
+//
+// The random sub-sampling is keyed by timestep, global patch and the
+// particle's index in the patch, so it's reproducible for a given
+// decomposition. Use stride or tags / ids to follow the same particles over
+// time.
+
+class OutputParticlesSelection
+{
+public:
+  OutputParticlesSelection(const OutputParticlesParams& params, int timestep)
+    : stride_{std::max(params.stride, 1)},
+      fraction_{params.fraction},
+      p_min2_{params.p_min * params.p_min},
+      kinds_{params.kinds},
+      tags_{params.tags},
+      ids_{params.ids},
+      rng_{uint64_t(timestep)}
+  {
+    std::sort(kinds_.begin(), kinds_.end());
+    std::sort(tags_.begin(), tags_.end());
+    std::sort(ids_.begin(), ids_.end());
+  }
+
+  // whether any particles of this kind will be selected at all
+  bool selectKind(int kind) const
+  {
+    return kinds_.empty() ||
+           std::binary_search(kinds_.begin(), kinds_.end(), kind);
+  }
+
+  // n_in_cell: index of the particle among the particles of its cell / kind
+  // gp, n: global patch and index in the patch, used to key the sub-sampling
+  template <typename Particle>
+  bool operator()(const Particle& prt, int n_in_cell, int gp, int n) const
+  {
+    if (n_in_cell % stride_ != 0) {
+      return false;
+    }
+    if (!tags_.empty() &&
+        !std::binary_search(tags_.begin(), tags_.end(), prt.tag())) {
+      return false;
+    }
+    if (!ids_.empty() &&
+        !std::binary_search(ids_.begin(), ids_.end(), prt.id())) {
+      return false;
+    }
+    if (p_min2_ > 0.) {
+      auto u = prt.u();
+      if (sqr(u[0]) + sqr(u[1]) + sqr(u[2]) < p_min2_) {
+        return false;
+      }
+    }
+    if (fraction_ < 1.) {
+      auto r = rng_({uint32_t(n), uint32_t(gp), 0, 0});
+      if (psc::rng::Philox4x32::uniform(r[0]) >= fraction_) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  int stride() const { return stride_; }
+  double fraction() const { return fraction_; }
+
+private:
+  int stride_;
+  double fraction_;
+  double p_min2_;
+  std::vector<int> kinds_;
+  std::vector<psc::particle::Tag> tags_;
+  std::vector<psc::particle::Id> ids_;
+  psc::rng::Philox4x32 rng_;
 };
 
 // ======================================================================
@@ -21,4 +124,3 @@ struct OutputParticlesParams
 class OutputParticlesBase
 {
 };
-
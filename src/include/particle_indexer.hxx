@@ -102,6 +102,17 @@ struct ParticleIndexer
     return cellIndex(cpos);
   }
 
+  // inverse of cellIndex(cpos), for a valid cell index
+  Int3 cellPositionFromIndex(int cidx) const
+  {
+    Int3 cpos;
+    cpos[0] = cidx % ldims_[0];
+    cidx /= ldims_[0];
+    cpos[1] = cidx % ldims_[1];
+    cpos[2] = cidx / ldims_[1];
+    return cpos;
+  }
+
   int validCellIndex(const real_t* pos) const
   {
     Int3 cpos = cellPosition(pos);
@@ -7,6 +7,8 @@
 #include "particle_simple.hxx"
 #include "particle_indexer.hxx"
 #include "UniqueIdGenerator.h"
+#include "MemoryPool.h"
+#include "PatchAffinity.h"
 
 #include <iterator>
 
@@ -37,12 +39,15 @@ private:
 
 // ======================================================================
 // MparticlesStorage
+//
+// the per-patch buffers get their memory from the particle memory pool, so
+// that it's reused when particles move between patches / get rebalanced
 
 template<typename _Particle>
 struct MparticlesStorage
 {
   using Particle = _Particle;
-  using PatchBuffer = std::vector<Particle>;
+  using PatchBuffer = std::vector<Particle, psc::mem::PoolAllocator<Particle>>;
   using Buffers = std::vector<PatchBuffer>;
   using Range = Span<Particle>;
   using iterator = typename Range::iterator;
@@ -66,10 +71,12 @@ struct MparticlesStorage
 
   void resize_all(const std::vector<uint>& n_prts_by_patch)
   {
-    for (int p = 0; p < bufs_.size(); p++) {
+    // resizing initializes the particles, so do it on the owner thread to
+    // have the memory placed there
+    psc::numa::forEachPatchOnOwner(bufs_.size(), [&](int p) {
       assert(n_prts_by_patch[p] <= bufs_[p].capacity());
       bufs_[p].resize(n_prts_by_patch[p]);
-    }
+    });
   }
 
   void clear()
@@ -122,6 +129,7 @@ struct MparticlesSimple : MparticlesBase
   using Storage = MparticlesStorage<Particle>;
   using BndBuffer = typename Storage::PatchBuffer;
   using BndBuffers = typename Storage::Buffers;
+  using CellIndices = std::vector<std::vector<int>>;
 
   struct Patch
   {
@@ -146,8 +154,11 @@ struct MparticlesSimple : MparticlesBase
       // need to copy because we modify it
       auto prt = new_prt;
       checkInPatchMod(prt);
-      validCellIndex(prt);
+      int cidx = validCellIndex(prt);
       mprts_.storage_.push_back(p_, prt);
+      if (mprts_.has_cidx_) {
+	mprts_.cidx_[p_].push_back(cidx);
+      }
     }
     
     void check() const
@@ -175,6 +186,7 @@ struct MparticlesSimple : MparticlesBase
   explicit MparticlesSimple(const Grid_t& grid)
     : MparticlesBase(grid),
       storage_(grid.n_patches()),
+      cidx_(grid.n_patches()),
       uid_gen(grid.comm()),
       pi_(grid)
   {}
@@ -188,13 +200,15 @@ struct MparticlesSimple : MparticlesBase
   {
     MparticlesBase::reset(grid);
     storage_.reset(grid);
+    cidx_ = CellIndices(grid.n_patches());
+    has_cidx_ = false;
   }
 
   Patch operator[](int p) const { return {const_cast<MparticlesSimple&>(*this), p}; } // FIXME, isn't actually const
 
   void reserve_all(const std::vector<uint> &n_prts_by_patch) { storage_.reserve_all(n_prts_by_patch); }
-  void resize_all(const std::vector<uint>& n_prts_by_patch)  { storage_.resize_all(n_prts_by_patch); }
-  void clear()                                               { storage_.clear(); }
+  void resize_all(const std::vector<uint>& n_prts_by_patch)  { storage_.resize_all(n_prts_by_patch); has_cidx_ = false; }
+  void clear()                                               { storage_.clear(); has_cidx_ = false; }
   std::vector<uint> sizeByPatch() const override             { return storage_.sizeByPatch(); }
   int size() const override                                  { return storage_.size(); }
 
@@ -202,10 +216,37 @@ struct MparticlesSimple : MparticlesBase
   
   InjectorSimple<MparticlesSimple> injector() { return {*this}; }
   ConstAccessor accessor() const { return {const_cast<MparticlesSimple&>(*this)}; } // FIXME
-  Accessor accessor_() { return {*this}; }
+  // a mutable accessor may be used to move particles, so the cell index
+  // cache is invalidated (users that keep it in sync may revalidate it)
+  Accessor accessor_() { has_cidx_ = false; return {*this}; }
 
   BndBuffers& bndBuffers() { return storage_.bndBuffers(); }
 
+  // ----------------------------------------------------------------------
+  // cell index cache
+  //
+  // cellIndices(p)[n] holds pi_.cellIndex() of particle n in patch p (-1 if
+  // it's outside of the patch), so that bnd exchange, sorting, collisions and
+  // output don't need to recompute it from the position. It's filled by the
+  // 1vb pusher and by the particle bnd exchange, and only to be trusted while
+  // hasCellIndices() is true. Code that moves / reorders particles needs to
+  // keep it in sync (like sorting and push_back() do), or invalidate it.
+
+  bool hasCellIndices() const { return has_cidx_; }
+  CellIndices& cellIndices() { return cidx_; }
+  std::vector<int>& cellIndices(int p) { return cidx_[p]; }
+  const std::vector<int>& cellIndices(int p) const { return cidx_[p]; }
+
+  void setCellIndicesValid()
+  {
+    for (int p = 0; p < n_patches(); p++) {
+      assert(cidx_[p].size() == storage_[p].size());
+    }
+    has_cidx_ = true;
+  }
+
+  void invalidateCellIndices() { has_cidx_ = false; }
+
   void check() const
   {
     for (int p = 0; p < n_patches(); p++) {
@@ -242,6 +283,8 @@ struct MparticlesSimple : MparticlesBase
 
 private:
   Storage storage_;
+  CellIndices cidx_;
+  bool has_cidx_ = false;
 public: // FIXME
   psc::particle::UniqueIdGenerator uid_gen;
   ParticleIndexer<real_t> pi_;
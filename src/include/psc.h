@@ -45,7 +45,10 @@ enum {
 
 extern int pr_time_step_no_comm;
 
-void psc_init(int& argc, char**& argv);
+// write_async: the run writes output from a background thread (see
+// OutputParticlesParams::write_async), so MPI needs MPI_THREAD_MULTIPLE,
+// which can be costly, so it's only asked for then
+void psc_init(int& argc, char**& argv, bool write_async = false);
 void psc_finalize();
 
 #endif
@@ -72,6 +72,10 @@ struct PscParams
   int balance_interval = 0;
   int sort_interval = 0;
   int marder_interval = 0;
+
+  int resample_interval = 0; // merge / split particles every so many steps
+  int resample_min_ppc = 0;  // per kind and cell, 0: don't split
+  int resample_max_ppc = 0;  // per kind and cell, 0: don't merge
 };
 
 // ----------------------------------------------------------------------
@@ -101,6 +105,7 @@ struct Psc
   using MfieldsState = typename PscConfig::MfieldsState;
   using Balance = typename PscConfig::Balance;
   using Sort = typename PscConfig::Sort;
+  using Resample = typename PscConfig::Resample;
   using Collision = typename PscConfig::Collision;
   using Checks = typename PscConfig::Checks;
   using Marder = typename PscConfig::Marder;
@@ -134,6 +139,7 @@ struct Psc
       bndp_{grid},
       diagnostics_{diagnostics},
       inject_particles_{inject_particles},
+      resample_{params.resample_min_ppc, params.resample_max_ppc},
       checkpointing_{params.write_checkpoint_every_step}
   {
     time_start_ = MPI_Wtime();
@@ -384,10 +390,11 @@ struct Psc
   {
     using Dim = typename PscConfig::Dim;
 
-    static int pr_sort, pr_collision, pr_checks, pr_push_prts, pr_push_flds,
-      pr_bndp, pr_bndf, pr_marder, pr_inject_prts;
+    static int pr_sort, pr_resample, pr_collision, pr_checks, pr_push_prts,
+      pr_push_flds, pr_bndp, pr_bndf, pr_marder, pr_inject_prts;
     if (!pr_sort) {
       pr_sort = prof_register("step_sort", 1., 0, 0);
+      pr_resample = prof_register("step_resample", 1., 0, 0);
       pr_collision = prof_register("step_collision", 1., 0, 0);
       pr_push_prts = prof_register("step_push_prts", 1., 0, 0);
       pr_inject_prts = prof_register("step_inject_prts", 1., 0, 0);
@@ -406,11 +413,26 @@ struct Psc
       balance_(grid_, mprts_);
     }
 
+    bool sorted = false;
     if (p_.sort_interval > 0 && timestep % p_.sort_interval == 0) {
       mpi_printf(comm, "***** Sorting...\n");
       prof_start(pr_sort);
       sort_(mprts_);
       prof_stop(pr_sort);
+      sorted = true;
+    }
+
+    if (p_.resample_interval > 0 && timestep % p_.resample_interval == 0) {
+      mpi_printf(comm, "***** Resampling...\n");
+      // resampling works on particles sorted by cell
+      if (!sorted) {
+        prof_start(pr_sort);
+        sort_(mprts_);
+        prof_stop(pr_sort);
+      }
+      prof_start(pr_resample);
+      resample_(mprts_);
+      prof_stop(pr_resample);
     }
 
     if (collision_.interval() > 0 && timestep % collision_.interval() == 0) {
@@ -644,6 +666,9 @@ private:
 public:
   const Grid_t& grid() { return *grid_; }
 
+  // e.g., to set up subcycling with PushParticlesVb
+  PushParticles& pushParticles() { return pushp_; }
+
 private:
   double time_start_;
   PscParams p_;
@@ -667,6 +692,7 @@ protected:
   Bnd bnd_;
   BndFields bndf_;
   BndParticles bndp_;
+  Resample resample_;
 
   Checkpointing checkpointing_;
 
@@ -0,0 +1,18 @@
+
+#pragma once
+
+#include "particles.hxx"
+
+// ======================================================================
+// ResampleNone
+//
+// for particle types that don't support resampling (yet)
+
+struct ResampleNone
+{
+  ResampleNone(int min_ppc = 0, int max_ppc = 0) {}
+
+  template <typename Mparticles>
+  void operator()(Mparticles& mprts)
+  {}
+};
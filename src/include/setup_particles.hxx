@@ -1,6 +1,12 @@
 
 #pragma once
 
+#include "CounterRng.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 struct psc_particle_npt
 {
   int kind;    ///< particle kind
@@ -18,6 +24,7 @@ struct SetupParticles
 {
   using Mparticles = MP;
   using real_t = typename MP::real_t;
+  using Philox4x32 = psc::rng::Philox4x32;
 
   SetupParticles(const Grid_t& grid, int n_populations = 0)
     : kinds_{grid.kinds}, norm_{grid.norm}, n_populations_{n_populations}
@@ -30,15 +37,18 @@ struct SetupParticles
   // ----------------------------------------------------------------------
   // get_n_in_cell
   //
-  // helper function for partition / particle setup
+  // helper function for partition / particle setup. When using fractional
+  // particles per cell, the rounding decision is drawn from the rng stream
+  // for this (global) cell, so partition() and setupParticles() agree.
 
-  int get_n_in_cell(const psc_particle_npt& npt)
+  int get_n_in_cell(const psc_particle_npt& npt, const Philox4x32& rng,
+                    uint64_t cell, int pop) const
   {
     if (fractional_n_particles_per_cell) {
       int n_prts = npt.n / norm_.cori;
-      float rmndr = npt.n / norm_.cori - n_prts;
-      float ran = random() / ((float)RAND_MAX + 1);
-      if (ran < rmndr) {
+      double rmndr = npt.n / norm_.cori - n_prts;
+      auto r = rng(counter(N_IN_CELL_DRAW, cell, pop));
+      if (Philox4x32::uniform(r[0]) < rmndr) {
         n_prts++;
       }
       return n_prts;
@@ -47,48 +57,53 @@ struct SetupParticles
   }
 
   // ----------------------------------------------------------------------
-  // setupParticle
-
-  psc::particle::Inject setupParticle(const psc_particle_npt& npt, Double3 pos,
-                                      double wni)
+  // setupParticlesInCell
+  //
+  // appends n_in_cell particles with momenta drawn from the (drifting)
+  // Maxwellian given by npt. Each particle gets its own Philox block, so
+  // the Box-Muller loop is free of data dependencies and branches and can be
+  // vectorized by the compiler.
+
+  void setupParticlesInCell(const psc_particle_npt& npt, Double3 pos,
+                            double wni, const Philox4x32& rng, uint64_t cell,
+                            int pop, int n_in_cell,
+                            std::vector<psc::particle::Inject>& prts) const
   {
-    double beta = norm_.beta;
-
     assert(npt.kind >= 0 && npt.kind < kinds_.size());
     double m = kinds_[npt.kind].m;
+    double sigma[3];
+    for (int d = 0; d < 3; d++) {
+      sigma[d] = norm_.beta * std::sqrt(npt.T[d] / m);
+    }
 
-    float ran1, ran2, ran3, ran4, ran5, ran6;
-    do {
-      ran1 = random() / ((float)RAND_MAX + 1);
-      ran2 = random() / ((float)RAND_MAX + 1);
-      ran3 = random() / ((float)RAND_MAX + 1);
-      ran4 = random() / ((float)RAND_MAX + 1);
-      ran5 = random() / ((float)RAND_MAX + 1);
-      ran6 = random() / ((float)RAND_MAX + 1);
-    } while (ran1 >= 1.f || ran2 >= 1.f || ran3 >= 1.f || ran4 >= 1.f ||
-             ran5 >= 1.f || ran6 >= 1.f);
-
-    double pxi =
-      npt.p[0] + sqrtf(-2.f * npt.T[0] / m * sqr(beta) * logf(1.0 - ran1)) *
-                   cosf(2.f * M_PI * ran2);
-    double pyi =
-      npt.p[1] + sqrtf(-2.f * npt.T[1] / m * sqr(beta) * logf(1.0 - ran3)) *
-                   cosf(2.f * M_PI * ran4);
-    double pzi =
-      npt.p[2] + sqrtf(-2.f * npt.T[2] / m * sqr(beta) * logf(1.0 - ran5)) *
-                   cosf(2.f * M_PI * ran6);
-
-    if (initial_momentum_gamma_correction) {
-      double gam;
-      if (sqr(pxi) + sqr(pyi) + sqr(pzi) < 1.) {
-        gam = 1. / sqrt(1. - sqr(pxi) - sqr(pyi) - sqr(pzi));
-        pxi *= gam;
-        pyi *= gam;
-        pzi *= gam;
+    const int CHUNK = 64;
+    double u[3][CHUNK];
+    for (int n_beg = 0; n_beg < n_in_cell; n_beg += CHUNK) {
+      int n_end = std::min(n_beg + CHUNK, n_in_cell);
+      for (int n = n_beg; n < n_end; n++) {
+        auto r = rng(counter(n, cell, pop));
+        double rho1 = std::sqrt(-2. * std::log(Philox4x32::uniform(r[0])));
+        double phi1 = 2. * M_PI * Philox4x32::uniform(r[1]);
+        double rho2 = std::sqrt(-2. * std::log(Philox4x32::uniform(r[2])));
+        double phi2 = 2. * M_PI * Philox4x32::uniform(r[3]);
+        u[0][n - n_beg] = npt.p[0] + sigma[0] * rho1 * std::cos(phi1);
+        u[1][n - n_beg] = npt.p[1] + sigma[1] * rho1 * std::sin(phi1);
+        u[2][n - n_beg] = npt.p[2] + sigma[2] * rho2 * std::cos(phi2);
       }
-    }
 
-    return psc::particle::Inject{pos, {pxi, pyi, pzi}, wni, npt.kind, npt.tag};
+      for (int n = 0; n < n_end - n_beg; n++) {
+        double pxi = u[0][n], pyi = u[1][n], pzi = u[2][n];
+        if (initial_momentum_gamma_correction) {
+          if (sqr(pxi) + sqr(pyi) + sqr(pzi) < 1.) {
+            double gam = 1. / sqrt(1. - sqr(pxi) - sqr(pyi) - sqr(pzi));
+            pxi *= gam;
+            pyi *= gam;
+            pzi *= gam;
+          }
+        }
+        prts.emplace_back(pos, Double3{pxi, pyi, pzi}, wni, npt.kind, npt.tag);
+      }
+    }
   }
 
   // ----------------------------------------------------------------------
@@ -103,63 +118,62 @@ struct SetupParticles
 
   // ----------------------------------------------------------------------
   // setupParticles
+  //
+  // Patches are filled in parallel (if OpenMP is enabled). The rng streams
+  // are keyed by global cell index, so the result doesn't depend on the
+  // number of ranks / patches / threads. Newly created particles are handed
+  // to the injector in patch order, so particle ids are deterministic, too.
+  //
+  // init_npt is called concurrently from several threads, so it must be
+  // reentrant: it may only write to the npt it's given, not to shared state
+  // (and it can't use global random()).
 
   template <typename FUNC>
   void setupParticles(Mparticles& mprts, FUNC init_npt)
   {
     const auto& grid = mprts.grid();
+    auto rng = makeRng(grid);
 
-    // mprts.reserve_all(n_prts_by_patch); FIXME
+    // exact count first, so we can reserve space up front
+    std::vector<uint> n_prts_by_patch(grid.n_patches());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int p = 0; p < grid.n_patches(); ++p) {
+      forEachCellPopulation(
+        grid, p, rng, init_npt,
+        [&](const psc_particle_npt& npt, Double3 pos, uint64_t cell, int pop,
+            int n_in_cell) { n_prts_by_patch[p] += n_in_cell; });
+    }
+    reserveAdditional(mprts, n_prts_by_patch, 0);
 
     auto inj = mprts.injector();
-    for (int p = 0; p < mprts.n_patches(); ++p) {
-      auto ldims = grid.ldims;
-      auto injector = inj[p];
-
-      for (int jz = 0; jz < ldims[2]; jz++) {
-        for (int jy = 0; jy < ldims[1]; jy++) {
-          for (int jx = 0; jx < ldims[0]; jx++) {
-            Double3 pos = {grid.patches[p].x_cc(jx), grid.patches[p].y_cc(jy),
-                           grid.patches[p].z_cc(jz)};
-            // FIXME, the issue really is that (2nd order) particle pushers
-            // don't handle the invariant dim right
-            if (grid.isInvar(0) == 1)
-              pos[0] = grid.patches[p].x_nc(jx);
-            if (grid.isInvar(1) == 1)
-              pos[1] = grid.patches[p].y_nc(jy);
-            if (grid.isInvar(2) == 1)
-              pos[2] = grid.patches[p].z_nc(jz);
-
-            int n_q_in_cell = 0;
-            for (int pop = 0; pop < n_populations_; pop++) {
-              psc_particle_npt npt{};
-              if (pop < kinds_.size()) {
-                npt.kind = pop;
-              }
-              init_npt(pop, pos, p, {jx, jy, jz}, npt);
-
-              int n_in_cell;
-              if (pop != neutralizing_population) {
-                n_in_cell = get_n_in_cell(npt);
-                n_q_in_cell += kinds_[npt.kind].q * n_in_cell;
-              } else {
-                // FIXME, should handle the case where not the last population
-                // is neutralizing
-                assert(neutralizing_population == n_populations_ - 1);
-                n_in_cell = -n_q_in_cell / kinds_[npt.kind].q;
-              }
-              for (int cnt = 0; cnt < n_in_cell; cnt++) {
-                real_t wni;
-                if (fractional_n_particles_per_cell) {
-                  wni = 1.;
-                } else {
-                  wni = npt.n / (n_in_cell * norm_.cori);
-                }
-                auto prt = setupParticle(npt, pos, wni);
-                injector(prt);
-              }
-            }
+#ifdef _OPENMP
+#pragma omp parallel for ordered schedule(static, 1)
+#endif
+    for (int p = 0; p < grid.n_patches(); ++p) {
+      std::vector<psc::particle::Inject> prts;
+      prts.reserve(n_prts_by_patch[p]);
+      forEachCellPopulation(
+        grid, p, rng, init_npt,
+        [&](const psc_particle_npt& npt, Double3 pos, uint64_t cell, int pop,
+            int n_in_cell) {
+          double wni;
+          if (fractional_n_particles_per_cell) {
+            wni = 1.;
+          } else {
+            wni = npt.n / (n_in_cell * norm_.cori);
           }
+          setupParticlesInCell(npt, pos, wni, rng, cell, pop, n_in_cell, prts);
+        });
+
+#ifdef _OPENMP
+#pragma omp ordered
+#endif
+      {
+        auto injector = inj[p];
+        for (const auto& prt : prts) {
+          injector(prt);
         }
       }
     }
@@ -167,52 +181,26 @@ struct SetupParticles
 
   // ----------------------------------------------------------------------
   // partition
+  //
+  // like setupParticles(), calls init_npt from several threads at once
 
   template <typename FUNC>
   std::vector<uint> partition(const Grid_t& grid, FUNC init_npt)
   {
     std::vector<uint> n_prts_by_patch(grid.n_patches());
+    auto rng = makeRng(grid);
 
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
     for (int p = 0; p < grid.n_patches(); ++p) {
-      auto ilo = Int3{}, ihi = grid.ldims;
-
-      for (int jz = ilo[2]; jz < ihi[2]; jz++) {
-        for (int jy = ilo[1]; jy < ihi[1]; jy++) {
-          for (int jx = ilo[0]; jx < ihi[0]; jx++) {
-            Double3 pos = {grid.patches[p].x_cc(jx), grid.patches[p].y_cc(jy),
-                           grid.patches[p].z_cc(jz)};
-            // FIXME, the issue really is that (2nd order) particle pushers
-            // don't handle the invariant dim right
-            if (grid.isInvar(0) == 1)
-              pos[0] = grid.patches[p].x_nc(jx);
-            if (grid.isInvar(1) == 1)
-              pos[1] = grid.patches[p].y_nc(jy);
-            if (grid.isInvar(2) == 1)
-              pos[2] = grid.patches[p].z_nc(jz);
-
-            int n_q_in_cell = 0;
-            for (int pop = 0; pop < n_populations_; pop++) {
-              psc_particle_npt npt{};
-              if (pop < kinds_.size()) {
-                npt.kind = pop;
-              };
-              init_npt(pop, pos, npt);
-
-              int n_in_cell;
-              if (pop != neutralizing_population) {
-                n_in_cell = get_n_in_cell(npt);
-                n_q_in_cell += kinds_[npt.kind].q * n_in_cell;
-              } else {
-                // FIXME, should handle the case where not the last population
-                // is neutralizing
-                assert(neutralizing_population == n_populations_ - 1);
-                n_in_cell = -n_q_in_cell / kinds_[npt.kind].q;
-              }
-              n_prts_by_patch[p] += n_in_cell;
-            }
-          }
-        }
-      }
+      forEachCellPopulation(
+        grid, p, rng,
+        [&](int pop, Double3 pos, int p, Int3 idx, psc_particle_npt& npt) {
+          init_npt(pop, pos, npt);
+        },
+        [&](const psc_particle_npt& npt, Double3 pos, uint64_t cell, int pop,
+            int n_in_cell) { n_prts_by_patch[p] += n_in_cell; });
     }
 
     return n_prts_by_patch;
@@ -223,8 +211,102 @@ struct SetupParticles
   int neutralizing_population = {-1};
   bool fractional_n_particles_per_cell = {false};
   bool initial_momentum_gamma_correction = {false};
+  // combined with the timestep to key the rng streams, change it to get a
+  // different realization of the same initial condition
+  uint32_t seed = {0};
 
 private:
+  // counter slot used for the fractional n_in_cell draw, particles in a cell
+  // use slots 0, 1, ...
+  static const uint32_t N_IN_CELL_DRAW = 0xffffffff;
+
+  static Philox4x32::Counter counter(uint32_t n, uint64_t cell, int pop)
+  {
+    return {n, uint32_t(pop), uint32_t(cell), uint32_t(cell >> 32)};
+  }
+
+  Philox4x32 makeRng(const Grid_t& grid) const
+  {
+    return Philox4x32{(uint64_t(seed) << 32) | uint32_t(grid.timestep())};
+  }
+
+  // ----------------------------------------------------------------------
+  // forEachCellPopulation
+  //
+  // calls init_npt for every cell / population in patch p, and passes the
+  // result on to func, together with the global cell index and the number of
+  // particles to create
+
+  template <typename INIT_NPT, typename FUNC>
+  void forEachCellPopulation(const Grid_t& grid, int p, const Philox4x32& rng,
+                             INIT_NPT&& init_npt, FUNC&& func) const
+  {
+    const auto& patch = grid.patches[p];
+    const auto& gdims = grid.domain.gdims;
+    auto ldims = grid.ldims;
+
+    for (int jz = 0; jz < ldims[2]; jz++) {
+      for (int jy = 0; jy < ldims[1]; jy++) {
+        for (int jx = 0; jx < ldims[0]; jx++) {
+          Double3 pos = {patch.x_cc(jx), patch.y_cc(jy), patch.z_cc(jz)};
+          // FIXME, the issue really is that (2nd order) particle pushers
+          // don't handle the invariant dim right
+          if (grid.isInvar(0) == 1)
+            pos[0] = patch.x_nc(jx);
+          if (grid.isInvar(1) == 1)
+            pos[1] = patch.y_nc(jy);
+          if (grid.isInvar(2) == 1)
+            pos[2] = patch.z_nc(jz);
+
+          uint64_t cell =
+            (uint64_t(patch.off[2] + jz) * gdims[1] + (patch.off[1] + jy)) *
+              gdims[0] +
+            (patch.off[0] + jx);
+
+          int n_q_in_cell = 0;
+          for (int pop = 0; pop < n_populations_; pop++) {
+            psc_particle_npt npt{};
+            if (pop < int(kinds_.size())) {
+              npt.kind = pop;
+            }
+            init_npt(pop, pos, p, {jx, jy, jz}, npt);
+
+            int n_in_cell;
+            if (pop != neutralizing_population) {
+              n_in_cell = get_n_in_cell(npt, rng, cell, pop);
+              n_q_in_cell += kinds_[npt.kind].q * n_in_cell;
+            } else {
+              // FIXME, should handle the case where not the last population
+              // is neutralizing
+              assert(neutralizing_population == n_populations_ - 1);
+              n_in_cell = -n_q_in_cell / kinds_[npt.kind].q;
+            }
+            func(npt, pos, cell, pop, n_in_cell);
+          }
+        }
+      }
+    }
+  }
+
+  // reserve space for the particles about to be added, if the particle
+  // storage supports it
+  template <typename Mprts>
+  static auto reserveAdditional(Mprts& mprts,
+                                const std::vector<uint>& n_prts_by_patch, int)
+    -> decltype(mprts.reserve_all(n_prts_by_patch), void())
+  {
+    auto n_prts_total = mprts.sizeByPatch();
+    for (int p = 0; p < int(n_prts_total.size()); p++) {
+      n_prts_total[p] += n_prts_by_patch[p];
+    }
+    mprts.reserve_all(n_prts_total);
+  }
+
+  template <typename Mprts>
+  static void reserveAdditional(Mprts& mprts,
+                                const std::vector<uint>& n_prts_by_patch, long)
+  {}
+
   const Grid_t::Kinds kinds_;
   const Grid_t::Normalization norm_;
   int n_populations_;
@@ -26,6 +26,12 @@ struct mrc_domain *mrc_ddc_get_domain(struct mrc_ddc *ddc);
 void mrc_ddc_setup(struct mrc_ddc *ddc);
 void mrc_ddc_destroy(struct mrc_ddc *ddc);
 void mrc_ddc_fill_ghosts_fld(struct mrc_ddc *ddc, int mb, int me, struct mrc_fld *fld);
+// split version of the above, so that work that doesn't need the ghost points
+// can be done while the communication is in progress. Between _begin() and
+// _end(), the ghost points of fld are undefined and its interior must not be
+// modified.
+void mrc_ddc_fill_ghosts_fld_begin(struct mrc_ddc *ddc, int mb, int me, struct mrc_fld *fld);
+void mrc_ddc_fill_ghosts_fld_end(struct mrc_ddc *ddc, int mb, int me, struct mrc_fld *fld);
 
 // FIXME: I have to have these for MB, but they don't really make sense for anything else
 void mrc_ddc_global_to_local_fld(struct mrc_ddc *ddc, struct mrc_fld *gfld, struct mrc_fld *lfld);
@@ -32,6 +32,11 @@ struct mrc_ddc_ops {
   struct mrc_domain *(*get_domain)(struct mrc_ddc *ddc);
   void (*fill_ghosts_fld)(struct mrc_ddc *ddc, int mb, int me,
 			  struct mrc_fld *fld);
+  // optional, otherwise _begin() does the whole fill_ghosts_fld()
+  void (*fill_ghosts_fld_begin)(struct mrc_ddc *ddc, int mb, int me,
+				struct mrc_fld *fld);
+  void (*fill_ghosts_fld_end)(struct mrc_ddc *ddc, int mb, int me,
+			      struct mrc_fld *fld);
   // FIXME: Needed for MB and nothing else!
   void (*global_to_local_fld)(struct mrc_ddc *ddc, struct mrc_fld *gfld,
 			      struct mrc_fld *lfld);
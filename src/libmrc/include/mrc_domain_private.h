@@ -85,6 +85,9 @@ void sfc_destroy(struct mrc_sfc *sfc);
 int  sfc_idx3_to_idx(struct mrc_sfc *sfc, const int p[3]);
 void sfc_idx_to_idx3(struct mrc_sfc *sfc, int idx, int p[3]);
 
+void gpatch_off_find_rank_patch(const int *gpatch_off_all, int size, int gpatch,
+				int *rank, int *patch);
+
 // ======================================================================
 // mrc_domain_multi
 
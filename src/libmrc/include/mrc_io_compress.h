@@ -0,0 +1,40 @@
+#ifndef MRC_IO_COMPRESS_H
+#define MRC_IO_COMPRESS_H
+
+#include <mrc.h>
+
+#include <hdf5.h>
+#include <stddef.h>
+
+BEGIN_C_DECLS
+
+// ======================================================================
+// optional compression of HDF5 output
+//
+// compression is one of "deflate", "lz4", "zstd", or NULL / "none" to write
+// uncompressed. The dataset gets chunked as given (typically, one chunk per
+// writer), byte-shuffled and compressed by the corresponding HDF5 filter.
+// LZ4 and zstd need the HDF5 filter plugins (found via HDF5_PLUGIN_PATH);
+// without them, deflate is used instead. Returns H5P_DEFAULT if the dataset
+// won't be compressed, otherwise a dcpl that the caller needs to close.
+//
+// With parallel HDF5, filters need HDF5 >= 1.10.2 and collective writes.
+
+hid_t mrc_io_compress_dcpl(const char *compression, int level, int rank,
+			   const hsize_t *dims, const hsize_t *chunk,
+			   size_t type_size);
+
+// ----------------------------------------------------------------------
+// mrc_io_quantize
+//
+// rounds the n values in arr (of type MRC_NT_FLOAT / MRC_NT_DOUBLE) to
+// multiples of the largest power of two q <= 2 * eps, so the absolute error
+// is at most eps, while the low mantissa bits become zero and compress well
+// after shuffling. Returns the actual error bound, q / 2 (0 if nothing was
+// done).
+
+double mrc_io_quantize(void *arr, size_t n, int data_type, double eps);
+
+END_C_DECLS
+
+#endif
@@ -58,6 +58,15 @@ struct mrc_mat_csr {
   int _nr_rows_alloced;  // probably used for asserts
   int _nr_vals_alloced;  // probably used for asserts
 
+  // these are set up by assemble to let apply skip rows that don't need work:
+  // rows that aren't just x[row] = x[row] (skipped when applying in place),
+  // and rows that aren't empty (skipped when adding to y in place)
+  int *_nonid_rows;
+  int nr_nonid_rows;
+  bool _nonid_rows_independent; // no non-identity row reads another one's result
+  int *_nonempty_rows;
+  int nr_nonempty_rows;
+
   bool verbose;
   int nr_initial_cols;  // how much initial space to allocate for each new row
   float growth_factor;  // fraction of current # of cols to add when a row needs to grow
@@ -71,6 +71,7 @@ prof_stop(int pr)
 
 EXTERN_C void prof_init(void);
 EXTERN_C int  prof_register(const char *name, float simd, int flops, int bytes);
+EXTERN_C int  prof_find(const char *name);
 EXTERN_C void prof_print(void);
 EXTERN_C void prof_print_file(FILE *f);
 EXTERN_C void prof_print_mpi(MPI_Comm comm);
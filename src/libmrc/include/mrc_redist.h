@@ -56,17 +56,25 @@ struct mrc_redist {
   int slab_dims[3];
   int slab_offs[3];
 
-  int slow_dim;
-  int slow_indices_per_writer;
-  int slow_indices_rmndr;
+  int writer_np[3]; // writers along each dimension
 
   struct mrc_redist_write_send write_send;
   struct mrc_redist_write_recv write_recv;
 };
 
+int mrc_redist_nr_nodes(MPI_Comm comm);
+void mrc_redist_place_writers(int size, const int *node_of_rank, int nr_nodes,
+			      int nr_writers, int *writer_ranks);
+void mrc_redist_select_writers(MPI_Comm comm, int nr_writers, int *writer_ranks);
+int mrc_redist_auto_nr_writers(double bytes, int mb_per_writer, int max_writers);
+void mrc_redist_decompose(int nr_writers, const int gdims[3], const int slab_dims[3],
+			  int writer_np[3]);
 void mrc_redist_init(struct mrc_redist *redist, struct mrc_domain *domain,
-		     int slab_offs[3], int slab_dims[3], int nr_writers);
+		     int slab_offs[3], int slab_dims[3], int nr_writers,
+		     const int *writer_ranks);
 void mrc_redist_destroy(struct mrc_redist *redist);
+void mrc_redist_writer_offs_dims(struct mrc_redist *redist, int writer,
+				 int *writer_offs, int *writer_dims);
 struct mrc_ndarray *mrc_redist_get_ndarray(struct mrc_redist *redist, struct mrc_fld *m3);
 void mrc_redist_put_ndarray(struct mrc_redist *redist, struct mrc_ndarray *nd);
 void mrc_redist_run(struct mrc_redist *redist, struct mrc_ndarray *nd,
@@ -15,6 +15,8 @@
 MRC_CLASS_DECLARE(ggcm_mhd, struct ggcm_mhd);
 
 void ggcm_mhd_fill_ghosts(struct ggcm_mhd *mhd, struct mrc_fld *fld, float bntim);
+void ggcm_mhd_fill_ghosts_begin(struct ggcm_mhd *mhd, struct mrc_fld *fld, float bntim);
+void ggcm_mhd_fill_ghosts_end(struct ggcm_mhd *mhd, struct mrc_fld *fld, float bntim);
 void ggcm_mhd_fill_ghosts_E(struct ggcm_mhd *mhd, struct mrc_fld *E);
 void ggcm_mhd_fill_ghosts_reconstr(struct ggcm_mhd *mhd, struct mrc_fld *U_l[],
 				   struct mrc_fld *U_r[], int p);
@@ -321,6 +321,36 @@ ggcm_mhd_fill_ghosts(struct ggcm_mhd *mhd, struct mrc_fld *fld, float bntim_code
   ggcm_mhd_bnd_fill_ghosts(mhd->bnd1, fld, bntim);
 }
 
+// ----------------------------------------------------------------------
+// ggcm_mhd_fill_ghosts_begin / _end
+//
+// same as ggcm_mhd_fill_ghosts(), but split so that the caller can do work
+// on the interior while the ghost points are being communicated.
+// The boundary conditions are applied in _end().
+
+void
+ggcm_mhd_fill_ghosts_begin(struct ggcm_mhd *mhd, struct mrc_fld *fld, float bntim_code)
+{
+  if (mhd->amr == 0) {
+    int nr_comps = mrc_fld_nr_comps(fld);
+    mrc_ddc_fill_ghosts_fld_begin(mrc_domain_get_ddc(mhd->domain), 0, nr_comps, fld);
+  } else {
+    mrc_ddc_amr_apply(mhd->ddc_amr_cc, fld);
+  }
+}
+
+void
+ggcm_mhd_fill_ghosts_end(struct ggcm_mhd *mhd, struct mrc_fld *fld, float bntim_code)
+{
+  float bntim = bntim_code * mhd->tnorm;
+  if (mhd->amr == 0) {
+    int nr_comps = mrc_fld_nr_comps(fld);
+    mrc_ddc_fill_ghosts_fld_end(mrc_domain_get_ddc(mhd->domain), 0, nr_comps, fld);
+  }
+  ggcm_mhd_bnd_fill_ghosts(mhd->bnd, fld, bntim);
+  ggcm_mhd_bnd_fill_ghosts(mhd->bnd1, fld, bntim);
+}
+
 void
 ggcm_mhd_fill_ghosts_E(struct ggcm_mhd *mhd, struct mrc_fld *E)
 {
@@ -19,6 +19,7 @@
 #include "pde/pde_mhd_convert.c"
 #include "pde/pde_mhd_reconstruct.c"
 #include "pde/pde_mhd_riemann.c"
+#include "pde/pde_mhd_pencil.c"
 #include "pde/pde_mhd_pushfluid.c"
 #include "pde/pde_mhd_push_ej.c"
 #include "pde/pde_mhd_rmaskn.c"
@@ -44,6 +45,9 @@ struct ggcm_mhd_step_c3 {
   struct mrc_fld *f_Uhalf;
   struct mrc_fld *f_F[3];
   struct mrc_fld *f_E;
+
+  bool pencils; // use pencil (multi-line) predictor, if supported (experimental)
+  bool overlap_ghosts; // find interior fluxes while filling ghost points
 };
 
 #define ggcm_mhd_step_c3(step) mrc_to_subobj(step, struct ggcm_mhd_step_c3)
@@ -56,8 +60,48 @@ struct ggcm_mhd_step_c3 {
 #define REPS (1.e-10f)
 
 // 1-d state vars statically rather than having to pass them around
+// (one set per thread, set up on first use, together with this thread's
+// s_aux)
+
+static PDE_THREAD_LOCAL fld1d_state_t l_U, l_Ul, l_Ur, l_W, l_Wl, l_Wr, l_F;
+
+static void
+line_setup()
+{
+  pde_mhd_aux_setup();
+  if (fld1d_state_is_setup(l_U)) {
+    return;
+  }
+
+  fld1d_state_setup(&l_U);
+  fld1d_state_setup(&l_Ul);
+  fld1d_state_setup(&l_Ur);
+  fld1d_state_setup(&l_W);
+  fld1d_state_setup(&l_Wl);
+  fld1d_state_setup(&l_Wr);
+  fld1d_state_setup(&l_F);
+}
+
+// same for pencils of PDE_PENCIL_N lines
+
+static PDE_THREAD_LOCAL fld1d_pencil_t t_U, t_Ul, t_Ur, t_W, t_Wl, t_Wr, t_F;
+
+static void
+pencil_setup()
+{
+  pde_mhd_aux_setup();
+  if (fld1d_pencil_is_setup(t_U)) {
+    return;
+  }
 
-static fld1d_state_t l_U, l_Ul, l_Ur, l_W, l_Wl, l_Wr, l_F;
+  fld1d_pencil_setup(&t_U);
+  fld1d_pencil_setup(&t_Ul);
+  fld1d_pencil_setup(&t_Ur);
+  fld1d_pencil_setup(&t_W);
+  fld1d_pencil_setup(&t_Wl);
+  fld1d_pencil_setup(&t_Wr);
+  fld1d_pencil_setup(&t_F);
+}
 
 // ----------------------------------------------------------------------
 // ggcm_mhd_step_c3_setup_flds
@@ -87,14 +131,6 @@ ggcm_mhd_step_c3_setup(struct ggcm_mhd_step *step)
   pde_mhd_setup(mhd, 5);
   pde_mhd_compat_setup(mhd);
 
-  fld1d_state_setup(&l_U);
-  fld1d_state_setup(&l_Ul);
-  fld1d_state_setup(&l_Ur);
-  fld1d_state_setup(&l_W);
-  fld1d_state_setup(&l_Wl);
-  fld1d_state_setup(&l_Wr);
-  fld1d_state_setup(&l_F);
-
   if (s_opt_background) {
     mhd->b0 = ggcm_mhd_get_3d_fld(mhd, 3);
   }
@@ -155,20 +191,63 @@ ggcm_mhd_step_c3_get_dt(struct ggcm_mhd_step *step, struct mrc_fld *x)
 // ======================================================================
 // (hydro) predictor
 
+// ----------------------------------------------------------------------
+// patch_flux_pred_pencil
+//
+// same as the line-by-line version below, but PDE_PENCIL_N lines at a time
+
+static void
+patch_flux_pred_pencil(struct ggcm_mhd_step *step, fld3d_t p_F[3], fld3d_t p_U,
+		       int part)
+{
+  pencil_setup();
+
+  pde_for_each_dir(dir) {
+    int fb[2], fe[2];
+    int n_ranges = pde_line_face_ranges(dir, 1, part, fb, fe);
+    pde_for_each_pencil(dir, j, k, n_lines, 0) {
+      for (int r = 0; r < n_ranges; r++) {
+	int ib = fb[r], ie = fe[r] - 1;
+	mhd_pencil_get_state_scons(t_U, p_U, j, k, n_lines, dir, ib - 1, ie + 1);
+	mhd_pencil_prim_from_scons(t_W, t_U, n_lines, ib - 1, ie + 1);
+	mhd_pencil_reconstruct(t_Ul, t_Ur, t_Wl, t_Wr, t_W, n_lines, ib, ie + 1);
+	mhd_pencil_riemann(t_F, t_Ul, t_Ur, t_Wl, t_Wr, n_lines, ib, ie + 1);
+	mhd_pencil_put_state_scons(t_F, p_F[dir], j, k, n_lines, dir, ib, ie + 1);
+      }
+    }
+  }
+}
+
 // ----------------------------------------------------------------------
 // patch_flux_pred
+//
+// part selects which faces to do (PDE_FACES_*), the stencil is one cell to
+// either side
 
 static void
-patch_flux_pred(struct ggcm_mhd_step *step, fld3d_t p_F[3], fld3d_t p_U)
+patch_flux_pred(struct ggcm_mhd_step *step, fld3d_t p_F[3], fld3d_t p_U, int part)
 {
+  struct ggcm_mhd_step_c3 *sub = ggcm_mhd_step_c3(step);
+
+  if (sub->pencils && mhd_pencil_is_supported()) {
+    patch_flux_pred_pencil(step, p_F, p_U, part);
+    return;
+  }
+
+  line_setup();
+
   pde_for_each_dir(dir) {
+    int fb[2], fe[2];
+    int n_ranges = pde_line_face_ranges(dir, 1, part, fb, fe);
     pde_for_each_line(dir, j, k, 0) {
-      int ib = 0, ie = s_ldims[dir];
-      mhd_line_get_state(l_U, p_U, j, k, dir, ib - 1, ie + 1);
-      mhd_prim_from_cons(l_W, l_U, ib - 1, ie + 1);
-      mhd_reconstruct(l_Ul, l_Ur, l_Wl, l_Wr, l_W, (fld1d_t) {}, ib, ie + 1);
-      mhd_riemann(l_F, l_Ul, l_Ur, l_Wl, l_Wr, ib, ie + 1);
-      mhd_line_put_state(l_F, p_F[dir], j, k, dir, ib, ie + 1);
+      for (int r = 0; r < n_ranges; r++) {
+	int ib = fb[r], ie = fe[r] - 1;
+	mhd_line_get_state(l_U, p_U, j, k, dir, ib - 1, ie + 1);
+	mhd_prim_from_cons(l_W, l_U, ib - 1, ie + 1);
+	mhd_reconstruct(l_Ul, l_Ur, l_Wl, l_Wr, l_W, (fld1d_t) {}, ib, ie + 1);
+	mhd_riemann(l_F, l_Ul, l_Ur, l_Wl, l_Wr, ib, ie + 1);
+	mhd_line_put_state(l_F, p_F[dir], j, k, dir, ib, ie + 1);
+      }
     }
   }
 }
@@ -212,7 +291,7 @@ static void
 line_flux_corr(fld3d_t p_F, fld3d_t p_U,
 	       int j, int k, int dir, int ib, int ie)
 {
-  static fld1d_state_t l_Fcc, l_Flo, l_lim1;
+  static PDE_THREAD_LOCAL fld1d_state_t l_Fcc, l_Flo, l_lim1;
   if (!fld1d_state_is_setup(l_Fcc)) {
     fld1d_state_setup(&l_Fcc);
     fld1d_state_setup(&l_Flo);
@@ -254,24 +333,45 @@ line_flux_corr(fld3d_t p_F, fld3d_t p_U,
 
 // ----------------------------------------------------------------------
 // patch_flux_corr
+//
+// like patch_flux_pred(), but the stencil is two cells to either side
 
 static void
-patch_flux_corr(struct ggcm_mhd_step *step, fld3d_t p_F[3], fld3d_t p_U)
+patch_flux_corr(struct ggcm_mhd_step *step, fld3d_t p_F[3], fld3d_t p_U, int part)
 {
+  line_setup();
+
   pde_for_each_dir(dir) {
+    int fb[2], fe[2];
+    int n_ranges = pde_line_face_ranges(dir, 2, part, fb, fe);
     pde_for_each_line(dir, j, k, 0) {
-      int ib = 0, ie = s_ldims[dir];
-      line_flux_corr(p_F[dir], p_U, j, k, dir, ib, ie);
+      for (int r = 0; r < n_ranges; r++) {
+	line_flux_corr(p_F[dir], p_U, j, k, dir, fb[r], fe[r] - 1);
+      }
     }
   }
 }
 
+// ----------------------------------------------------------------------
+// patch_flux
+
+static void
+patch_flux(struct ggcm_mhd_step *step, fld3d_t p_F[3], fld3d_t p_U, bool limit,
+	   int part)
+{
+  if (limit) {
+    patch_flux_corr(step, p_F, p_U, part);
+  } else {
+    patch_flux_pred(step, p_F, p_U, part);
+  }
+}
+
 // ----------------------------------------------------------------------
 // patch_pushstage_pt1
 
 static void
 patch_pushstage_pt1(struct ggcm_mhd_step *step, fld3d_t p_Ucurr, fld3d_t p_W,
-		    fld3d_t p_F[3], bool limit, int p)
+		    fld3d_t p_F[3], bool limit, int part, int p)
 {
   // primvar, badval
   patch_prim_from_cons(p_W, p_Ucurr, 2);
@@ -279,11 +379,7 @@ patch_pushstage_pt1(struct ggcm_mhd_step *step, fld3d_t p_Ucurr, fld3d_t p_W,
   
   // find hydro fluxes
   // FIXME: we could use the fact that we calculate primitive variables already
-  if (limit) {
-    patch_flux_corr(step, p_F, p_Ucurr);
-  } else {
-    patch_flux_pred(step, p_F, p_Ucurr);
-  }
+  patch_flux(step, p_F, p_Ucurr, limit, part);
 }
 
 // ----------------------------------------------------------------------
@@ -315,36 +411,63 @@ patch_pushstage_pt2(struct ggcm_mhd_step *step, fld3d_t p_Unext, mrc_fld_data_t
 
 // ----------------------------------------------------------------------
 // pushstage
+//
+// The patch loops run in parallel (if OpenMP is enabled), so the fld3d_t
+// handles are set up per patch inside each loop, and all scratch used by
+// the patch_*() functions is per thread (PDE_THREAD_LOCAL).
+//
+// This also fills the ghost points of f_Ucurr. With overlap_ghosts, the
+// hydro fluxes that only depend on interior cells are found while that
+// communication is in progress.
 
 static void
 pushstage(struct ggcm_mhd_step *step, struct mrc_fld *f_Unext,
 	  mrc_fld_data_t dt, struct mrc_fld *f_Ucurr, struct mrc_fld *f_W,
-	  int stage)
+	  int stage, float time_curr)
 {
   struct ggcm_mhd_step_c3 *sub = ggcm_mhd_step_c3(step);
   struct ggcm_mhd *mhd = step->mhd;
 
-  fld3d_t p_Unext, p_Ucurr, p_W, p_ymask, p_zmask, p_rmask;
-  fld3d_t p_F[3], p_E;
-  fld3d_setup(&p_Unext, f_Unext);
-  fld3d_setup(&p_Ucurr, f_Ucurr);
-  fld3d_setup(&p_W    , f_W);
-  fld3d_setup(&p_ymask, mhd->ymask);
-  fld3d_setup(&p_zmask, sub->f_zmask);
-  fld3d_setup(&p_rmask, sub->f_rmask);
-  for (int d = 0; d < 3; d++) {
-    fld3d_setup(&p_F[d], sub->f_F[d]);
-  }
-  fld3d_setup(&p_E, sub->f_E);
   pde_mhd_p_aux_setup_b0(mhd->b0);
 
   bool limit = stage != 0 && s_mhd_time > s_timelo;
+  int part = PDE_FACES_ALL;
+
+  if (sub->overlap_ghosts) {
+    ggcm_mhd_fill_ghosts_begin(mhd, f_Ucurr, time_curr);
+
+    // interior hydro fluxes
+    pde_for_each_patch_parallel(p) {
+      fld3d_t p_Ucurr, p_F[3];
+      fld3d_setup(&p_Ucurr, f_Ucurr);
+      for (int d = 0; d < 3; d++) {
+	fld3d_setup(&p_F[d], sub->f_F[d]);
+      }
+
+      fld3d_t *patches[] = { &p_Ucurr, &p_F[0], &p_F[1], &p_F[2], NULL };
+      fld3d_get_list(p, patches);
+      patch_flux(step, p_F, p_Ucurr, limit, PDE_FACES_INTERIOR);
+      fld3d_put_list(p, patches);
+    }
+
+    ggcm_mhd_fill_ghosts_end(mhd, f_Ucurr, time_curr);
+    part = PDE_FACES_BOUNDARY;
+  } else {
+    ggcm_mhd_fill_ghosts(mhd, f_Ucurr, time_curr);
+  }
 
   // primvar, badval, reconstruct
-  pde_for_each_patch(p) {
+  pde_for_each_patch_parallel(p) {
+    fld3d_t p_Ucurr, p_W, p_F[3];
+    fld3d_setup(&p_Ucurr, f_Ucurr);
+    fld3d_setup(&p_W    , f_W);
+    for (int d = 0; d < 3; d++) {
+      fld3d_setup(&p_F[d], sub->f_F[d]);
+    }
+
     fld3d_t *patches[] = { &p_Ucurr, &p_W, &p_F[0], &p_F[1], &p_F[2], NULL };
     fld3d_get_list(p, patches);
-    patch_pushstage_pt1(step, p_Ucurr, p_W, p_F, limit, p);
+    patch_pushstage_pt1(step, p_Ucurr, p_W, p_F, limit, part, p);
     fld3d_put_list(p, patches);
   }
 
@@ -352,7 +475,20 @@ pushstage(struct ggcm_mhd_step *step, struct mrc_fld *f_Unext,
   ggcm_mhd_correct_fluxes(mhd, sub->f_F);
 
   // add MHD terms, find E
-  pde_for_each_patch(p) {
+  pde_for_each_patch_parallel(p) {
+    fld3d_t p_Unext, p_Ucurr, p_W, p_ymask, p_zmask, p_rmask;
+    fld3d_t p_F[3], p_E;
+    fld3d_setup(&p_Unext, f_Unext);
+    fld3d_setup(&p_Ucurr, f_Ucurr);
+    fld3d_setup(&p_W    , f_W);
+    fld3d_setup(&p_ymask, mhd->ymask);
+    fld3d_setup(&p_zmask, sub->f_zmask);
+    fld3d_setup(&p_rmask, sub->f_rmask);
+    for (int d = 0; d < 3; d++) {
+      fld3d_setup(&p_F[d], sub->f_F[d]);
+    }
+    fld3d_setup(&p_E, sub->f_E);
+
     fld3d_t *mhd_patches[] = { &p_Unext, &p_Ucurr, &p_W, 
 			       &p_E, &p_F[0], &p_F[1], &p_F[2],
 			       &p_ymask, &p_zmask, &p_rmask, NULL };
@@ -370,7 +506,11 @@ pushstage(struct ggcm_mhd_step *step, struct mrc_fld *f_Unext,
   // correct E field
   ggcm_mhd_correct_E(mhd, sub->f_E);
 
-  pde_for_each_patch(p) {
+  pde_for_each_patch_parallel(p) {
+    fld3d_t p_Unext, p_E;
+    fld3d_setup(&p_Unext, f_Unext);
+    fld3d_setup(&p_E, sub->f_E);
+
     fld3d_t *update_ct_patches[] = { &p_Unext, &p_E, NULL };
 
     fld3d_get_list(p, update_ct_patches);
@@ -395,12 +535,11 @@ ggcm_mhd_step_c3_run(struct ggcm_mhd_step *step, struct mrc_fld *f_U)
 
   // set f_Uhalf = f_U
   mrc_fld_copy(f_Uhalf, f_U);
-  ggcm_mhd_fill_ghosts(mhd, f_U, mhd->time_code);
-  pushstage(step, f_Uhalf, .5f * mhd->dt_code, f_U, f_W, 0);
+  pushstage(step, f_Uhalf, .5f * mhd->dt_code, f_U, f_W, 0, mhd->time_code);
 
   // f_U += dt * rhs(f_Uhalf)
-  ggcm_mhd_fill_ghosts(mhd, f_Uhalf, mhd->time_code + .5 * mhd->dt_code);
-  pushstage(step, f_U, mhd->dt_code, f_Uhalf, f_W, 1);
+  pushstage(step, f_U, mhd->dt_code, f_Uhalf, f_W, 1,
+	    mhd->time_code + .5 * mhd->dt_code);
 }
 
 // ----------------------------------------------------------------------
@@ -495,6 +634,8 @@ static struct param ggcm_mhd_step_c3_descr[] = {
 								  opt_mhd_descr)                },
   { "mhd_bpush1"         , VAR(opt.mhd_bpush1)     , PARAM_SELECT(OPT_MHD_C,
 								  opt_mhd_descr)                },
+  { "pencils"            , VAR(pencils)            , PARAM_BOOL(false)                          },
+  { "overlap_ghosts"     , VAR(overlap_ghosts)     , PARAM_BOOL(false)                          },
   
   {},
 };
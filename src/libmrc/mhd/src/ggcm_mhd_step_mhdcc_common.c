@@ -62,6 +62,8 @@ struct ggcm_mhd_step_mhdcc {
 
   struct mrc_fld *fluxes[3];
   struct mrc_fld *Ul[3], *Ur[3];
+
+  bool overlap_ghosts; // find interior fluxes while filling ghost points
 };
 
 #define ggcm_mhd_step_mhdcc(step) mrc_to_subobj(step, struct ggcm_mhd_step_mhdcc)
@@ -200,8 +202,35 @@ mhd_flux_pt2(struct ggcm_mhd_step *step, fld3d_t flux, fld3d_t x,
   mhd_line_put_state(F, flux, j, k, dir, ib, ie + 1);
 }
 
+// ----------------------------------------------------------------------
+// patch_flux
+//
+// part selects which faces to do (PDE_FACES_*), the stencil is two cells to
+// either side (see mhd_flux_pt1())
+
+static void
+patch_flux(struct ggcm_mhd_step *step, fld3d_t fluxes[3], fld3d_t x, int part)
+{
+  pde_for_each_dir(dir) {
+    int fb[2], fe[2];
+    int n_ranges = pde_line_face_ranges(dir, 2, part, fb, fe);
+    pde_for_each_line(dir, j, k, 0) {
+      for (int r = 0; r < n_ranges; r++) {
+	int ib = fb[r], ie = fe[r] - 1;
+	mhd_flux_pt1(step, x, j, k, dir, ib, ie);
+	mhd_flux_pt2(step, fluxes[dir], x, j, k, dir, ib, ie);
+      }
+    }
+  }
+}
+
 // ----------------------------------------------------------------------
 // pushstage_c
+//
+// This also fills the ghost points of x_curr. With overlap_ghosts, the fluxes
+// that only depend on interior cells are found while that communication is
+// in progress. That's not done when the current is needed (its stencil
+// reaches across lines) or with bc_reconstruct.
 
 static void
 pushstage_c(struct ggcm_mhd_step *step, mrc_fld_data_t dt, mrc_fld_data_t time_curr,
@@ -210,8 +239,6 @@ pushstage_c(struct ggcm_mhd_step *step, mrc_fld_data_t dt, mrc_fld_data_t time_c
   struct ggcm_mhd_step_mhdcc *sub = ggcm_mhd_step_mhdcc(step);
   struct ggcm_mhd *mhd = step->mhd;
 
-  ggcm_mhd_fill_ghosts(mhd, x_curr, time_curr);
-
   fld3d_t x, _x_next, ymask, fluxes[3];
   fld3d_setup(&x, x_curr);
   fld3d_setup(&_x_next, x_next);
@@ -219,6 +246,33 @@ pushstage_c(struct ggcm_mhd_step *step, mrc_fld_data_t dt, mrc_fld_data_t time_c
   for (int d = 0; d < 3; d++) {
     fld3d_setup(&fluxes[d], sub->fluxes[d]);
   }
+  pde_mhd_p_aux_setup_b0(step->mhd->b0);
+  pde_mhd_p_aux_setup_bnd_mask(step->mhd->bnd_mask);
+
+  int part = PDE_FACES_ALL;
+  if (sub->overlap_ghosts && !s_opt_bc_reconstruct && !s_opt_need_current) {
+    ggcm_mhd_fill_ghosts_begin(mhd, x_curr, time_curr);
+
+    for (int p = 0; p < mrc_fld_nr_patches(x_curr); p++) {
+      pde_mhd_p_aux_get(p);
+      fld3d_get(&x, p);
+      for (int d = 0; d < 3; d++) {
+	fld3d_get(&fluxes[d], p);
+      }
+
+      patch_flux(step, fluxes, x, PDE_FACES_INTERIOR);
+
+      fld3d_put(&x, p);
+      for (int d = 0; d < 3; d++) {
+	fld3d_put(&fluxes[d], p);
+      }
+    }
+
+    ggcm_mhd_fill_ghosts_end(mhd, x_curr, time_curr);
+    part = PDE_FACES_BOUNDARY;
+  } else {
+    ggcm_mhd_fill_ghosts(mhd, x_curr, time_curr);
+  }
   fld3d_t Ul[3], Ur[3];
   if (s_opt_bc_reconstruct) {
     for (int d = 0; d < 3; d++) {
@@ -226,8 +280,6 @@ pushstage_c(struct ggcm_mhd_step *step, mrc_fld_data_t dt, mrc_fld_data_t time_c
       fld3d_setup(&Ur[d], sub->Ur[d]);
     }
   }
-  pde_mhd_p_aux_setup_b0(step->mhd->b0);
-  pde_mhd_p_aux_setup_bnd_mask(step->mhd->bnd_mask);
     
   for (int p = 0; p < mrc_fld_nr_patches(x_curr); p++) {
     // FIXME, need pde_patch_set()?
@@ -279,13 +331,7 @@ pushstage_c(struct ggcm_mhd_step *step, mrc_fld_data_t dt, mrc_fld_data_t time_c
 
     } else { // !s_opt_bc_reconstruct
 
-      pde_for_each_dir(dir) {
-	pde_for_each_line(dir, j, k, 0) {
-	  int ib = 0, ie = s_ldims[dir];
-	  mhd_flux_pt1(step, x, j, k, dir, ib, ie);
-	  mhd_flux_pt2(step, fluxes[dir], x, j, k, dir, ib, ie);
-	}
-      }
+      patch_flux(step, fluxes, x, part);
 
     }
 
@@ -447,6 +493,7 @@ static struct param ggcm_mhd_step_mhdcc_descr[] = {
 								  opt_get_dt_descr)             },
   { "background"         , VAR(opt.background)     , PARAM_BOOL(false)                          },
   { "bc_reconstruct"     , VAR(opt.bc_reconstruct) , PARAM_BOOL(false)                          },
+  { "overlap_ghosts"     , VAR(overlap_ghosts)     , PARAM_BOOL(false)                          },
   { "limiter_mc_beta"    , VAR(opt.limiter_mc_beta), PARAM_DOUBLE(2.)                           },
   { "divb_glm_alpha"     , VAR(opt.divb_glm_alpha) , PARAM_DOUBLE(.1)                           },
   { "divb_glm_ch_fac"    , VAR(opt.divb_glm_ch_fac), PARAM_DOUBLE(1.)                           },
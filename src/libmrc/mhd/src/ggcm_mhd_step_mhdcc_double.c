@@ -0,0 +1,6 @@
+#include <mrc_fld_as_double.h>
+
+#define ggcm_mhd_step_mhdcc_ops ggcm_mhd_step_mhdcc_double_ops
+#define ggcm_mhd_step_mhdcc_name "mhdcc_double"
+
+#include "ggcm_mhd_step_mhdcc_common.c"
@@ -196,3 +196,31 @@ fld1d_state_is_setup(fld1d_state_t f)
 #endif
 
 
+
+// ======================================================================
+// fld1d_pencil_t
+//
+// PDE_PENCIL_N adjacent lines of s_n_comps mrc_fld_data_t each, access with
+// F1P. Stored as [m][line][i], so that unlike for fld1d_state_t, a given
+// component is contiguous along the line, and loops along i vectorize.
+
+#define PDE_PENCIL_N (8)
+
+typedef struct {
+  mrc_fld_data_t *arr;
+} fld1d_pencil_t;
+
+#define F1P(f, m, l, i) \
+  ((f).arr[((m) * PDE_PENCIL_N + (l)) * s_size_1d + s_n_ghosts + (i)])
+
+static inline void
+fld1d_pencil_setup(fld1d_pencil_t *f)
+{
+  f->arr = calloc(s_n_comps * PDE_PENCIL_N * s_size_1d, sizeof(*f->arr));
+}
+
+static inline bool
+fld1d_pencil_is_setup(fld1d_pencil_t f)
+{
+  return f.arr;
+}
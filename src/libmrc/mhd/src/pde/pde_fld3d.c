@@ -76,13 +76,11 @@ static inline void
 fld3d_get(fld3d_t *f, int p)
 {
   assert(f->mrc_fld);
-  f->arr_off = f->mrc_fld->nd_acc.arr_off;
   assert(mrc_ndarray_f_contiguous(f->mrc_fld->_nd));
 
-  assert(p == 0);
-  // FIXME, I think this is broken, patch is the very last dimension, this seems to
-  // do component. Also, could use nd_acc.stride[] (see above, too)
-  f->arr_off += p * s_lgdims[0] * s_lgdims[1] * s_lgdims[2];
+  // patch is the last dimension
+  f->arr_off = (mrc_fld_data_t *) f->mrc_fld->nd_acc.arr_off +
+    p * f->mrc_fld->nd_acc.stride[4];
 }
 
 // FIXME, do we require fld3d_put to close fld3d_get?
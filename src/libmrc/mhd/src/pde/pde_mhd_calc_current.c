@@ -51,7 +51,7 @@ patch_calc_current_ec(fld3d_t p_J, fld3d_t p_B)
 static void _mrc_unused
 patch_calc_current_cc(fld3d_t p_Jcc, fld3d_t p_U, fld3d_t p_zmask)
 { 
-  static fld3d_t p_Jec;
+  static PDE_THREAD_LOCAL fld3d_t p_Jec;
   fld3d_setup_tmp_compat(&p_Jec, 3, _TMP1); /* was named _TX */
   fld3d_t p_B = fld3d_make_view(p_U, BX);
 
@@ -75,7 +75,7 @@ patch_calc_current_cc(fld3d_t p_Jcc, fld3d_t p_U, fld3d_t p_zmask)
 static void _mrc_unused
 patch_calc_current_cc_bgrid_fc(fld3d_t p_Jcc, fld3d_t p_B)
 { 
-  static fld3d_t p_Jec;
+  static PDE_THREAD_LOCAL fld3d_t p_Jec;
   fld3d_setup_tmp(&p_Jec, 3);
 
   patch_calc_current_ec(p_Jec, p_B);
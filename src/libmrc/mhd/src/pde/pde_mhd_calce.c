@@ -45,7 +45,7 @@ bcthy3f(mrc_fld_data_t s1, mrc_fld_data_t s2)
 static inline void
 patch_calc_avg_dz_By(fld3d_t p_dB, fld3d_t p_B, int XX, int YY, int ZZ)
 {
-  static fld3d_t p_tmp1;
+  static PDE_THREAD_LOCAL fld3d_t p_tmp1;
   fld3d_setup_tmp_compat(&p_tmp1, 2, _TMP1);
 
   // d_z B_y, d_y B_z on x edges
@@ -162,7 +162,7 @@ patch_bcthy3z_NL1(fld3d_t p_E, mrc_fld_data_t dt, fld3d_t p_U, fld3d_t p_W,
 		  int XX, int YY, int ZZ)
 {
   const mrc_fld_data_t REPS = 1.e-10f;
-  static fld3d_t p_dB;
+  static PDE_THREAD_LOCAL fld3d_t p_dB;
   fld3d_setup_tmp_compat(&p_dB, 2, _TMP3);
   fld3d_t p_B = fld3d_make_view(p_U, BX);
 
@@ -203,7 +203,7 @@ patch_bcthy3z_const(fld3d_t p_E, mrc_fld_data_t dt, fld3d_t p_U, fld3d_t p_W,
 		    fld3d_t p_resis,
 		    int XX, int YY, int ZZ)
 {
-  static fld3d_t p_dB;
+  static PDE_THREAD_LOCAL fld3d_t p_dB;
   fld3d_setup_tmp_compat(&p_dB, 2, _TMP3);
   fld3d_t p_B = fld3d_make_view(p_U, BX);
 
@@ -321,7 +321,7 @@ static void _mrc_unused
 patch_calc_e(fld3d_t p_E, mrc_fld_data_t dt, fld3d_t p_U, fld3d_t p_W,
 	     fld3d_t p_zmask, fld3d_t p_rmask)
 {
-  static fld3d_t p_resis;
+  static PDE_THREAD_LOCAL fld3d_t p_resis;
   fld3d_setup_tmp_compat(&p_resis, 1, _RESIS);
 
   if (s_opt_hall != OPT_HALL_NONE || s_magdiffu == MAGDIFFU_CONST) {
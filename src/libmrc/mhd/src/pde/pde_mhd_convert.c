@@ -341,7 +341,7 @@ mhd_cons_from_prim(fld1d_state_t U, fld1d_state_t W, int ib, int ie)
 static void _mrc_unused
 patch_prim_from_cons(fld3d_t p_W, fld3d_t p_U, int sw)
 {
-  static fld1d_state_t l_U, l_W;
+  static PDE_THREAD_LOCAL fld1d_state_t l_U, l_W;
   if (!fld1d_state_is_setup(l_U)) {
     fld1d_state_setup(&l_U);
     fld1d_state_setup(&l_W);
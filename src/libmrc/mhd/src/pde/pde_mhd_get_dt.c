@@ -16,7 +16,7 @@
 static mrc_fld_data_t
 patch_get_dt_scons_c(fld3d_t p_U, fld3d_t p_ymask)
 {
-  static fld3d_t p_W, p_cmsv, p_bcc, p_zmask;
+  static PDE_THREAD_LOCAL fld3d_t p_W, p_cmsv, p_bcc, p_zmask;
   fld3d_setup_tmp_compat(&p_W    , 5, _RR);
   fld3d_setup_tmp_compat(&p_cmsv , 1, _CMSV);
   fld3d_setup_tmp_compat(&p_bcc  , 3, _BX);
@@ -60,7 +60,7 @@ patch_get_dt_scons_c(fld3d_t p_U, fld3d_t p_ymask)
 static mrc_fld_data_t
 patch_get_dt_scons_c_v2(fld3d_t p_U, fld3d_t p_ymask)
 {
-  static fld3d_t p_zmask;
+  static PDE_THREAD_LOCAL fld3d_t p_zmask;
   fld3d_setup_tmp_compat(&p_zmask, 1, _ZMASK);
   fld3d_t p_B = fld3d_make_view(p_U, BX);
   
@@ -115,7 +115,7 @@ void newstep_F77(real *pp, real *rr, real *vx, real *vy, real *vz,
 static mrc_fld_data_t
 patch_get_dt_scons_fortran(fld3d_t p_U, fld3d_t p_ymask)
 {
-  static fld3d_t p_W, p_cmsv, p_bcc, p_zmask;
+  static PDE_THREAD_LOCAL fld3d_t p_W, p_cmsv, p_bcc, p_zmask;
   fld3d_setup_tmp_compat(&p_W    , 5, _RR);
   fld3d_setup_tmp_compat(&p_cmsv , 1, _CMSV);
   fld3d_setup_tmp_compat(&p_bcc  , 3, _BX);
@@ -189,12 +189,12 @@ pde_mhd_get_dt_scons(struct ggcm_mhd *mhd, struct mrc_fld *f_U, struct mrc_fld *
 static mrc_fld_data_t _mrc_unused
 pde_mhd_get_dt_fcons(struct ggcm_mhd *mhd, struct mrc_fld *x_fld)
 {
-  static fld1d_state_t V, U;
+  static PDE_THREAD_LOCAL fld1d_state_t V, U;
   if (!fld1d_state_is_setup(V)) {
     fld1d_state_setup(&V);
     fld1d_state_setup(&U);
   }
-  static fld1d_t ymask;
+  static PDE_THREAD_LOCAL fld1d_t ymask;
   if (!fld1d_is_setup(ymask)) {
     fld1d_setup(&ymask);
   }
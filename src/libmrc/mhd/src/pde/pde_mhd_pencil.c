@@ -0,0 +1,242 @@
+
+#ifndef PDE_MHD_PENCIL_C
+#define PDE_MHD_PENCIL_C
+
+#include "pde/pde_mhd_convert.c"
+#include "pde/pde_mhd_riemann.c"
+
+// ======================================================================
+// pencil versions of the 1-d line pipeline
+//
+// These work on PDE_PENCIL_N adjacent lines at a time, stored as
+// fld1d_pencil_t (component-major), so that the innermost loops run along
+// i over contiguous data and can be vectorized. The arithmetic is the same
+// as in the corresponding per-point functions (mhd_pt_prim_from_scons(),
+// fluxes_rusanov(), ...), so results match the line-by-line path (up to how
+// the compiler chooses to contract multiply-adds).
+//
+// Only the simplest case is covered for now: semi-conservative MHD / hydro,
+// piecewise constant reconstruction, Rusanov / HLL fluxes, no GLM.
+// Callers need to check mhd_pencil_is_supported() and otherwise fall back to
+// the line-by-line path.
+
+// ----------------------------------------------------------------------
+// mhd_pencil_is_supported
+
+static bool _mrc_unused
+mhd_pencil_is_supported()
+{
+  return ((s_opt_eqn == OPT_EQN_MHD_SCONS || s_opt_eqn == OPT_EQN_HD) &&
+	  s_opt_limiter == OPT_LIMITER_FLAT &&
+	  (s_opt_riemann == OPT_RIEMANN_RUSANOV || s_opt_riemann == OPT_RIEMANN_HLL) &&
+	  s_opt_divb != OPT_DIVB_GLM);
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_get_state_scons
+
+static void _mrc_unused
+mhd_pencil_get_state_scons(fld1d_pencil_t u, fld3d_t U,
+			   int j, int k, int n_lines, int dir, int ib, int ie)
+{
+#define GET_LINE(X,Y,Z,I,J,K) do {			\
+    for (int l = 0; l < n_lines; l++) {			\
+      for (int i = ib; i < ie; i++) {			\
+	F1P(u, RR , l, i) = F3S(U, RR   , I,J,K);	\
+	F1P(u, RVX, l, i) = F3S(U, RVX+X, I,J,K);	\
+	F1P(u, RVY, l, i) = F3S(U, RVX+Y, I,J,K);	\
+	F1P(u, RVZ, l, i) = F3S(U, RVX+Z, I,J,K);	\
+	F1P(u, UU , l, i) = F3S(U, UU   , I,J,K);	\
+      }							\
+    }							\
+  } while (0)
+
+  if (dir == 0) {
+    GET_LINE(0,1,2, i,j+l,k);
+  } else if (dir == 1) {
+    GET_LINE(1,2,0, k+l,i,j);
+  } else if (dir == 2) {
+    GET_LINE(2,0,1, j+l,k,i);
+  }
+#undef GET_LINE
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_put_state_scons
+
+static void _mrc_unused
+mhd_pencil_put_state_scons(fld1d_pencil_t u, fld3d_t U,
+			   int j, int k, int n_lines, int dir, int ib, int ie)
+{
+#define PUT_LINE(X,Y,Z,I,J,K) do {			\
+    for (int l = 0; l < n_lines; l++) {			\
+      for (int i = ib; i < ie; i++) {			\
+	F3S(U, RR   , I,J,K) = F1P(u, RR , l, i);	\
+	F3S(U, RVX+X, I,J,K) = F1P(u, RVX, l, i);	\
+	F3S(U, RVX+Y, I,J,K) = F1P(u, RVY, l, i);	\
+	F3S(U, RVX+Z, I,J,K) = F1P(u, RVZ, l, i);	\
+	F3S(U, UU   , I,J,K) = F1P(u, UU , l, i);	\
+      }							\
+    }							\
+  } while (0)
+
+  if (dir == 0) {
+    PUT_LINE(0,1,2, i,j+l,k);
+  } else if (dir == 1) {
+    PUT_LINE(1,2,0, k+l,i,j);
+  } else if (dir == 2) {
+    PUT_LINE(2,0,1, j+l,k,i);
+  }
+#undef PUT_LINE
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_prim_from_scons
+//
+// same as mhd_pt_prim_from_scons()
+
+static void _mrc_unused
+mhd_pencil_prim_from_scons(fld1d_pencil_t W, fld1d_pencil_t U,
+			   int n_lines, int ib, int ie)
+{
+  for (int l = 0; l < n_lines; l++) {
+    mrc_fld_data_t * restrict w_rr = &F1P(W, RR, l, 0), * restrict u_rr = &F1P(U, RR , l, 0);
+    mrc_fld_data_t * restrict w_vx = &F1P(W, VX, l, 0), * restrict u_vx = &F1P(U, RVX, l, 0);
+    mrc_fld_data_t * restrict w_vy = &F1P(W, VY, l, 0), * restrict u_vy = &F1P(U, RVY, l, 0);
+    mrc_fld_data_t * restrict w_vz = &F1P(W, VZ, l, 0), * restrict u_vz = &F1P(U, RVZ, l, 0);
+    mrc_fld_data_t * restrict w_pp = &F1P(W, PP, l, 0), * restrict u_uu = &F1P(U, UU , l, 0);
+#pragma omp simd
+    for (int i = ib; i < ie; i++) {
+      w_rr[i] = u_rr[i];
+      mrc_fld_data_t rri = 1.f / u_rr[i];
+      w_vx[i] = rri * u_vx[i];
+      w_vy[i] = rri * u_vy[i];
+      w_vz[i] = rri * u_vz[i];
+      mrc_fld_data_t rvv = (sqr(u_vx[i]) + sqr(u_vy[i]) + sqr(u_vz[i])) * rri;
+      mrc_fld_data_t pp = s_gamma_m1 * (u_uu[i] - .5f * rvv);
+      w_pp[i] = mrc_fld_max(pp, TINY_NUMBER);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_scons_from_prim
+//
+// same as mhd_pt_scons_from_prim()
+
+static void _mrc_unused
+mhd_pencil_scons_from_prim(fld1d_pencil_t U, fld1d_pencil_t W,
+			   int n_lines, int ib, int ie)
+{
+  for (int l = 0; l < n_lines; l++) {
+    mrc_fld_data_t * restrict u_rr = &F1P(U, RR , l, 0), * restrict w_rr = &F1P(W, RR, l, 0);
+    mrc_fld_data_t * restrict u_vx = &F1P(U, RVX, l, 0), * restrict w_vx = &F1P(W, VX, l, 0);
+    mrc_fld_data_t * restrict u_vy = &F1P(U, RVY, l, 0), * restrict w_vy = &F1P(W, VY, l, 0);
+    mrc_fld_data_t * restrict u_vz = &F1P(U, RVZ, l, 0), * restrict w_vz = &F1P(W, VZ, l, 0);
+    mrc_fld_data_t * restrict u_uu = &F1P(U, UU , l, 0), * restrict w_pp = &F1P(W, PP, l, 0);
+#pragma omp simd
+    for (int i = ib; i < ie; i++) {
+      u_rr[i] = w_rr[i];
+      u_vx[i] = w_rr[i] * w_vx[i];
+      u_vy[i] = w_rr[i] * w_vy[i];
+      u_vz[i] = w_rr[i] * w_vz[i];
+      u_uu[i] = w_pp[i] * s_gamma_m1_inv +
+	.5 * (sqr(w_vx[i]) + sqr(w_vy[i]) + sqr(w_vz[i])) * w_rr[i];
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_reconstruct
+//
+// piecewise constant, same as mhd_reconstruct_pcm()
+
+static void _mrc_unused
+mhd_pencil_reconstruct(fld1d_pencil_t U_l, fld1d_pencil_t U_r,
+		       fld1d_pencil_t W_l, fld1d_pencil_t W_r,
+		       fld1d_pencil_t W, int n_lines, int ib, int ie)
+{
+  for (int m = 0; m < s_n_comps; m++) {
+    for (int l = 0; l < n_lines; l++) {
+      for (int i = ib; i < ie; i++) {
+	F1P(W_l, m, l, i) = F1P(W, m, l, i-1);
+	F1P(W_r, m, l, i) = F1P(W, m, l, i  );
+      }
+    }
+  }
+
+  mhd_pencil_scons_from_prim(U_l, W_l, n_lines, ib, ie);
+  mhd_pencil_scons_from_prim(U_r, W_r, n_lines, ib, ie);
+}
+
+// ----------------------------------------------------------------------
+// mhd_pencil_riemann
+//
+// Rusanov / HLL, same as fluxes_rusanov() / fluxes_hll() for scons / hd
+
+static void _mrc_unused
+mhd_pencil_riemann(fld1d_pencil_t F, fld1d_pencil_t U_l, fld1d_pencil_t U_r,
+		   fld1d_pencil_t W_l, fld1d_pencil_t W_r, int n_lines, int ib, int ie)
+{
+  // the flux of rv_x only has a pressure term for hydro (see fluxes_hd())
+  const bool is_hd = s_opt_eqn == OPT_EQN_HD;
+  const bool is_rusanov = s_opt_riemann == OPT_RIEMANN_RUSANOV;
+
+  for (int l = 0; l < n_lines; l++) {
+    mrc_fld_data_t * restrict f[5], * restrict ul[5], * restrict ur[5];
+    for (int m = 0; m < 5; m++) {
+      f[m] = &F1P(F, m, l, 0);
+      ul[m] = &F1P(U_l, m, l, 0);
+      ur[m] = &F1P(U_r, m, l, 0);
+    }
+    mrc_fld_data_t * restrict wl_rr = &F1P(W_l, RR, l, 0), * restrict wr_rr = &F1P(W_r, RR, l, 0);
+    mrc_fld_data_t * restrict wl_vx = &F1P(W_l, VX, l, 0), * restrict wr_vx = &F1P(W_r, VX, l, 0);
+    mrc_fld_data_t * restrict wl_vy = &F1P(W_l, VY, l, 0), * restrict wr_vy = &F1P(W_r, VY, l, 0);
+    mrc_fld_data_t * restrict wl_vz = &F1P(W_l, VZ, l, 0), * restrict wr_vz = &F1P(W_r, VZ, l, 0);
+    mrc_fld_data_t * restrict wl_pp = &F1P(W_l, PP, l, 0), * restrict wr_pp = &F1P(W_r, PP, l, 0);
+
+#pragma omp simd
+    for (int i = ib; i < ie; i++) {
+      mrc_fld_data_t Fl[5], Fr[5];
+      Fl[RR]  = wl_rr[i] * wl_vx[i];
+      Fl[RVX] = wl_rr[i] * wl_vx[i] * wl_vx[i];
+      if (is_hd) {
+	Fl[RVX] += wl_pp[i];
+      }
+      Fl[RVY] = wl_rr[i] * wl_vy[i] * wl_vx[i];
+      Fl[RVZ] = wl_rr[i] * wl_vz[i] * wl_vx[i];
+      Fl[UU]  = (ul[UU][i] + wl_pp[i]) * wl_vx[i];
+
+      Fr[RR]  = wr_rr[i] * wr_vx[i];
+      Fr[RVX] = wr_rr[i] * wr_vx[i] * wr_vx[i];
+      if (is_hd) {
+	Fr[RVX] += wr_pp[i];
+      }
+      Fr[RVY] = wr_rr[i] * wr_vy[i] * wr_vx[i];
+      Fr[RVZ] = wr_rr[i] * wr_vz[i] * wr_vx[i];
+      Fr[UU]  = (ur[UU][i] + wr_pp[i]) * wr_vx[i];
+
+      mrc_fld_data_t cf_l = sqrtf(s_gamma * wl_pp[i] / wl_rr[i]);
+      mrc_fld_data_t cf_r = sqrtf(s_gamma * wr_pp[i] / wr_rr[i]);
+
+      if (is_rusanov) {
+	mrc_fld_data_t vv_l = sqr(wl_vx[i]) + sqr(wl_vy[i]) + sqr(wl_vz[i]);
+	mrc_fld_data_t vv_r = sqr(wr_vx[i]) + sqr(wr_vy[i]) + sqr(wr_vz[i]);
+	mrc_fld_data_t c_l = sqrtf(vv_l) + cf_l;
+	mrc_fld_data_t c_r = sqrtf(vv_r) + cf_r;
+	mrc_fld_data_t c_max = .5 * (c_l + c_r);
+	for (int m = 0; m < 5; m++) {
+	  f[m][i] = .5f * (Fl[m] + Fr[m] - c_max * (ur[m][i] - ul[m][i]));
+	}
+      } else {
+	mrc_fld_data_t c_l = mrc_fld_min(mrc_fld_min(wl_vx[i] - cf_l, wr_vx[i] - cf_r), 0.);
+	mrc_fld_data_t c_r = mrc_fld_max(mrc_fld_max(wl_vx[i] + cf_l, wr_vx[i] + cf_r), 0.);
+	for (int m = 0; m < 5; m++) {
+	  f[m][i] = ((c_r * Fl[m] - c_l * Fr[m]) + (c_r * c_l * (ur[m][i] - ul[m][i]))) / (c_r - c_l);
+	}
+      }
+    }
+  }
+}
+
+#endif
@@ -13,7 +13,7 @@ patch_push_c(fld3d_t p_Unext, fld3d_t p_Uprev, fld3d_t p_Ucurr,
 	     fld3d_t p_ymask, fld3d_t p_zmask, fld3d_t p_E,
 	     mrc_fld_data_t dt, int stage)
 {
-  static fld3d_t p_rmask, p_resis, p_Jcc;
+  static PDE_THREAD_LOCAL fld3d_t p_rmask, p_resis, p_Jcc;
   fld3d_setup_tmp_compat(&p_rmask, 1, _RMASK);
   fld3d_setup_tmp_compat(&p_resis, 1, _RESIS);
   fld3d_setup_tmp_compat(&p_Jcc, 3, _CURRX);
@@ -157,7 +157,7 @@ patch_poison_bnd(fld3d_t p_U)
 static void
 patch_pushstage(fld3d_t p_f, mrc_fld_data_t dt, int stage)
 {
-  static fld3d_t p_W, p_cmsv, p_E;
+  static PDE_THREAD_LOCAL fld3d_t p_W, p_cmsv, p_E;
   fld3d_setup_tmp_compat(&p_W   , 5, _RR);
   fld3d_setup_tmp_compat(&p_cmsv, 1, _CMSV);
   fld3d_setup_tmp_compat(&p_E   , 3, _FLX);
@@ -181,7 +181,7 @@ patch_pushstage(fld3d_t p_f, mrc_fld_data_t dt, int stage)
   }
 
   if (stage == 0) {
-    static fld3d_t p_bcc;
+    static PDE_THREAD_LOCAL fld3d_t p_bcc;
     fld3d_setup_tmp_compat(&p_bcc, 3, _BX);
     patch_primbb(p_bcc, p_Ucurr);
     patch_zmaskn(p_zmask, p_W, p_bcc, p_ymask);
@@ -12,7 +12,7 @@ static void
 patch_push_ej_c(fld3d_t p_Unext, mrc_fld_data_t dt, fld3d_t p_Ucurr,
 		fld3d_t p_W, fld3d_t p_zmask)
 {
-  static fld3d_t p_Jec, p_Bcc;
+  static PDE_THREAD_LOCAL fld3d_t p_Jec, p_Bcc;
   fld3d_setup_tmp_compat(&p_Jec, 3, _BX);
   fld3d_setup_tmp_compat(&p_Bcc, 3, _TMP1);
   fld3d_t p_Bcurr = fld3d_make_view(p_Ucurr, BX);
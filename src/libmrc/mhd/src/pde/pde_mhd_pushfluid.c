@@ -220,7 +220,7 @@ pushfv_c(fld3d_t p_Unext, fld3d_t p_Uprev, fld3d_t p_Ucurr, int m,
 	 fld3d_t p_Wcurr, fld3d_t p_cmsv, fld3d_t p_ymask, mrc_fld_data_t dt,
 	 bool limit, fld3d_t p_B)
 {
-  static fld3d_t p_Ffc, p_Fcc, p_C;
+  static PDE_THREAD_LOCAL fld3d_t p_Ffc, p_Fcc, p_C;
   fld3d_setup_tmp_compat(&p_Ffc, 3, _FLX);
   fld3d_setup_tmp_compat(&p_Fcc, 3, _TMP1);
   fld3d_setup_tmp_compat(&p_C, 3, _CX);
@@ -256,7 +256,7 @@ patch_pushfluid_c(fld3d_t p_Unext, mrc_fld_data_t dt, fld3d_t p_Uprev,
 		  fld3d_t p_Ucurr, fld3d_t p_W, fld3d_t p_cmsv, fld3d_t p_ymask,
 		  fld3d_t p_zmask, int stage)
 {
-  static fld3d_t p_B;
+  static PDE_THREAD_LOCAL fld3d_t p_B;
   fld3d_setup_tmp_compat(&p_B, 3, _BX);
   bool limit = stage != 0 && s_mhd_time > s_timelo;
 
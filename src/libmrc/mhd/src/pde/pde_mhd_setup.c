@@ -689,11 +689,19 @@ struct mhd_aux {
   fld1d_vec_t j;
 };
 
-static struct mhd_aux s_aux;
+static PDE_THREAD_LOCAL struct mhd_aux s_aux;
+
+// s_aux is per thread, so this needs to be called by each thread that
+// processes lines, ie., from within the parallel patch loop. Calling it
+// again once set up does nothing.
 
 static void _mrc_unused
 pde_mhd_aux_setup()
 {
+  if (fld1d_is_setup(s_aux.bnd_mask)) {
+    return;
+  }
+
   fld1d_setup(&s_aux.bnd_mask);
   fld1d_vec_setup(&s_aux.j);
   fld1d_vec_setup(&s_aux.b0);
@@ -708,13 +716,18 @@ struct mhd_p_aux {
   fld3d_t Jcc; // needed for Hall and constant resistivity
 };
 
-static struct mhd_p_aux s_p_aux;
+static PDE_THREAD_LOCAL struct mhd_p_aux s_p_aux;
+
+// the underlying fields are shared by all threads, s_p_aux is set up
+// from these in pde_mhd_p_aux_get()
+static struct mrc_fld *s_p_aux_b0_fld;
+static struct mrc_fld *s_p_aux_bnd_mask_fld;
 
 static void _mrc_unused
 pde_mhd_p_aux_setup_b0(struct mrc_fld *b0)
 {
   if (b0) {
-    fld3d_setup(&s_p_aux.b0, b0);
+    s_p_aux_b0_fld = b0;
   }
 }
 
@@ -722,17 +735,19 @@ static void _mrc_unused
 pde_mhd_p_aux_setup_bnd_mask(struct mrc_fld *bnd_mask)
 {
   if (bnd_mask) {
-    fld3d_setup(&s_p_aux.bnd_mask, bnd_mask);
+    s_p_aux_bnd_mask_fld = bnd_mask;
   }
 }
 
 static void _mrc_unused
 pde_mhd_p_aux_get(int p)
 {
-  if (fld3d_is_setup(s_p_aux.b0)) {
+  if (s_p_aux_b0_fld) {
+    fld3d_setup(&s_p_aux.b0, s_p_aux_b0_fld);
     fld3d_get(&s_p_aux.b0, p);
   }
-  if (fld3d_is_setup(s_p_aux.bnd_mask)) {
+  if (s_p_aux_bnd_mask_fld) {
+    fld3d_setup(&s_p_aux.bnd_mask, s_p_aux_bnd_mask_fld);
     fld3d_get(&s_p_aux.bnd_mask, p);
   }
 }
@@ -89,7 +89,7 @@ patch_zmaskn(fld3d_t p_zmask, fld3d_t p_W, fld3d_t p_bcc, fld3d_t p_ymask)
 static void _mrc_unused
 patch_calc_zmask_gold(fld3d_t p_zmask, fld3d_t p_U, fld3d_t p_ymask)
 {
-  static fld3d_t p_bcc;
+  static PDE_THREAD_LOCAL fld3d_t p_bcc;
   fld3d_setup_tmp_compat(&p_bcc, 3, _BX);
 
   patch_primbb(p_bcc, p_U);
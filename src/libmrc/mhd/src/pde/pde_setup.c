@@ -8,6 +8,19 @@
 #include <stdlib.h>
 #include <math.h>
 
+// ----------------------------------------------------------------------
+// PDE_THREAD_LOCAL
+//
+// State that belongs to the patch currently being worked on (current patch
+// mesh info, line buffers, 3d temporaries) is kept per thread, so that
+// patches can be processed in parallel with OpenMP.
+
+#ifdef _OPENMP
+#define PDE_THREAD_LOCAL __thread
+#else
+#define PDE_THREAD_LOCAL
+#endif
+
 // ======================================================================
 // PDE/mesh parameters that we keep around statically
 
@@ -62,9 +75,9 @@ static struct pde_patch *s_patches;
 // s_patch
 //
 // current patch mesh info, taken from s_patches by calling
-// pde_patch_set()
+// pde_patch_set() (per thread)
 
-static struct pde_patch s_patch;
+static PDE_THREAD_LOCAL struct pde_patch s_patch;
 
 // macros to access these quantities in less ugly way
 #define PDE_CRDX_CC(i) F1(s_patch.crd_cc[0], i)
@@ -195,6 +208,25 @@ pde_free()
 #define pde_for_each_patch(p)			\
   for (int p = 0; pde_patch_set(p); p++)
 
+// ----------------------------------------------------------------------
+// pde_for_each_patch_parallel
+//
+// like pde_for_each_patch, but patches are distributed over OpenMP threads.
+// The loop body must only use per-patch state: fld3d_t handles that get
+// fld3d_get()'d need to be local to the loop body, and any scratch has to
+// be PDE_THREAD_LOCAL.
+
+#ifdef _OPENMP
+#define pde_for_each_patch_parallel(p)		\
+  _Pragma("omp parallel for")			\
+  for (int p = 0; p < s_n_patches; p++)		\
+    if (pde_patch_set(p))
+#else
+#define pde_for_each_patch_parallel(p)		\
+  for (int p = 0; p < s_n_patches; p++)		\
+    if (pde_patch_set(p))
+#endif
+
 // ======================================================================
 // loop over 3d field
 
@@ -217,7 +249,7 @@ pde_free()
 // ======================================================================
 // loop over lines // loop along line
 
-static fld1d_t s_line_inv_dx;
+static PDE_THREAD_LOCAL fld1d_t s_line_inv_dx;
 
 // FIXME, this is too easily confused with PDE_INV_DX
 #define PDE_INV_DS(i) F1(s_line_inv_dx, i)
@@ -261,6 +293,78 @@ pde_line_set_dir(int dir)
   for (*_i2 = _i2b; *_i2 < _i2e; (*_i2)++)				\
     for (*_i1 = _i1b; *_i1 < _i1e; (*_i1)++)
 
+// ----------------------------------------------------------------------
+// pde_for_each_pencil
+//
+// like pde_for_each_line, but visits up to PDE_PENCIL_N adjacent lines at a
+// time (see fld1d_pencil_t): line l of the current group is at (j + l, k) for
+// dir 0, 2, and at (j, k + l) for dir 1. n_lines is the number of lines in
+// the group.
+
+#define pde_for_each_pencil(dir, j, k, n_lines, sw)			\
+  int j, k, *_i1, *_i2, _i1b, _i1e, _i2b, _i2e;				\
+  if (dir == 0) {							\
+    _i1 = &j; _i2 = &k;							\
+    _i1b = s_sw[1] ? -sw : 0; _i1e = s_ldims[1] + (s_sw[1] ? sw : 0);	\
+    _i2b = s_sw[2] ? -sw : 0; _i2e = s_ldims[2] + (s_sw[2] ? sw : 0);	\
+  } else if (dir == 1) {						\
+    _i1 = &k; _i2 = &j;							\
+    _i1b = s_sw[0] ? -sw : 0; _i1e = s_ldims[0] + (s_sw[0] ? sw : 0);	\
+    _i2b = s_sw[2] ? -sw : 0; _i2e = s_ldims[2] + (s_sw[2] ? sw : 0);	\
+  } else if (dir == 2) {						\
+    _i1 = &j; _i2 = &k;							\
+    _i1b = s_sw[0] ? -sw : 0; _i1e = s_ldims[0] + (s_sw[0] ? sw : 0);	\
+    _i2b = s_sw[1] ? -sw : 0; _i2e = s_ldims[1] + (s_sw[1] ? sw : 0);	\
+  } else {								\
+    assert(0);								\
+  }									\
+  for (*_i2 = _i2b; *_i2 < _i2e; (*_i2)++)				\
+    for (int n_lines = (*_i1 = _i1b, MIN(PDE_PENCIL_N, _i1e - *_i1));	\
+	 *_i1 < _i1e;							\
+	 *_i1 += n_lines, n_lines = MIN(PDE_PENCIL_N, _i1e - *_i1))
+
+// ----------------------------------------------------------------------
+// pde_line_face_ranges
+//
+// The faces along a line in direction dir are 0 .. s_ldims[dir]. If the flux
+// at face i depends on cells i - sw .. i + sw - 1, faces
+// [sw, s_ldims[dir] - sw + 1) only need interior cells, so on lines that are
+// themselves interior, those can be computed before the ghost points have
+// been filled (PDE_FACES_INTERIOR), and the remaining ones afterwards
+// (PDE_FACES_BOUNDARY).
+// Returns the number of face ranges [fb[r], fe[r]) (at most two) that make up
+// the given part.
+
+enum {
+  PDE_FACES_ALL,
+  PDE_FACES_INTERIOR,
+  PDE_FACES_BOUNDARY,
+};
+
+static int _mrc_unused
+pde_line_face_ranges(int dir, int sw, int part, int fb[2], int fe[2])
+{
+  int n_faces = s_ldims[dir] + 1;
+  int lo = sw, hi = s_ldims[dir] - sw + 1;
+
+  if (part == PDE_FACES_ALL || (part == PDE_FACES_BOUNDARY && hi <= lo)) {
+    fb[0] = 0; fe[0] = n_faces;
+    return 1;
+  } else if (part == PDE_FACES_INTERIOR) {
+    if (hi <= lo) {
+      return 0;
+    }
+    fb[0] = lo; fe[0] = hi;
+    return 1;
+  } else if (part == PDE_FACES_BOUNDARY) {
+    fb[0] = 0 ; fe[0] = lo;
+    fb[1] = hi; fe[1] = n_faces;
+    return 2;
+  } else {
+    assert(0);
+  }
+}
+
 
 #endif
 
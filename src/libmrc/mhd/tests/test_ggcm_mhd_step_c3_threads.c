@@ -0,0 +1,147 @@
+// Checks that the c3 stepper, with its patch loops distributed over OpenMP
+// threads, gives the same result to the last bit however many threads are
+// used: a smooth wave on 4 x 4 patches (all on this rank, domain "multi") is
+// advanced a few steps on 1 and on 4 threads, with and without overlapping
+// the ghost point exchange.
+
+#include "ggcm_mhd_defs.h"
+#include "ggcm_mhd_private.h"
+#include "ggcm_mhd_ic_private.h"
+#include "ggcm_mhd_step.h"
+
+#include <mrc_fld_as_double.h>
+#include <mrc_domain.h>
+#include <mrc_params.h>
+
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define N_STEPS (10)
+
+// ======================================================================
+// ggcm_mhd_ic subclass "wave"
+
+static double
+ggcm_mhd_ic_wave_primitive(struct ggcm_mhd_ic *ic, int m, double crd[3])
+{
+  double xx = crd[0], yy = crd[1];
+
+  switch (m) {
+  case RR: return 1. + .1 * sin(2.*M_PI * xx) * cos(2.*M_PI * yy);
+  case VX: return .1 * sin(2.*M_PI * yy);
+  case VY: return .1 * cos(2.*M_PI * xx);
+  case PP: return 1. + .05 * cos(2.*M_PI * (xx + yy));
+  case BX: return .5;
+  case BY: return .2 * sin(2.*M_PI * xx);
+  case BZ: return .1;
+  default: return 0.;
+  }
+}
+
+static struct ggcm_mhd_ic_ops ggcm_mhd_ic_wave_ops = {
+  .name        = "wave",
+  .primitive   = ggcm_mhd_ic_wave_primitive,
+};
+
+// ----------------------------------------------------------------------
+// run
+//
+// sets up the initial condition, takes N_STEPS steps on n_threads threads,
+// and stores the result in U
+
+static void
+run(struct ggcm_mhd *mhd, int n_threads, struct mrc_fld *U)
+{
+#ifdef _OPENMP
+  omp_set_num_threads(n_threads);
+#endif
+
+  // the initial condition adds B to what's there already
+  mrc_fld_set(mhd->fld, 0.);
+  ggcm_mhd_ic_run(mhd->ic);
+  mhd->time_code = 0.;
+  for (int n = 0; n < N_STEPS; n++) {
+    mhd->dt_code = .002;
+    ggcm_mhd_step_run(mhd->step, mhd->fld);
+    mhd->time_code += mhd->dt_code;
+  }
+  mrc_fld_copy(U, mhd->fld);
+}
+
+// ----------------------------------------------------------------------
+// check_same
+
+static void
+check_same(struct mrc_fld *U1, struct mrc_fld *U4)
+{
+  int n_diff = 0;
+  for (int p = 0; p < mrc_fld_nr_patches(U1); p++) {
+    mrc_fld_foreach(U1, ix,iy,iz, 0, 0) {
+      for (int m = 0; m < mrc_fld_nr_comps(U1); m++) {
+	if (M3(U1, m, ix,iy,iz, p) != M3(U4, m, ix,iy,iz, p)) {
+	  n_diff++;
+	}
+      }
+    } mrc_fld_foreach_end;
+  }
+  if (n_diff) {
+    mprintf("%d values differ between 1 and 4 threads\n", n_diff);
+  }
+  assert(n_diff == 0);
+}
+
+// ----------------------------------------------------------------------
+// test
+
+static void
+test(bool overlap_ghosts)
+{
+  struct ggcm_mhd *mhd = ggcm_mhd_create(MPI_COMM_WORLD);
+  ggcm_mhd_set_type(mhd, "box");
+  ggcm_mhd_default_box(mhd);
+
+  mrc_domain_set_type(mhd->domain, "multi");
+  mrc_domain_set_param_int3(mhd->domain, "m", (int[3]) { 64, 64, 1 });
+  mrc_domain_set_param_int3(mhd->domain, "np", (int[3]) { 4, 4, 1 });
+  struct mrc_crds *crds = mrc_domain_get_crds(mhd->domain);
+  mrc_crds_set_param_double3(crds, "l", (double[3]) { 0., 0., 0. });
+  mrc_crds_set_param_double3(crds, "h", (double[3]) { 1., 1., .1 });
+
+  ggcm_mhd_step_set_type(mhd->step, "c3_double");
+  ggcm_mhd_step_set_param_bool(mhd->step, "overlap_ghosts", overlap_ghosts);
+  ggcm_mhd_ic_set_type(mhd->ic, "wave");
+
+  ggcm_mhd_set_from_options(mhd);
+  ggcm_mhd_setup(mhd);
+
+  struct mrc_fld *U1 = mrc_fld_duplicate(mhd->fld);
+  struct mrc_fld *U4 = mrc_fld_duplicate(mhd->fld);
+  run(mhd, 1, U1);
+  run(mhd, 4, U4);
+  check_same(U1, U4);
+
+  mrc_fld_destroy(U1);
+  mrc_fld_destroy(U4);
+  ggcm_mhd_destroy(mhd);
+}
+
+int
+main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+  libmrc_params_init(argc, argv);
+  ggcm_mhd_register();
+  mrc_class_register_subclass(&mrc_class_ggcm_mhd_ic, &ggcm_mhd_ic_wave_ops);
+
+  test(false);
+  test(true);
+
+  libmrc_finalize();
+  MPI_Finalize();
+  return 0;
+}
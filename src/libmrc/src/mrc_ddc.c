@@ -97,6 +97,37 @@ mrc_ddc_fill_ghosts_fld(struct mrc_ddc *ddc, int mb, int me,
   ops->fill_ghosts_fld(ddc, mb, me, fld);
 }
 
+// ----------------------------------------------------------------------
+// mrc_ddc_fill_ghosts_fld_begin
+
+void
+mrc_ddc_fill_ghosts_fld_begin(struct mrc_ddc *ddc, int mb, int me,
+			      struct mrc_fld *fld)
+{
+  struct mrc_ddc_ops *ops = mrc_ddc_ops(ddc);
+  if (!ops->fill_ghosts_fld_begin) {
+    // no overlap supported, just do it all right away
+    mrc_ddc_fill_ghosts_fld(ddc, mb, me, fld);
+    return;
+  }
+  ops->fill_ghosts_fld_begin(ddc, mb, me, fld);
+}
+
+// ----------------------------------------------------------------------
+// mrc_ddc_fill_ghosts_fld_end
+
+void
+mrc_ddc_fill_ghosts_fld_end(struct mrc_ddc *ddc, int mb, int me,
+			    struct mrc_fld *fld)
+{
+  struct mrc_ddc_ops *ops = mrc_ddc_ops(ddc);
+  if (!ops->fill_ghosts_fld_begin) {
+    return;
+  }
+  assert(ops->fill_ghosts_fld_end);
+  ops->fill_ghosts_fld_end(ddc, mb, me, fld);
+}
+
 
 // FIXME: Needed for MB and nothing else!!
 // ----------------------------------------------------------------------
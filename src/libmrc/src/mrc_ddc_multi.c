@@ -581,11 +581,14 @@ mrc_ddc_multi_fill_ghosts_local(struct mrc_ddc *ddc, int mb, int me, void *ctx)
 }
 
 // ----------------------------------------------------------------------
-// mrc_ddc_multi_fill_ghosts_fld
+// mrc_ddc_multi_get_fill_ghosts_fld_pattern
+//
+// returns the pattern for fld's number of ghost points (set up on first use),
+// with buffers ready for me - mb components
 
-static void
-mrc_ddc_multi_fill_ghosts_fld(struct mrc_ddc *ddc, int mb, int me,
-			      struct mrc_fld *fld)
+static struct mrc_ddc_pattern2 *
+mrc_ddc_multi_get_fill_ghosts_fld_pattern(struct mrc_ddc *ddc, int mb, int me,
+					  struct mrc_fld *fld)
 {
   struct mrc_ddc_multi *sub = mrc_ddc_multi(ddc);
 
@@ -601,7 +604,49 @@ mrc_ddc_multi_fill_ghosts_fld(struct mrc_ddc *ddc, int mb, int me,
   ddc->size_of_type = fld->_nd->size_of_type;
   mrc_ddc_multi_set_mpi_type(ddc);
   mrc_ddc_multi_alloc_buffers(ddc, sub->fill_ghosts[nr_ghosts], me - mb);
-  ddc_run(ddc, sub->fill_ghosts[nr_ghosts], mb, me, fld,
+  return sub->fill_ghosts[nr_ghosts];
+}
+
+// ----------------------------------------------------------------------
+// mrc_ddc_multi_fill_ghosts_fld_begin
+//
+// posts the communication and does the local (same-rank) exchange
+
+static void
+mrc_ddc_multi_fill_ghosts_fld_begin(struct mrc_ddc *ddc, int mb, int me,
+				    struct mrc_fld *fld)
+{
+  struct mrc_ddc_pattern2 *patt2 =
+    mrc_ddc_multi_get_fill_ghosts_fld_pattern(ddc, mb, me, fld);
+  ddc_run_begin(ddc, patt2, mb, me, fld, mrc_fld_ddc_copy_to_buf);
+  ddc_run_local(ddc, patt2, mb, me, fld,
+		mrc_fld_ddc_copy_to_buf, mrc_fld_ddc_copy_from_buf);
+}
+
+// ----------------------------------------------------------------------
+// mrc_ddc_multi_fill_ghosts_fld_end
+
+static void
+mrc_ddc_multi_fill_ghosts_fld_end(struct mrc_ddc *ddc, int mb, int me,
+				  struct mrc_fld *fld)
+{
+  struct mrc_ddc_multi *sub = mrc_ddc_multi(ddc);
+
+  struct mrc_ddc_pattern2 *patt2 = sub->fill_ghosts[fld->_nr_ghosts];
+  assert(patt2);
+  ddc_run_end(ddc, patt2, mb, me, fld, mrc_fld_ddc_copy_from_buf);
+}
+
+// ----------------------------------------------------------------------
+// mrc_ddc_multi_fill_ghosts_fld
+
+static void
+mrc_ddc_multi_fill_ghosts_fld(struct mrc_ddc *ddc, int mb, int me,
+			      struct mrc_fld *fld)
+{
+  struct mrc_ddc_pattern2 *patt2 =
+    mrc_ddc_multi_get_fill_ghosts_fld_pattern(ddc, mb, me, fld);
+  ddc_run(ddc, patt2, mb, me, fld,
 	  mrc_fld_ddc_copy_to_buf, mrc_fld_ddc_copy_from_buf);
 }
 
@@ -624,6 +669,8 @@ struct mrc_ddc_ops mrc_ddc_multi_ops = {
   .set_domain            = mrc_ddc_multi_set_domain,
   .get_domain            = mrc_ddc_multi_get_domain,
   .fill_ghosts_fld       = mrc_ddc_multi_fill_ghosts_fld,
+  .fill_ghosts_fld_begin = mrc_ddc_multi_fill_ghosts_fld_begin,
+  .fill_ghosts_fld_end   = mrc_ddc_multi_fill_ghosts_fld_end,
   .fill_ghosts           = mrc_ddc_multi_fill_ghosts,
   .fill_ghosts_begin     = mrc_ddc_multi_fill_ghosts_begin,
   .fill_ghosts_end       = mrc_ddc_multi_fill_ghosts_end,
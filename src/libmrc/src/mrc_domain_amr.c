@@ -124,14 +124,8 @@ gpatch_to_rank_patch(struct mrc_domain *domain, int gpatch,
 {
   struct mrc_domain_amr *amr = mrc_domain_amr(domain);
 
-  // FIXME, this can be done much more efficiently using binary search...
-  for (int i = 0; i < domain->size; i++) {
-    if (gpatch < amr->gpatch_off_all[i+1]) {
-      *rank = i;
-      *patch = gpatch - amr->gpatch_off_all[i];
-      break;
-    }
-  }
+  gpatch_off_find_rank_patch(amr->gpatch_off_all, domain->size, gpatch,
+			     rank, patch);
 }
 
 // ======================================================================
@@ -257,3 +257,31 @@ sfc_idx_to_idx3(struct mrc_sfc *sfc, int idx, int p[3])
 
 
 
+
+// ======================================================================
+// gpatch_off_find_rank_patch
+//
+// gpatch_off_all[0..size] holds the first global patch of each rank (and
+// the total number of patches at the end). Finds the rank owning gpatch,
+// and its local patch number on that rank, by binary search. Ranks without
+// patches are skipped, the same way a linear scan would.
+
+void
+gpatch_off_find_rank_patch(const int *gpatch_off_all, int size, int gpatch,
+			   int *rank, int *patch)
+{
+  assert(gpatch >= 0 && gpatch < gpatch_off_all[size]);
+
+  // find the first rank r with gpatch < gpatch_off_all[r+1]
+  int lo = 0, hi = size - 1;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (gpatch < gpatch_off_all[mid+1]) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  *rank = lo;
+  *patch = gpatch - gpatch_off_all[lo];
+}
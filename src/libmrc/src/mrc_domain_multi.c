@@ -93,15 +93,8 @@ gpatch_to_rank_patch(struct mrc_domain *domain, int gpatch,
 {
   struct mrc_domain_multi *multi = mrc_domain_multi(domain);
 
-  // FIXME, this can be done much more efficiently using binary search...
-  for (int i = 0; i < domain->size; i++) {
-    if (gpatch < multi->gpatch_off_all[i+1]) {
-      *rank = i;
-      *patch = gpatch - multi->gpatch_off_all[i];
-      return;
-    }
-  }
-  assert(0);
+  gpatch_off_find_rank_patch(multi->gpatch_off_all, domain->size, gpatch,
+			     rank, patch);
 }
 
 // ======================================================================
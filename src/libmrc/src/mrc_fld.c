@@ -98,25 +98,25 @@ setup_ndarray(struct mrc_fld *fld)
   setup_ghost_dims_offs(fld);
   
   assert(MRC_FLD_MAXDIMS == 5);
-  int *perm;
+  // these need to outlive the branches below, so no compound literals
+  static const int perm_orig[5] = { 0, 1, 2, 3, 4 };
+  static const int perm_aos[5] = { 3, 0, 1, 2, 4 };
+  static const int perm_aos_c[5] = { 3, 2, 1, 0, 4 };
+  static const int perm_c[5] = { 2, 1, 0, 3, 4 };
+  const int *perm = perm_orig;
   if (!fld->_view_base) {
     // This is a field with its own storage
 
-    if (!fld->_aos && !fld->_c_order) {
-      // original order
-      perm = (int[5]) { 0, 1, 2, 3, 4 };
-    } else if (fld->_aos && !fld->_c_order) {
+    if (fld->_aos && !fld->_c_order) {
       // x,y,z,m,p to m,x,y,z,p
-      perm = (int[5]) { 3, 0, 1, 2, 4 };
+      perm = perm_aos;
     } else if (fld->_aos && fld->_c_order) {
       // x,y,z,m,p to m,z,y,x,p
-      perm = (int[5]) { 3, 2, 1, 0, 4 };
+      perm = perm_aos_c;
     } else if (!fld->_aos && fld->_c_order) {
       // x,y,z,m,p to z,y,x,m,p
-      perm = (int[5]) { 2, 1, 0, 3, 4 };
+      perm = perm_c;
     }
-  } else {
-    perm = (int[5]) { 0, 1, 2, 3, 4 };
   }
       
   struct mrc_ndarray *nd = fld->_nd;
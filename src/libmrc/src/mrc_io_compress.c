@@ -0,0 +1,165 @@
+
+#include <mrc_io_compress.h>
+#include <mrc_bits.h>
+#include <mrc_common.h>
+#include <mrc_ndarray.h>
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+// registered IDs of the filter plugins
+#define FILTER_LZ4 (32004)
+#define FILTER_ZSTD (32015)
+
+// HDF5 chunks need to stay below 4 GB
+#define MAX_CHUNK_BYTES ((size_t) 1 << 31)
+
+// ----------------------------------------------------------------------
+// filter_avail
+
+static bool
+filter_avail(H5Z_filter_t filter, const char *name)
+{
+  static bool warned;
+
+  if (H5Zfilter_avail(filter) > 0) {
+    return true;
+  }
+  if (!warned) {
+    mpi_printf(MPI_COMM_WORLD, "WARNING: HDF5 filter '%s' not available, "
+	       "using deflate instead\n", name);
+    warned = true;
+  }
+  return false;
+}
+
+// ----------------------------------------------------------------------
+// mrc_io_compress_dcpl
+
+hid_t
+mrc_io_compress_dcpl(const char *compression, int level, int rank,
+		     const hsize_t *dims, const hsize_t *chunk,
+		     size_t type_size)
+{
+  if (!compression || strcmp(compression, "none") == 0) {
+    return H5P_DEFAULT;
+  }
+#if defined(H5_HAVE_PARALLEL) && !H5_VERSION_GE(1, 10, 2)
+  static bool warned;
+  if (!warned) {
+    mpi_printf(MPI_COMM_WORLD, "WARNING: parallel HDF5 < 1.10.2 can't write "
+	       "compressed datasets, compression = '%s' ignored\n", compression);
+    warned = true;
+  }
+  return H5P_DEFAULT;
+#endif
+
+  // chunks can't be empty, nor larger than the dataset
+  hsize_t cdims[rank];
+  size_t chunk_bytes = type_size;
+  for (int d = 0; d < rank; d++) {
+    if (dims[d] == 0) {
+      return H5P_DEFAULT;
+    }
+    cdims[d] = MAX(1, MIN(chunk[d], dims[d]));
+    chunk_bytes *= cdims[d];
+  }
+  for (int d = 0; d < rank && chunk_bytes > MAX_CHUNK_BYTES; d++) {
+    while (cdims[d] > 1 && chunk_bytes > MAX_CHUNK_BYTES) {
+      chunk_bytes /= cdims[d];
+      cdims[d] = (cdims[d] + 1) / 2;
+      chunk_bytes *= cdims[d];
+    }
+  }
+
+  herr_t ierr;
+  hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE); assert(dcpl >= 0);
+  ierr = H5Pset_chunk(dcpl, rank, cdims); assert(ierr >= 0);
+  ierr = H5Pset_shuffle(dcpl); assert(ierr >= 0);
+
+  if (strcmp(compression, "lz4") == 0 && filter_avail(FILTER_LZ4, "lz4")) {
+    unsigned int cd_values[1] = { 0 }; // default block size
+    ierr = H5Pset_filter(dcpl, FILTER_LZ4, H5Z_FLAG_MANDATORY, 1, cd_values);
+    assert(ierr >= 0);
+  } else if (strcmp(compression, "zstd") == 0 && filter_avail(FILTER_ZSTD, "zstd")) {
+    unsigned int cd_values[1] = { level > 0 ? level : 3 };
+    ierr = H5Pset_filter(dcpl, FILTER_ZSTD, H5Z_FLAG_MANDATORY, 1, cd_values);
+    assert(ierr >= 0);
+  } else {
+    if (strcmp(compression, "deflate") != 0 && strcmp(compression, "lz4") != 0 &&
+	strcmp(compression, "zstd") != 0) {
+      mpi_printf(MPI_COMM_WORLD, "ERROR: unknown compression '%s'\n", compression);
+      assert(0);
+    }
+    ierr = H5Pset_deflate(dcpl, level > 0 ? MIN(level, 9) : 1); assert(ierr >= 0);
+  }
+  return dcpl;
+}
+
+// ----------------------------------------------------------------------
+// mrc_io_quantize
+
+double
+mrc_io_quantize(void *arr, size_t n, int data_type, double eps)
+{
+  if (!(eps > 0.) || isinf(eps)) {
+    return 0.;
+  }
+
+  // the largest power of two <= 2 eps (eps = f * 2^e, with .5 <= f < 1)
+  int e;
+  frexp(eps, &e);
+  double q = ldexp(1., MIN(e, DBL_MAX_EXP - 1));
+
+  // scaling by a power of two is exact, so only the rounding changes the
+  // values. Values of 2^24 (2^53) q or more are multiples of q already, and
+  // are skipped so that the scaling can't overflow; values that would round
+  // up beyond the largest finite one are left alone, too.
+  double qi = 1. / q;
+  switch (data_type) {
+  case MRC_NT_FLOAT: {
+    if (q < FLT_MIN) {
+      return 0.;
+    }
+    // in double, since q may be beyond what a float can hold
+    float *a = arr;
+    double lim = 0x1p24 * q;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < n; i++) {
+      if (fabsf(a[i]) < lim) {
+	double r = rint(a[i] * qi) * q;
+	if (fabs(r) <= FLT_MAX) {
+	  a[i] = r;
+	}
+      }
+    }
+    break;
+  }
+  case MRC_NT_DOUBLE: {
+    if (q < DBL_MIN) {
+      return 0.;
+    }
+    double *a = arr, lim = 0x1p53 * q;
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < n; i++) {
+      if (fabs(a[i]) < lim) {
+	double r = rint(a[i] * qi) * q;
+	if (isfinite(r)) {
+	  a[i] = r;
+	}
+      }
+    }
+    break;
+  }
+  default:
+    return 0.; // ints are left alone
+  }
+  return .5 * q;
+}
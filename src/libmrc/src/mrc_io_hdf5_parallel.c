@@ -3,6 +3,7 @@
 #include <mrc_params.h>
 #include <mrc_list.h>
 #include "mrc_io_xdmf_lib.h"
+#include <mrc_io_compress.h>
 
 #include <stdlib.h>
 #include <string.h>
@@ -22,6 +23,9 @@ struct ph5 {
   // parallel only
   bool use_independent_io;
   char *separator; // seperator between basename & numbers
+  char *compression; // see mrc_io_compress_dcpl()
+  int compression_level;
+  double quantize_eps; // if > 0, max abs error of lossy field output
 };
 
 #define VAR(x) (void *)offsetof(struct ph5, x)
@@ -29,6 +33,9 @@ static struct param ph5_descr[] = {
   { "sw"                     , VAR(sw)                      , PARAM_INT(0)           },
   { "independent"            , VAR(use_independent_io)      , PARAM_BOOL(true)       },
   { "separator"              , VAR(separator)               , PARAM_STRING(".")      },
+  { "compression"            , VAR(compression)             , PARAM_STRING(NULL)     },
+  { "compression_level"      , VAR(compression_level)       , PARAM_INT(0)           },
+  { "quantize_eps"           , VAR(quantize_eps)            , PARAM_DOUBLE(0.)       },
   {},
 };
 #undef VAR
@@ -160,7 +167,7 @@ phdf5_read_attr(struct mrc_io *io, const char *path, int type,
     ierr = H5LTget_attribute_double(group, ".", name, pv->u_double3); CE;
     break;
   case PT_INT_ARRAY: {
-    int attr = H5Aopen(group, name, H5P_DEFAULT); H5_CHK(attr);
+    hid_t attr = H5Aopen(group, name, H5P_DEFAULT); H5_CHK(attr);
     H5A_info_t ainfo;
     ierr = H5Aget_info(attr, &ainfo); CE;
     ierr = H5Aclose(attr); CE;
@@ -357,10 +364,20 @@ hdf5_parallel_write_fld(struct mrc_io *io, const char *path, struct mrc_fld *fld
     assert(0);
   }
 
+  // one chunk per patch, and filters need collective I/O
+  hsize_t cdims[nr_file_dims];
+  cdims[0] = 1;
+  for (int d = 1; d < nr_file_dims; d++) {
+    cdims[d] = fdims[d];
+  }
+  hid_t dcpl = mrc_io_compress_dcpl(ph5->compression, ph5->compression_level,
+				    nr_file_dims, fdims, cdims,
+				    fld->_nd->size_of_type);
+
   hid_t dset = H5Dcreate(group0, "3d", datatype, filespace, H5P_DEFAULT,
-			 H5P_DEFAULT, H5P_DEFAULT);
+			 dcpl, H5P_DEFAULT);
   hid_t dxpl = H5Pcreate(H5P_DATASET_XFER);
-  if (ph5->use_independent_io) {
+  if (ph5->use_independent_io && dcpl == H5P_DEFAULT) {
     H5Pset_dxpl_mpio(dxpl, H5FD_MPIO_INDEPENDENT);
   } else {
     H5Pset_dxpl_mpio(dxpl, H5FD_MPIO_COLLECTIVE);
@@ -388,9 +405,28 @@ hdf5_parallel_write_fld(struct mrc_io *io, const char *path, struct mrc_fld *fld
   H5Sselect_hyperslab(filespace, H5S_SELECT_SET, foff, NULL, mcount, NULL);
   H5Sselect_hyperslab(memspace, H5S_SELECT_SET, moff, NULL, mcount, NULL);
 
-  
-  H5Dwrite(dset, datatype, memspace, filespace, dxpl, fld->_nd->arr);
-  
+
+  // quantize a copy, rather than the field itself
+  void *arr = fld->_nd->arr;
+  if (ph5->quantize_eps > 0.) {
+    size_t size = fld->_nd->len * fld->_nd->size_of_type;
+    arr = malloc(size);
+    memcpy(arr, fld->_nd->arr, size);
+    double eps = mrc_io_quantize(arr, fld->_nd->len, mrc_fld_data_type(fld),
+				 ph5->quantize_eps);
+    if (eps > 0.) {
+      H5LTset_attribute_double(group0, "3d", "quantize_eps", &eps, 1);
+    }
+  }
+
+  H5Dwrite(dset, datatype, memspace, filespace, dxpl, arr);
+
+  if (arr != fld->_nd->arr) {
+    free(arr);
+  }
+  if (dcpl != H5P_DEFAULT) {
+    H5Pclose(dcpl);
+  }
   H5Sclose(memspace);
   H5Dclose(dset);
   H5Sclose(filespace);
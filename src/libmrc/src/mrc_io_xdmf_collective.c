@@ -3,6 +3,7 @@
 #include <mrc_params.h>
 #include "mrc_io_xdmf_lib.h"
 #include <mrc_redist.h>
+#include <mrc_io_compress.h>
 
 #include <hdf5.h>
 #include <hdf5_hl.h>
@@ -29,26 +30,72 @@ struct xdmf {
   char *romio_cb_write;
   char *romio_ds_write;
   int nr_writers;
+  int mb_per_writer;     //< target output size per writer, for nr_writers = 0
+  bool benchmark;        //< report write bandwidth for every file
   MPI_Comm comm_writers; //< communicator for only the writers
   int *writers;          //< rank (in mrc_io comm) for each writer
   int is_writer;         //< this rank is a writer
+  bool auto_writers;     //< nr_writers gets tuned to the output size
   char *mode;            //< open mode, "r" or "w"
+  char *compression;     //< see mrc_io_compress_dcpl()
+  int compression_level; //< 0: the compressor's default
+  double quantize_eps;   //< if > 0, max abs error of lossy field output
+
+  // stats for the currently open file
+  double bytes_written;
+  double bytes_stored;   //< after compression, counted on the first writer
+  double t_redist;
+  double t_quantize;
+  double t_write;
 };
 
 #define VAR(x) (void *)offsetof(struct xdmf, x)
 static struct param xdmf_collective_descr[] = {
   { "use_independent_io"     , VAR(use_independent_io)      , PARAM_BOOL(false)      },
   { "nr_writers"             , VAR(nr_writers)              , PARAM_INT(1)           },
+  { "mb_per_writer"          , VAR(mb_per_writer)           , PARAM_INT(256)         },
+  { "benchmark"              , VAR(benchmark)               , PARAM_BOOL(false)      },
   { "romio_cb_write"         , VAR(romio_cb_write)          , PARAM_STRING(NULL)     },
   { "romio_ds_write"         , VAR(romio_ds_write)          , PARAM_STRING(NULL)     },
   { "slab_dims"              , VAR(slab_dims)               , PARAM_INT3(0, 0, 0)    },
   { "slab_off"               , VAR(slab_off)                , PARAM_INT3(0, 0, 0)    },
+  { "compression"            , VAR(compression)             , PARAM_STRING(NULL)     },
+  { "compression_level"      , VAR(compression_level)       , PARAM_INT(0)           },
+  { "quantize_eps"           , VAR(quantize_eps)            , PARAM_DOUBLE(0.)       },
   {},
 };
 #undef VAR
 
 #define to_xdmf(io) mrc_to_subobj(io, struct xdmf)
 
+// ----------------------------------------------------------------------
+// xdmf_collective_setup_writers
+//
+// the writers are spread out over the nodes, see mrc_redist_select_writers()
+
+static void
+xdmf_collective_setup_writers(struct mrc_io *io)
+{
+  struct xdmf *xdmf = to_xdmf(io);
+
+  if (xdmf->comm_writers) {
+    MPI_Comm_free(&xdmf->comm_writers);
+  }
+  free(xdmf->writers);
+
+  if (xdmf->nr_writers > io->size) {
+    xdmf->nr_writers = io->size;
+  }
+  xdmf->writers = calloc(xdmf->nr_writers, sizeof(*xdmf->writers));
+  mrc_redist_select_writers(mrc_io_comm(io), xdmf->nr_writers, xdmf->writers);
+  xdmf->is_writer = 0;
+  for (int i = 0; i < xdmf->nr_writers; i++) {
+    if (xdmf->writers[i] == io->rank)
+      xdmf->is_writer = 1;
+  }
+  MPI_Comm_split(mrc_io_comm(io), xdmf->is_writer, io->rank, &xdmf->comm_writers);
+}
+
 // ----------------------------------------------------------------------
 // xdmf_collective_setup
 
@@ -63,22 +110,21 @@ xdmf_collective_setup(struct mrc_io *io)
   sprintf(filename, "%s/%s.xdmf", io->par.outdir, io->par.basename);
   xdmf->xdmf_temporal = xdmf_temporal_create(filename);
 
+  // nr_writers = 0: start with one writer per node, then adjust to the
+  // size of the output after each file (see xdmf_collective_close())
+  if (xdmf->nr_writers <= 0) {
+    xdmf->auto_writers = true;
+#ifdef H5_HAVE_PARALLEL
+    xdmf->nr_writers = mrc_redist_nr_nodes(mrc_io_comm(io));
+#else
+    xdmf->nr_writers = 1;
+#endif
+  }
 #ifndef H5_HAVE_PARALLEL
   assert(xdmf->nr_writers == 1);
 #endif
   
-  if (xdmf->nr_writers > io->size) {
-    xdmf->nr_writers = io->size;
-  }
-  xdmf->writers = calloc(xdmf->nr_writers, sizeof(*xdmf->writers));
-  // setup writers, just use first nr_writers ranks,
-  // could do something fancier in the future
-  for (int i = 0; i < xdmf->nr_writers; i++) {
-    xdmf->writers[i] = i;
-    if (i == io->rank)
-      xdmf->is_writer = 1;
-  }
-  MPI_Comm_split(mrc_io_comm(io), xdmf->is_writer, io->rank, &xdmf->comm_writers);
+  xdmf_collective_setup_writers(io);
 }
 
 // ----------------------------------------------------------------------
@@ -109,6 +155,11 @@ xdmf_collective_open(struct mrc_io *io, const char *mode)
   struct xdmf_file *file = &xdmf->file;
   xdmf->mode = strdup(mode);
   //  assert(strcmp(mode, "w") == 0);
+  xdmf->bytes_written = 0.;
+  xdmf->bytes_stored = 0.;
+  xdmf->t_redist = 0.;
+  xdmf->t_quantize = 0.;
+  xdmf->t_write = 0.;
 
   char filename[strlen(io->par.outdir) + strlen(io->par.basename) + 20];
   sprintf(filename, "%s/%s.%06d_p%06d.h5", io->par.outdir, io->par.basename,
@@ -151,11 +202,42 @@ xdmf_collective_close(struct mrc_io *io)
 
   xdmf_spatial_close(&file->xdmf_spatial_list, io, xdmf->xdmf_temporal);
   if (xdmf->is_writer) {
+    double t = MPI_Wtime();
     H5Fclose(file->h5_file);
+    xdmf->t_write += MPI_Wtime() - t;
     memset(file, 0, sizeof(*file));
   }
   free(xdmf->mode);
   xdmf->mode = NULL;
+
+  if (xdmf->bytes_written == 0.) {
+    return;
+  }
+
+  if (xdmf->benchmark) {
+    double t[3] = { xdmf->t_redist, xdmf->t_quantize, xdmf->t_write }, t_max[3];
+    MPI_Allreduce(t, t_max, 3, MPI_DOUBLE, MPI_MAX, mrc_io_comm(io));
+    double stored;
+    MPI_Allreduce(&xdmf->bytes_stored, &stored, 1, MPI_DOUBLE, MPI_SUM, mrc_io_comm(io));
+    double mb = xdmf->bytes_written / (1024. * 1024.);
+    mpi_printf(mrc_io_comm(io), "xdmf_collective: %s.%06d: %g MB, %d writers: "
+	       "redist %g s, quantize %g s, write %g s, %g MB/s, "
+	       "stored %g MB (ratio %g)\n", io->par.basename, io->step,
+	       mb, xdmf->nr_writers, t_max[0], t_max[1], t_max[2],
+	       mb / (t_max[0] + t_max[1] + t_max[2]), stored / (1024. * 1024.),
+	       xdmf->bytes_written / stored);
+  }
+
+#ifdef H5_HAVE_PARALLEL
+  if (xdmf->auto_writers) {
+    int nr_writers = mrc_redist_auto_nr_writers(xdmf->bytes_written,
+						xdmf->mb_per_writer, io->size);
+    if (nr_writers != xdmf->nr_writers) {
+      xdmf->nr_writers = nr_writers;
+      xdmf_collective_setup_writers(io);
+    }
+  }
+#endif
 }
 
 static void
@@ -261,9 +343,11 @@ xdmf_collective_read_attr(struct mrc_io *io, const char *path, int type,
       pv->u_bool = val;
       break;
     case PT_FLOAT:
+    case MRC_VAR_FLOAT:
       ierr = H5LTget_attribute_float(group, ".", name, &pv->u_float); CE;
       break;
     case PT_DOUBLE:
+    case MRC_VAR_DOUBLE:
       ierr = H5LTget_attribute_double(group, ".", name, &pv->u_double); CE;
       break;
     case PT_STRING: ;
@@ -285,10 +369,11 @@ xdmf_collective_read_attr(struct mrc_io *io, const char *path, int type,
       ierr = H5LTget_attribute_float(group, ".", name, pv->u_float3); CE;
       break;
     case PT_DOUBLE3:
+    case MRC_VAR_DOUBLE3:
       ierr = H5LTget_attribute_double(group, ".", name, pv->u_double3); CE;
       break;
     case PT_INT_ARRAY: {
-      int attr = H5Aopen(group, name, H5P_DEFAULT); H5_CHK(attr);
+      hid_t attr = H5Aopen(group, name, H5P_DEFAULT); H5_CHK(attr);
       H5A_info_t ainfo;
       ierr = H5Aget_info(attr, &ainfo); CE;
       ierr = H5Aclose(attr); CE;
@@ -322,9 +407,11 @@ xdmf_collective_read_attr(struct mrc_io *io, const char *path, int type,
     pv->u_int = val;
     break;
   case PT_FLOAT:
+  case MRC_VAR_FLOAT:
     MPI_Bcast(&pv->u_float, 1, MPI_FLOAT, root, comm);
     break;
   case PT_DOUBLE:
+  case MRC_VAR_DOUBLE:
     MPI_Bcast(&pv->u_double, 1, MPI_DOUBLE, root, comm);
     break;
   case PT_STRING: ;
@@ -352,6 +439,7 @@ xdmf_collective_read_attr(struct mrc_io *io, const char *path, int type,
     MPI_Bcast(pv->u_float3, 3, MPI_FLOAT, root, comm);
     break;
   case PT_DOUBLE3:
+  case MRC_VAR_DOUBLE3:
     MPI_Bcast(pv->u_double3, 3, MPI_DOUBLE, root, comm);
     break;
   case PT_INT_ARRAY:
@@ -805,6 +893,11 @@ xdmf_collective_read_m1(struct mrc_io *io, const char *path, struct mrc_fld *m1)
 // writer_write_fld
 // does the actual write of the partial fld to the file
 // only called on writer procs
+//
+// With compression, the dataset is chunked such that each writer's block
+// makes up (about) one chunk, and the writers compress their chunks in
+// parallel. Quantization happens in place, since nd is just the writer's
+// scratch copy of the field.
 
 static void
 writer_write_fld(struct mrc_redist *redist, struct mrc_io *io,
@@ -843,12 +936,29 @@ writer_write_fld(struct mrc_redist *redist, struct mrc_io *io,
   default: assert(0);
   }
 
+  struct xdmf *xdmf = to_xdmf(io);
+  double t = MPI_Wtime();
+  double eps = mrc_io_quantize(nd->arr, nd->len, mrc_ndarray_data_type(nd),
+			       xdmf->quantize_eps);
+  xdmf->t_quantize += MPI_Wtime() - t;
+
+  hsize_t cdims[3];
+  for (int d = 0; d < 3; d++) {
+    int np = redist->writer_np[d];
+    cdims[2 - d] = (redist->slab_dims[d] + np - 1) / np;
+  }
+  hid_t dcpl = mrc_io_compress_dcpl(xdmf->compression, xdmf->compression_level,
+				    3, fdims, cdims, nd->size_of_type);
+
   hid_t dset = H5Dcreate(group, "3d", dtype, filespace, H5P_DEFAULT,
-			 H5P_DEFAULT, H5P_DEFAULT); H5_CHK(dset);
+			 dcpl, H5P_DEFAULT); H5_CHK(dset);
+  if (eps > 0.) {
+    ierr = H5LTset_attribute_double(group, "3d", "quantize_eps", &eps, 1); CE;
+  }
   hid_t dxpl = H5Pcreate(H5P_DATASET_XFER); H5_CHK(dxpl);
 #ifdef H5_HAVE_PARALLEL
-  struct xdmf *xdmf = to_xdmf(io);
-  if (xdmf->use_independent_io) {
+  // filters need collective I/O
+  if (xdmf->use_independent_io && dcpl == H5P_DEFAULT) {
     ierr = H5Pset_dxpl_mpio(dxpl, H5FD_MPIO_INDEPENDENT); CE;
   } else {
     ierr = H5Pset_dxpl_mpio(dxpl, H5FD_MPIO_COLLECTIVE); CE;
@@ -864,7 +974,18 @@ writer_write_fld(struct mrc_redist *redist, struct mrc_io *io,
 			     mdims, NULL); CE;
 
   ierr = H5Dwrite(dset, dtype, memspace, filespace, dxpl, nd->arr); CE;
-  
+
+  int writer_rank;
+  MPI_Comm_rank(redist->comm_writers, &writer_rank);
+  if (writer_rank == 0) {
+    xdmf->bytes_stored += dcpl == H5P_DEFAULT ?
+      (double) fdims[0] * fdims[1] * fdims[2] * nd->size_of_type :
+      (double) H5Dget_storage_size(dset);
+  }
+
+  if (dcpl != H5P_DEFAULT) {
+    ierr = H5Pclose(dcpl); CE;
+  }
   ierr = H5Dclose(dset); CE;
   ierr = H5Sclose(memspace); CE;
   ierr = H5Sclose(filespace); CE;
@@ -884,7 +1005,7 @@ xdmf_collective_write_m3(struct mrc_io *io, const char *path, struct mrc_fld *m3
 
   struct mrc_redist redist[1];
   mrc_redist_init(redist, m3->_domain, xdmf->slab_off, xdmf->slab_dims,
-		  xdmf->nr_writers);
+		  xdmf->nr_writers, xdmf->writers);
 
   struct xdmf_file *file = &xdmf->file;
   struct xdmf_spatial *xs = xdmf_spatial_find(&file->xdmf_spatial_list,
@@ -924,12 +1045,18 @@ xdmf_collective_write_m3(struct mrc_io *io, const char *path, struct mrc_fld *m3
   struct mrc_ndarray *nd = mrc_redist_get_ndarray(redist, m3_soa);
 
   for (int m = 0; m < mrc_fld_nr_comps(m3); m++) {
+    double t = MPI_Wtime();
     mrc_redist_run(redist, nd, m3_soa, m);
+    xdmf->t_redist += MPI_Wtime() - t;
 
     if (redist->is_writer) {
+      t = MPI_Wtime();
       writer_write_fld(redist, io, path, nd, m, m3, xs, group0);
+      xdmf->t_write += MPI_Wtime() - t;
     }
   }
+  xdmf->bytes_written += (double) redist->slab_dims[0] * redist->slab_dims[1] *
+    redist->slab_dims[2] * mrc_fld_nr_comps(m3) * m3->_nd->size_of_type;
 
   mrc_redist_put_ndarray(redist, nd);
   
@@ -23,6 +23,9 @@ mrc_mat_csr_create(struct mrc_mat *mat)
   sub->_init_cols = NULL;
   sub->_nr_cols = NULL;
   sub->_nr_cols_alloced = NULL;
+
+  sub->_nonid_rows = NULL;
+  sub->_nonempty_rows = NULL;
   
   sub->is_assembled = false;
 }
@@ -88,6 +91,10 @@ mrc_mat_csr_destroy(struct mrc_mat *mat)
     assert(sub->_init_vals == NULL && sub->_init_cols == NULL &&
            sub->_nr_cols == NULL && sub->_nr_cols_alloced == NULL);
   }
+  free(sub->_nonid_rows);
+  free(sub->_nonempty_rows);
+  sub->_nonid_rows = NULL;
+  sub->_nonempty_rows = NULL;
 }
 
 // ----------------------------------------------------------------------
@@ -196,6 +203,53 @@ mrc_mat_csr_add_value(struct mrc_mat *mat, int row_idx, int col_idx, double val)
   sub->nr_vals += 1;
 }
 
+// ----------------------------------------------------------------------
+// _mrc_mat_csr_setup_row_lists
+//
+// For ghost filling (mrc_ddc_amr), most rows are identity rows for interior
+// points, and in the off-diagonal block of "csr_mpi" most rows are empty, so
+// apply_in_place / apply_add only need to visit a small fraction of rows.
+
+static void
+_mrc_mat_csr_setup_row_lists(struct mrc_mat *mat, const mrc_fld_data_t *vals,
+                             const int *cols, const int *rows)
+{
+  struct mrc_mat_csr *sub = mrc_mat_csr(mat);
+
+  // assembling again replaces the lists from before
+  free(sub->_nonid_rows);
+  free(sub->_nonempty_rows);
+
+  bool *is_nonid = calloc(sub->nr_rows, sizeof(*is_nonid));
+  sub->_nonid_rows = malloc(sub->nr_rows * sizeof(*sub->_nonid_rows));
+  sub->_nonempty_rows = malloc(sub->nr_rows * sizeof(*sub->_nonempty_rows));
+  sub->nr_nonid_rows = 0;
+  sub->nr_nonempty_rows = 0;
+  for (int row = 0; row < sub->nr_rows; row++) {
+    int nr_cols = rows[row + 1] - rows[row];
+    if (nr_cols > 0) {
+      sub->_nonempty_rows[sub->nr_nonempty_rows++] = row;
+    }
+    if (!(nr_cols == 1 && cols[rows[row]] == row && vals[rows[row]] == 1.)) {
+      sub->_nonid_rows[sub->nr_nonid_rows++] = row;
+      is_nonid[row] = true;
+    }
+  }
+
+  // applying in place, rows can only be done in parallel if none of them
+  // reads a value that another one overwrites
+  sub->_nonid_rows_independent = true;
+  for (int n = 0; n < sub->nr_nonid_rows; n++) {
+    int row = sub->_nonid_rows[n];
+    for (int i = rows[row]; i < rows[row + 1]; i++) {
+      if (cols[i] != row && cols[i] < sub->nr_rows && is_nonid[cols[i]]) {
+        sub->_nonid_rows_independent = false;
+      }
+    }
+  }
+  free(is_nonid);
+}
+
 // ----------------------------------------------------------------------
 // mrc_mat_csr_assemble
 
@@ -258,6 +312,8 @@ mrc_mat_csr_assemble(struct mrc_mat *mat)
   
   sub->_nr_rows_alloced = 0;
   sub->_nr_vals_alloced = 0;
+
+  _mrc_mat_csr_setup_row_lists(mat, vals, cols, rows);
   
   mrc_vec_put_array(sub->vals, vals);
   mrc_vec_put_array(sub->cols, cols);
@@ -295,9 +351,44 @@ mrc_mat_csr_print(struct mrc_mat *mat)
   }
 }
 
+// ----------------------------------------------------------------------
+// _mrc_mat_csr_apply_rows
+// z = alpha * mat * x + beta * y, for the given rows (or all, if row_list is NULL)
+
+static inline void
+_mrc_mat_csr_apply_rows(mrc_fld_data_t *z_arr, mrc_fld_data_t alpha,
+                        const mrc_fld_data_t *vals, const int *cols,
+                        const int *rows, const mrc_fld_data_t *x_arr,
+                        mrc_fld_data_t beta, const mrc_fld_data_t *y_arr,
+                        const int *row_list, int nr_rows, bool parallel)
+{
+  const bool non_zero_beta = beta != 0.0;
+
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+  for (int n = 0; n < nr_rows; n++) {
+    int row_idx = row_list ? row_list[n] : n;
+    mrc_fld_data_t sum = 0.0;
+    for (int i = rows[row_idx]; i < rows[row_idx + 1]; i++) {
+      sum += alpha * vals[i] * x_arr[cols[i]];
+    }
+    if (non_zero_beta) {
+      // this is protected by the if statement
+      // in case y_arr == NAN but beta == 0.0
+      sum += beta * y_arr[row_idx];
+    }
+    z_arr[row_idx] = sum;
+  }
+}
+
 // ----------------------------------------------------------------------
 // mrc_mat_csr_apply_gemv
 // z = alpha * mat * x + beta * y
+//
+// z may be the same vector as x and / or y. Working in place (z == x), rows
+// are processed in order, as before, unless the matrix is known to make that
+// unnecessary.
 
 static inline void
 _mrc_mat_csr_apply_gemv(struct mrc_vec *z, mrc_fld_data_t alpha,
@@ -305,7 +396,6 @@ _mrc_mat_csr_apply_gemv(struct mrc_vec *z, mrc_fld_data_t alpha,
                         mrc_fld_data_t beta, struct mrc_vec *y)
 {
   struct mrc_mat_csr *sub = mrc_mat_csr(mat);
-  const bool non_zero_beta = beta != 0.0;
   
   assert(mrc_vec_size_of_type(x) == sizeof(mrc_fld_data_t));
   assert(mrc_vec_size_of_type(y) == sizeof(mrc_fld_data_t));
@@ -324,18 +414,18 @@ _mrc_mat_csr_apply_gemv(struct mrc_vec *z, mrc_fld_data_t alpha,
   mrc_fld_data_t *y_arr = mrc_vec_get_array(y);
   mrc_fld_data_t *z_arr = mrc_vec_get_array(z);
 
-  for (int row_idx=0; row_idx < sub->nr_rows; row_idx++) {
-    mrc_fld_data_t sum = 0.0;
-    for (int i=rows[row_idx]; i < rows[row_idx + 1]; i++) {
-      int col_idx = cols[i];
-      sum += alpha * vals[i] * x_arr[col_idx];
-    }
-    if (non_zero_beta) {
-      // this is protected by the if statement
-      // in case y_arr == NAN but beta == 0.0
-      sum += beta * y_arr[row_idx];
-    }
-    z_arr[row_idx] = sum;
+  if (z_arr == x_arr && alpha == 1.0 && beta == 0.0) {
+    // x = mat * x: identity rows leave x unchanged
+    _mrc_mat_csr_apply_rows(z_arr, alpha, vals, cols, rows, x_arr, beta, y_arr,
+                            sub->_nonid_rows, sub->nr_nonid_rows,
+                            sub->_nonid_rows_independent);
+  } else if (z_arr == y_arr && z_arr != x_arr && alpha == 1.0 && beta == 1.0) {
+    // y = mat * x + y: empty rows leave y unchanged
+    _mrc_mat_csr_apply_rows(z_arr, alpha, vals, cols, rows, x_arr, beta, y_arr,
+                            sub->_nonempty_rows, sub->nr_nonempty_rows, true);
+  } else {
+    _mrc_mat_csr_apply_rows(z_arr, alpha, vals, cols, rows, x_arr, beta, y_arr,
+                            NULL, sub->nr_rows, z_arr != x_arr);
   }
 
   mrc_vec_put_array(x, x_arr);
@@ -100,6 +100,13 @@ static void
 mrc_mat_mcsr_assemble(struct mrc_mat *mat)
 {
   struct mrc_mat_mcsr *sub = mrc_mat_mcsr(mat);
+
+  // apply() / apply_add() write each row from a different thread, which is
+  // only safe if no row was started twice
+  for (int row = 1; row < sub->nr_rows; row++) {
+    assert(sub->rows[row].idx > sub->rows[row - 1].idx);
+  }
+
   mrc_mat_mcsr_realloc_rows_if_needed(mat, 0);
   sub->rows[sub->nr_rows].first_entry = sub->nr_entries;
 }
@@ -140,6 +147,10 @@ mrc_mat_mcsr_apply(struct mrc_vec *y, struct mrc_mat *mat, struct mrc_vec *x)
   mrc_fld_data_t *x_arr = mrc_vec_get_array(x);
   mrc_fld_data_t *y_arr = mrc_vec_get_array(y);
     
+  // each row appears only once (checked in assemble), so rows are independent
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
   for (int row = 0; row < sub->nr_rows; row++) {
     int row_idx = sub->rows[row].idx;
     mrc_fld_data_t sum = 0.;
@@ -168,6 +179,9 @@ mrc_mat_mcsr_apply_add(struct mrc_vec *y, struct mrc_mat *mat, struct mrc_vec *x
   mrc_fld_data_t *x_arr = mrc_vec_get_array(x);
   mrc_fld_data_t *y_arr = mrc_vec_get_array(y);
     
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
   for (int row = 0; row < sub->nr_rows; row++) {
     int row_idx = sub->rows[row].idx;
     mrc_fld_data_t sum = 0.;
@@ -180,6 +194,9 @@ mrc_mat_mcsr_apply_add(struct mrc_vec *y, struct mrc_mat *mat, struct mrc_vec *x
     // FIXME, the only difference to apply() is the "+" in "+=", should be consolidated
     y_arr[row_idx] += sum;
   }
+
+  mrc_vec_put_array(x, x_arr);
+  mrc_vec_put_array(y, y_arr);
 }
 
 // ----------------------------------------------------------------------
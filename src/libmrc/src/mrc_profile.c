@@ -66,6 +66,19 @@ prof_register(const char *name, float simd, int flops, int bytes)
   return nr_prof_data;
 }
 
+// returns the handle of the timer registered under name, or 0 if there is none
+
+int
+prof_find(const char *name)
+{
+  for (int pr = 0; pr < nr_prof_data; pr++) {
+    if (strcmp(prof_data[pr].name, name) == 0) {
+      return pr + 1;
+    }
+  }
+  return 0;
+}
+
 void
 prof_print()
 {
@@ -2,11 +2,216 @@
 #include <mrc_redist.h>
 #include <mrc_domain.h>
 
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
+
+// ----------------------------------------------------------------------
+// mrc_redist_node_of_rank
+//
+// finds which node (shared memory domain) each rank in comm is on, nodes
+// being numbered in the order of their lowest rank. Returns the number of
+// nodes.
+
+static int
+mrc_redist_node_of_rank(MPI_Comm comm, int *node_of_rank)
+{
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  MPI_Comm node_comm;
+  MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_comm);
+  // each node is identified by its lowest rank, which is rank 0 in node_comm
+  int leader = rank;
+  MPI_Bcast(&leader, 1, MPI_INT, 0, node_comm);
+  MPI_Comm_free(&node_comm);
+
+  int *leaders = calloc(size, sizeof(*leaders));
+  MPI_Allgather(&leader, 1, MPI_INT, leaders, 1, MPI_INT, comm);
+
+  int nr_nodes = 0;
+  for (int r = 0; r < size; r++) {
+    if (leaders[r] == r) {
+      node_of_rank[r] = nr_nodes++;
+    } else {
+      assert(leaders[r] < r);
+      node_of_rank[r] = node_of_rank[leaders[r]];
+    }
+  }
+  free(leaders);
+  return nr_nodes;
+}
+
+// ----------------------------------------------------------------------
+// mrc_redist_nr_nodes
+
+int
+mrc_redist_nr_nodes(MPI_Comm comm)
+{
+  int size;
+  MPI_Comm_size(comm, &size);
+  int *node_of_rank = calloc(size, sizeof(*node_of_rank));
+  int nr_nodes = mrc_redist_node_of_rank(comm, node_of_rank);
+  free(node_of_rank);
+  return nr_nodes;
+}
+
+// ----------------------------------------------------------------------
+// mrc_redist_place_writers
+//
+// picks nr_writers out of size ranks, given which of nr_nodes nodes each
+// rank is on: spread evenly over the nodes (round robin, so no node gets a
+// second writer before every node has one), and evenly over the ranks
+// within each node. The result is in ascending order; rank 0 is always the
+// first writer.
+
+static int
+cmp_int(const void *a, const void *b)
+{
+  return *(const int *) a - *(const int *) b;
+}
+
+void
+mrc_redist_place_writers(int size, const int *node_of_rank, int nr_nodes,
+			 int nr_writers, int *writer_ranks)
+{
+  assert(nr_writers >= 1 && nr_writers <= size);
+
+  int *node_size = calloc(nr_nodes, sizeof(*node_size));
+  for (int r = 0; r < size; r++) {
+    node_size[node_of_rank[r]]++;
+  }
+
+  int *node_writers = calloc(nr_nodes, sizeof(*node_writers));
+  for (int w = 0; w < nr_writers; ) {
+    for (int n = 0; n < nr_nodes && w < nr_writers; n++) {
+      if (node_writers[n] < node_size[n]) {
+	node_writers[n]++;
+	w++;
+      }
+    }
+  }
+
+  // the i-th of a node's w writers is its (i * size / w)-th rank
+  int *node_rank = calloc(nr_nodes, sizeof(*node_rank));
+  int *node_next = calloc(nr_nodes, sizeof(*node_next));
+  int w = 0;
+  for (int r = 0; r < size; r++) {
+    int n = node_of_rank[r];
+    int i = node_next[n];
+    if (i < node_writers[n] && node_rank[n] == i * node_size[n] / node_writers[n]) {
+      writer_ranks[w++] = r;
+      node_next[n]++;
+    }
+    node_rank[n]++;
+  }
+  assert(w == nr_writers);
+  qsort(writer_ranks, nr_writers, sizeof(*writer_ranks), cmp_int);
+
+  free(node_next);
+  free(node_rank);
+  free(node_writers);
+  free(node_size);
+}
+
+// ----------------------------------------------------------------------
+// mrc_redist_select_writers
+//
+// mrc_redist_place_writers() for the nodes comm actually runs on; the
+// result is the same on all ranks
+
+void
+mrc_redist_select_writers(MPI_Comm comm, int nr_writers, int *writer_ranks)
+{
+  int size;
+  MPI_Comm_size(comm, &size);
+
+  int *node_of_rank = calloc(size, sizeof(*node_of_rank));
+  int nr_nodes = mrc_redist_node_of_rank(comm, node_of_rank);
+  mrc_redist_place_writers(size, node_of_rank, nr_nodes, nr_writers, writer_ranks);
+  free(node_of_rank);
+}
+
+// ----------------------------------------------------------------------
+// mrc_redist_auto_nr_writers
+//
+// how many writers to use for an output of the given size, so that each
+// writes about mb_per_writer MB, but at least 1 and at most max_writers
+
+int
+mrc_redist_auto_nr_writers(double bytes, int mb_per_writer, int max_writers)
+{
+  double mb = bytes / (1024. * 1024.);
+  int nr_writers = (int) ceil(mb / mb_per_writer);
+  return MAX(1, MIN(nr_writers, max_writers));
+}
+
+// ----------------------------------------------------------------------
+// mrc_redist_decompose
+//
+// lays out nr_writers over a slab of slab_dims (in a domain of gdims) as
+// writer_np[0] x writer_np[1] x writer_np[2]. Each writer preferably gets a
+// range of the slowest varying dimension, so it writes a contiguous part of
+// the file. Only if there are more writers than cells in that dimension
+// (e.g., a 2-d run with short z), the next slower dimension gets split,
+// too, with the factorization that keeps the writers' blocks closest to
+// square.
+
+void
+mrc_redist_decompose(int nr_writers, const int gdims[3], const int slab_dims[3],
+		     int writer_np[3])
+{
+  for (int d = 0; d < 3; d++) {
+    writer_np[d] = 1;
+  }
+
+  int slow_dim = 2;
+  while (gdims[slow_dim] == 1) {
+    slow_dim--;
+  }
+  assert(slow_dim >= 0);
+  int mid_dim = slow_dim - 1;
+  while (mid_dim >= 0 && gdims[mid_dim] == 1) {
+    mid_dim--;
+  }
+
+  writer_np[slow_dim] = nr_writers;
+  if (slab_dims[slow_dim] >= nr_writers || mid_dim < 0) {
+    return;
+  }
+
+  double best = -1.;
+  for (int n_slow = 1; n_slow <= nr_writers; n_slow++) {
+    int n_mid = nr_writers / n_slow;
+    if (n_slow * n_mid != nr_writers ||
+	n_slow > slab_dims[slow_dim] || n_mid > slab_dims[mid_dim]) {
+      continue;
+    }
+    double aspect = ((double) slab_dims[slow_dim] / n_slow) /
+      ((double) slab_dims[mid_dim] / n_mid);
+    if (aspect < 1.) {
+      aspect = 1. / aspect;
+    }
+    if (best < 0. || aspect < best) {
+      best = aspect;
+      writer_np[slow_dim] = n_slow;
+      writer_np[mid_dim] = n_mid;
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// mrc_redist_init
+//
+// writer_ranks are the ranks (in ascending order) that will hold the
+// redistributed data, as from mrc_redist_select_writers(); if NULL, those
+// get selected here
 
 void
 mrc_redist_init(struct mrc_redist *redist, struct mrc_domain *domain,
-		int slab_offs[3], int slab_dims[3], int nr_writers)
+		int slab_offs[3], int slab_dims[3], int nr_writers,
+		const int *writer_ranks)
 {
   redist->domain = domain;
   redist->comm = mrc_domain_comm(domain);
@@ -15,24 +220,24 @@ mrc_redist_init(struct mrc_redist *redist, struct mrc_domain *domain,
 
   redist->nr_writers = nr_writers;
   redist->writer_ranks = calloc(nr_writers, sizeof(*redist->writer_ranks));
-  // setup writers, just use first nr_writers ranks,
-  // could do something fancier in the future
+  if (writer_ranks) {
+    memcpy(redist->writer_ranks, writer_ranks, nr_writers * sizeof(*writer_ranks));
+  } else {
+    mrc_redist_select_writers(redist->comm, nr_writers, redist->writer_ranks);
+  }
   redist->is_writer = 0;
   for (int i = 0; i < nr_writers; i++) {
-    redist->writer_ranks[i] = i;
-    if (i == redist->rank) {
+    assert(i == 0 || redist->writer_ranks[i] > redist->writer_ranks[i-1]);
+    if (redist->writer_ranks[i] == redist->rank) {
       redist->is_writer = 1;
     }
   }
   
+  // with the writer ranks ascending, writer i is rank i in comm_writers
   MPI_Comm_split(redist->comm, redist->is_writer, redist->rank, &redist->comm_writers);
 
   int gdims[3];
   mrc_domain_get_global_dims(domain, gdims);
-  int nr_patches;
-  mrc_domain_get_patches(domain, &nr_patches);
-  int nr_global_patches;
-  mrc_domain_get_nr_global_patches(domain, &nr_global_patches);
   for (int d = 0; d < 3; d++) {
     if (slab_dims[d]) {
       redist->slab_dims[d] = slab_dims[d];
@@ -41,14 +246,7 @@ mrc_redist_init(struct mrc_redist *redist, struct mrc_domain *domain,
     }
     redist->slab_offs[d] = slab_offs[d];
   }
-  redist->slow_dim = 2;
-  while (gdims[redist->slow_dim] == 1) {
-    redist->slow_dim--;
-  }
-  assert(redist->slow_dim >= 0);
-  int total_slow_indices = redist->slab_dims[redist->slow_dim];
-  redist->slow_indices_per_writer = total_slow_indices / nr_writers;
-  redist->slow_indices_rmndr = total_slow_indices % nr_writers;
+  mrc_redist_decompose(nr_writers, gdims, redist->slab_dims, redist->writer_np);
 }
 
 void
@@ -58,20 +256,24 @@ mrc_redist_destroy(struct mrc_redist *redist)
   MPI_Comm_free(&redist->comm_writers);
 }
 
-static void
+// ----------------------------------------------------------------------
+// mrc_redist_writer_offs_dims
+//
+// the part of the slab that the given writer ends up with
+
+void
 mrc_redist_writer_offs_dims(struct mrc_redist *redist, int writer,
 			    int *writer_offs, int *writer_dims)
 {
   for (int d = 0; d < 3; d++) {
-    writer_dims[d] = redist->slab_dims[d];
-    writer_offs[d] = redist->slab_offs[d];
-  }
-  writer_dims[redist->slow_dim] = redist->slow_indices_per_writer + (writer < redist->slow_indices_rmndr);
-  if (writer < redist->slow_indices_rmndr) {
-    writer_offs[redist->slow_dim] += (redist->slow_indices_per_writer + 1) * writer;
-  } else {
-    writer_offs[redist->slow_dim] += redist->slow_indices_rmndr +
-      redist->slow_indices_per_writer * writer;
+    int np = redist->writer_np[d];
+    int i = writer % np;
+    writer /= np;
+
+    int per_writer = redist->slab_dims[d] / np;
+    int rmndr = redist->slab_dims[d] % np;
+    writer_dims[d] = per_writer + (i < rmndr);
+    writer_offs[d] = redist->slab_offs[d] + per_writer * i + MIN(i, rmndr);
   }
 }
 
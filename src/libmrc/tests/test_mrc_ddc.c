@@ -108,10 +108,17 @@ main(int argc, char **argv)
   mrc_ddc_setup(ddc);
   mrc_ddc_view(ddc);
   mrc_ddc_fill_ghosts_fld(ddc, 0, 2, m3);
-  mrc_ddc_destroy(ddc);
+  check_m3(m3);
 
+  // same again, using the split begin / end version
+  mrc_fld_set(m3, 0.);
+  set_m3(m3);
+  mrc_ddc_fill_ghosts_fld_begin(ddc, 0, 2, m3);
+  mrc_ddc_fill_ghosts_fld_end(ddc, 0, 2, m3);
   check_m3(m3);
 
+  mrc_ddc_destroy(ddc);
+
   mrc_fld_destroy(m3);
 
   mrc_domain_destroy(domain);
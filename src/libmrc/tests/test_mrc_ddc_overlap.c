@@ -0,0 +1,236 @@
+
+// Checks that computing fluxes while the ghost points are being filled
+// (as done by the c3 / mhdcc steppers with overlap_ghosts) gives the same
+// result as filling the ghost points first: the interior faces are found
+// between mrc_ddc_fill_ghosts_fld_begin() and _end(), with the ghost
+// points set to NaN, and the remaining faces afterwards.
+
+#include <mrc_fld_as_double.h>
+#include <mrc_params.h>
+#include <mrc_domain.h>
+#include <mrc_ddc.h>
+
+#include "../mhd/src/pde/pde_defs.h"
+#include "../mhd/src/pde/pde_setup.c"
+
+#include <stdio.h>
+#include <assert.h>
+
+#define N_COMPS (2)
+#define SW (2) // flux at face i depends on cells i - SW .. i + SW - 1
+
+// ----------------------------------------------------------------------
+// set_U
+//
+// interior cells get some smooth function of the global position, ghost
+// points get NaN so that using them before they're filled would show
+
+static void
+set_U(struct mrc_fld *U)
+{
+  mrc_fld_set(U, NAN);
+
+  pde_for_each_patch(p) {
+    fld3d_t p_U;
+    fld3d_setup(&p_U, U);
+    fld3d_get(&p_U, p);
+    fld3d_foreach(i,j,k, 0, 0) {
+      double x = i + s_patch.off[0], y = j + s_patch.off[1], z = k + s_patch.off[2];
+      F3S(p_U, 0, i,j,k) = sin(.3 * x) + cos(.2 * y) + .1 * z;
+      F3S(p_U, 1, i,j,k) = 1. + .01 * x * y - sin(.4 * z);
+    } fld3d_foreach_end;
+    fld3d_put(&p_U, p);
+  }
+}
+
+// ----------------------------------------------------------------------
+// patch_flux
+//
+// a nonlinear 4-point stencil, along each interior line
+
+static void
+patch_flux(fld3d_t p_F[3], fld3d_t p_U, int part)
+{
+  pde_for_each_dir(dir) {
+    int fb[2], fe[2];
+    int n_ranges = pde_line_face_ranges(dir, SW, part, fb, fe);
+    pde_for_each_line(dir, j, k, 0) {
+      for (int r = 0; r < n_ranges; r++) {
+	for (int i = fb[r]; i < fe[r]; i++) {
+	  int ix[4], iy[4], iz[4];
+	  for (int s = 0; s < 4; s++) {
+	    int ii = i - SW + s;
+	    if (dir == 0) {
+	      ix[s] = ii; iy[s] = j; iz[s] = k;
+	    } else if (dir == 1) {
+	      ix[s] = k; iy[s] = ii; iz[s] = j;
+	    } else {
+	      ix[s] = j; iy[s] = k; iz[s] = ii;
+	    }
+	  }
+	  for (int m = 0; m < N_COMPS; m++) {
+#define U(s) F3S(p_U, m, ix[s], iy[s], iz[s])
+	    double flux = U(0) - 3. * U(1) + 3. * U(2) + .5 * U(1) * U(3);
+#undef U
+	    if (dir == 0) {
+	      F3S(p_F[dir], m, i,j,k) = flux;
+	    } else if (dir == 1) {
+	      F3S(p_F[dir], m, k,i,j) = flux;
+	    } else {
+	      F3S(p_F[dir], m, j,k,i) = flux;
+	    }
+	  }
+	}
+      }
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// calc_flux
+
+static void
+calc_flux(struct mrc_fld *F[3], struct mrc_fld *U, int part)
+{
+  pde_for_each_patch(p) {
+    fld3d_t p_U, p_F[3];
+    fld3d_setup(&p_U, U);
+    for (int d = 0; d < 3; d++) {
+      fld3d_setup(&p_F[d], F[d]);
+    }
+    fld3d_t *patches[] = { &p_U, &p_F[0], &p_F[1], &p_F[2], NULL };
+    fld3d_get_list(p, patches);
+    patch_flux(p_F, p_U, part);
+    fld3d_put_list(p, patches);
+  }
+}
+
+// ----------------------------------------------------------------------
+// check_flux
+//
+// compares all faces of interior lines
+
+static int
+check_flux(struct mrc_fld *F_ref[3], struct mrc_fld *F[3])
+{
+  int n_err = 0, n_faces = 0;
+  pde_for_each_patch(p) {
+    fld3d_t p_F_ref[3], p_F[3];
+    for (int d = 0; d < 3; d++) {
+      fld3d_setup(&p_F_ref[d], F_ref[d]);
+      fld3d_setup(&p_F[d], F[d]);
+      fld3d_get(&p_F_ref[d], p);
+      fld3d_get(&p_F[d], p);
+    }
+    pde_for_each_dir(dir) {
+      int r[3] = {};
+      r[dir] = 1;
+      for (int k = 0; k < s_ldims[2] + r[2]; k++) {
+	for (int j = 0; j < s_ldims[1] + r[1]; j++) {
+	  for (int i = 0; i < s_ldims[0] + r[0]; i++) {
+	    for (int m = 0; m < N_COMPS; m++) {
+	      double ref = F3S(p_F_ref[dir], m, i,j,k);
+	      double val = F3S(p_F[dir], m, i,j,k);
+	      n_faces++;
+	      if (!(val == ref)) { // also catches NaN
+		if (n_err++ < 10) {
+		  mprintf("p %d dir %d m %d [%d,%d,%d]: %g ref %g\n",
+			  p, dir, m, i, j, k, val, ref);
+		}
+	      }
+	    }
+	  }
+	}
+      }
+    }
+    for (int d = 0; d < 3; d++) {
+      fld3d_put(&p_F_ref[d], p);
+      fld3d_put(&p_F[d], p);
+    }
+  }
+  assert(n_faces > 0);
+  return n_err;
+}
+
+// ----------------------------------------------------------------------
+// create_fld
+
+static struct mrc_fld *
+create_fld(struct mrc_domain *domain, const char *name)
+{
+  struct mrc_fld *fld = mrc_fld_create(mrc_domain_comm(domain));
+  mrc_fld_set_name(fld, name);
+  mrc_fld_set_type(fld, FLD_TYPE);
+  mrc_fld_set_param_obj(fld, "domain", domain);
+  mrc_fld_set_param_int(fld, "nr_spatial_dims", 3);
+  mrc_fld_set_param_int(fld, "nr_comps", N_COMPS);
+  mrc_fld_set_param_int(fld, "nr_ghosts", SW);
+  mrc_fld_setup(fld);
+  return fld;
+}
+
+int
+main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+  libmrc_params_init(argc, argv);
+
+  // several patches per rank, so there is exchange both between patches on
+  // the same rank and (when run on more than one rank) via MPI
+  struct mrc_domain *domain = mrc_domain_create(MPI_COMM_WORLD);
+  mrc_domain_set_type(domain, "multi");
+  mrc_domain_set_param_int3(domain, "m", (int [3]) { 16, 12, 8 });
+  mrc_domain_set_param_int3(domain, "np", (int [3]) { 2, 2, 2 });
+  mrc_domain_set_param_int(domain, "bcx", BC_PERIODIC);
+  mrc_domain_set_param_int(domain, "bcy", BC_PERIODIC);
+  mrc_domain_set_param_int(domain, "bcz", BC_PERIODIC);
+  mrc_domain_set_from_options(domain);
+  mrc_domain_setup(domain);
+
+  struct mrc_fld *U = create_fld(domain, "U");
+  struct mrc_fld *F_ref[3], *F[3];
+  for (int d = 0; d < 3; d++) {
+    F_ref[d] = create_fld(domain, "F_ref");
+    F[d] = create_fld(domain, "F");
+  }
+  pde_setup(U, N_COMPS);
+
+  struct mrc_ddc *ddc = mrc_domain_get_ddc(domain);
+
+  // without overlap: fill ghosts, then find all fluxes
+  set_U(U);
+  mrc_ddc_fill_ghosts_fld(ddc, 0, N_COMPS, U);
+  calc_flux(F_ref, U, PDE_FACES_ALL);
+
+  // with overlap
+  set_U(U);
+  mrc_ddc_fill_ghosts_fld_begin(ddc, 0, N_COMPS, U);
+  calc_flux(F, U, PDE_FACES_INTERIOR);
+  mrc_ddc_fill_ghosts_fld_end(ddc, 0, N_COMPS, U);
+  calc_flux(F, U, PDE_FACES_BOUNDARY);
+
+  int n_err = check_flux(F_ref, F);
+
+  // _begin() may already have filled some of the ghost points (those from
+  // patches on the same rank), so also check that the interior faces don't
+  // need any of them
+  set_U(U);
+  calc_flux(F, U, PDE_FACES_INTERIOR);
+  mrc_ddc_fill_ghosts_fld(ddc, 0, N_COMPS, U);
+  calc_flux(F, U, PDE_FACES_BOUNDARY);
+
+  n_err += check_flux(F_ref, F);
+  MPI_Allreduce(MPI_IN_PLACE, &n_err, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  mpi_printf(MPI_COMM_WORLD, "test_mrc_ddc_overlap: %d mismatches\n", n_err);
+
+  pde_free();
+  for (int d = 0; d < 3; d++) {
+    mrc_fld_destroy(F_ref[d]);
+    mrc_fld_destroy(F[d]);
+  }
+  mrc_fld_destroy(U);
+  mrc_domain_destroy(domain);
+
+  MPI_Finalize();
+  return n_err ? 1 : 0;
+}
@@ -35,6 +35,42 @@ test_read_write(struct mrc_domain *domain)
   mrc_domain_destroy(domain2);
 }
 
+// check that global patch -> rank / local patch lookup is consistent with
+// the local patches of each rank
+
+static void
+test_global_patch_info(struct mrc_domain *domain)
+{
+  int rank;
+  MPI_Comm_rank(mrc_domain_comm(domain), &rank);
+
+  int nr_patches, nr_global_patches;
+  mrc_domain_get_patches(domain, &nr_patches);
+  mrc_domain_get_nr_global_patches(domain, &nr_global_patches);
+
+  int last_rank = 0, last_patch = -1;
+  for (int gp = 0; gp < nr_global_patches; gp++) {
+    struct mrc_patch_info info;
+    mrc_domain_get_global_patch_info(domain, gp, &info);
+    assert(info.global_patch == gp);
+    if (info.rank == last_rank) {
+      assert(info.patch == last_patch + 1);
+    } else {
+      assert(info.rank > last_rank);
+      assert(info.patch == 0);
+    }
+    last_rank = info.rank;
+    last_patch = info.patch;
+  }
+
+  for (int p = 0; p < nr_patches; p++) {
+    struct mrc_patch_info info;
+    mrc_domain_get_local_patch_info(domain, p, &info);
+    assert(info.rank == rank);
+    assert(info.patch == p);
+  }
+}
+
 int
 main(int argc, char **argv)
 {
@@ -63,6 +99,12 @@ main(int argc, char **argv)
     mrctest_set_crds_rectilinear_1(domain);
     test_read_write(domain);
     break;
+  case 3:
+    mrc_crds_set_type(crds, "uniform");
+    mrc_domain_set_from_options(domain);
+    mrc_domain_setup(domain);
+    test_global_patch_info(domain);
+    break;
   }
   mrc_domain_destroy(domain);
 
@@ -0,0 +1,257 @@
+
+// Checks mrc_io_quantize(): the error stays within eps (and within the bound
+// it returns), the results are multiples of the quantum and don't change
+// when quantized again, and special values survive. Then writes a field
+// through xdmf_collective with quantize_eps set, and checks that what's
+// read back is within eps, too.
+
+#include <mrc_fld_as_float.h>
+#include <mrc_params.h>
+#include <mrc_domain.h>
+#include <mrc_io.h>
+#include <mrc_io_compress.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <assert.h>
+
+#define N (1000)
+
+static int n_err;
+
+#define CHECK(cond) do {						\
+    if (!(cond)) {							\
+      if (n_err++ < 20) {						\
+	mprintf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      }									\
+    }									\
+  } while (0)
+
+// ----------------------------------------------------------------------
+// value
+//
+// values over many orders of magnitude, both signs, and some special ones
+
+static double
+value(int i, double big)
+{
+  switch (i) {
+  case 0: return 0.;
+  case 1: return -0.;
+  case 2: return big;
+  case 3: return -big;
+  case 4: return NAN;
+  case 5: return INFINITY;
+  case 6: return -INFINITY;
+  case 7: return 1e30;
+  }
+  return sin(.37 * i) * pow(10., i % 17 - 8);
+}
+
+// ----------------------------------------------------------------------
+// check_quantized
+//
+// x are the original values, xq the quantized ones
+
+static void
+check_quantized(const double *x, const double *xq, double eps, double bound)
+{
+  // (except that there is no quantum of 2^1024 for eps close to DBL_MAX)
+  CHECK(bound <= eps && (bound > .5 * eps || bound == 0x1p1022));
+  double q = 2. * bound;
+  for (int i = 0; i < N; i++) {
+    if (isnan(x[i])) {
+      CHECK(isnan(xq[i]));
+    } else if (isinf(x[i])) {
+      CHECK(xq[i] == x[i]);
+    } else {
+      CHECK(isfinite(xq[i]));
+      CHECK(fabs(x[i] - xq[i]) <= bound);
+      // (values that would round to beyond the largest finite one are
+      // left alone)
+      CHECK(fmod(xq[i], q) == 0. || xq[i] == x[i]);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// test_quantize_float
+
+static void
+test_quantize_float(double eps)
+{
+  float a[N], a2[N];
+  double x[N], xq[N];
+  for (int i = 0; i < N; i++) {
+    a[i] = value(i, FLT_MAX);
+    x[i] = a[i];
+  }
+  double bound = mrc_io_quantize(a, N, MRC_NT_FLOAT, eps);
+  for (int i = 0; i < N; i++) {
+    xq[i] = a[i];
+  }
+  check_quantized(x, xq, eps, bound);
+
+  memcpy(a2, a, sizeof(a));
+  CHECK(mrc_io_quantize(a2, N, MRC_NT_FLOAT, eps) == bound);
+  CHECK(memcmp(a, a2, sizeof(a)) == 0);
+}
+
+// ----------------------------------------------------------------------
+// test_quantize_double
+
+static void
+test_quantize_double(double eps)
+{
+  double a[N], a2[N], x[N];
+  for (int i = 0; i < N; i++) {
+    a[i] = value(i, DBL_MAX);
+    x[i] = a[i];
+  }
+  double bound = mrc_io_quantize(a, N, MRC_NT_DOUBLE, eps);
+  check_quantized(x, a, eps, bound);
+
+  memcpy(a2, a, sizeof(a));
+  CHECK(mrc_io_quantize(a2, N, MRC_NT_DOUBLE, eps) == bound);
+  CHECK(memcmp(a, a2, sizeof(a)) == 0);
+}
+
+// ----------------------------------------------------------------------
+// test_quantize_nop
+//
+// cases where nothing should be done at all
+
+static void
+test_quantize_nop()
+{
+  double eps_nop[] = { 0., -1., NAN, INFINITY };
+  for (int n = 0; n < 4; n++) {
+    double a[N], a2[N];
+    for (int i = 0; i < N; i++) {
+      a[i] = a2[i] = value(i, DBL_MAX);
+    }
+    CHECK(mrc_io_quantize(a, N, MRC_NT_DOUBLE, eps_nop[n]) == 0.);
+    CHECK(memcmp(a, a2, sizeof(a)) == 0);
+  }
+
+  // a quantum too small for a float
+  float f[N], f2[N];
+  for (int i = 0; i < N; i++) {
+    f[i] = f2[i] = value(i, FLT_MAX);
+  }
+  CHECK(mrc_io_quantize(f, N, MRC_NT_FLOAT, 1e-40) == 0.);
+  CHECK(memcmp(f, f2, sizeof(f)) == 0);
+
+  int ia[N], ia2[N];
+  for (int i = 0; i < N; i++) {
+    ia[i] = ia2[i] = i * 12345;
+  }
+  CHECK(mrc_io_quantize(ia, N, MRC_NT_INT, 10.) == 0.);
+  CHECK(memcmp(ia, ia2, sizeof(ia)) == 0);
+}
+
+// ----------------------------------------------------------------------
+// test_xdmf_collective
+//
+// a quantized field, written by xdmf_collective and read back
+
+static float
+fld_val(int m, int i, int j, int k)
+{
+  return (m + 1) * sin(.3 * i + .2 * j + .1 * k);
+}
+
+static void
+test_xdmf_collective(MPI_Comm comm, double eps)
+{
+  struct mrc_domain *domain = mrc_domain_create(comm);
+  mrc_domain_set_type(domain, "multi");
+  mrc_domain_set_param_int3(domain, "m", (int [3]) { 16, 8, 4 });
+  mrc_domain_set_param_int3(domain, "np", (int [3]) { 2, 2, 1 });
+  mrc_domain_setup(domain);
+
+  struct mrc_fld *fld = mrc_domain_fld_create(domain, 0, "a,b");
+  mrc_fld_set_type(fld, FLD_TYPE);
+  mrc_fld_setup(fld);
+  mrc_fld_foreach_patch(fld, p) {
+    struct mrc_patch_info info;
+    mrc_domain_get_local_patch_info(domain, p, &info);
+    mrc_fld_foreach(fld, i,j,k, 0, 0) {
+      for (int m = 0; m < 2; m++) {
+	M3(fld, m, i,j,k, p) = fld_val(m, info.off[0] + i, info.off[1] + j,
+				       info.off[2] + k);
+      }
+    } mrc_fld_foreach_end;
+  }
+
+  struct mrc_io *io = mrc_io_create(comm);
+  mrc_io_set_type(io, "xdmf_collective");
+  mrc_io_set_param_string(io, "basename", "test_quantize");
+  mrc_io_set_param_double(io, "quantize_eps", eps);
+  mrc_io_setup(io);
+  mrc_io_open(io, "w", 0, 0.);
+  mrc_io_write_path(io, "/fld", "fld", fld);
+  mrc_io_close(io);
+  mrc_io_destroy(io);
+
+  io = mrc_io_create(comm);
+  mrc_io_set_type(io, "xdmf_collective");
+  mrc_io_set_param_string(io, "basename", "test_quantize");
+  mrc_io_setup(io);
+  mrc_io_open(io, "r", 0, 0.);
+  // (reading back the whole object doesn't work for xdmf_collective, since
+  // its crds can't be restored, so just the data goes into a new field)
+  struct mrc_fld *fld2 = mrc_domain_fld_create(domain, 0, "a,b");
+  mrc_fld_set_type(fld2, FLD_TYPE);
+  mrc_fld_setup(fld2);
+  char *path;
+  mrc_io_read_attr_string(io, "/fld", "fld", &path);
+  mrc_io_read_fld(io, path, fld2);
+  free(path);
+  mrc_io_close(io);
+  mrc_io_destroy(io);
+
+  int n_changed = 0;
+  mrc_fld_foreach_patch(fld, p) {
+    mrc_fld_foreach(fld, i,j,k, 0, 0) {
+      for (int m = 0; m < 2; m++) {
+	float v = M3(fld, m, i,j,k, p), v2 = M3(fld2, m, i,j,k, p);
+	CHECK(fabs(v - v2) <= eps);
+	n_changed += v != v2;
+      }
+    } mrc_fld_foreach_end;
+  }
+  // otherwise, this would not test much
+  MPI_Allreduce(MPI_IN_PLACE, &n_changed, 1, MPI_INT, MPI_SUM, comm);
+  CHECK(n_changed > 0);
+
+  mrc_fld_destroy(fld2);
+  mrc_fld_destroy(fld);
+  mrc_domain_destroy(domain);
+}
+
+int
+main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+  libmrc_params_init(argc, argv);
+
+  double eps[] = { 1e-30, 1e-7, 1e-3, .3, 1., 1000., 1e38, 1e300, DBL_MAX };
+  for (int n = 0; n < (int) (sizeof(eps) / sizeof(eps[0])); n++) {
+    if (eps[n] >= FLT_MIN) {
+      test_quantize_float(eps[n]);
+    }
+    test_quantize_double(eps[n]);
+  }
+  test_quantize_nop();
+  test_xdmf_collective(MPI_COMM_WORLD, 1e-3);
+
+  MPI_Allreduce(MPI_IN_PLACE, &n_err, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  mpi_printf(MPI_COMM_WORLD, "test_mrc_io_quantize: %d errors\n", n_err);
+
+  MPI_Finalize();
+  return n_err ? 1 : 0;
+}
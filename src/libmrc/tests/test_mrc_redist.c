@@ -0,0 +1,310 @@
+
+// Checks how mrc_redist (as used by the xdmf_collective writer) picks its
+// writers and lays them out over the slab to be written, and that the
+// redistributed data ends up where it should. The placement over nodes and
+// the decomposition are checked for made-up layouts, so they're covered
+// even when run on a single rank (node); the actual redistribution uses as
+// many writers as there are ranks.
+
+#include <mrc_fld_as_double.h>
+#include <mrc_params.h>
+#include <mrc_domain.h>
+#include <mrc_redist.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static int n_err;
+
+#define CHECK(cond) do {						\
+    if (!(cond)) {							\
+      mprintf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      n_err++;								\
+    }									\
+  } while (0)
+
+// ----------------------------------------------------------------------
+// check_writers
+//
+// compares the writers picked for the given node layout against the
+// expected ranks
+
+static void
+check_writers(int size, const int *node_of_rank, int nr_nodes, int nr_writers,
+	      const int *expected)
+{
+  int writer_ranks[nr_writers];
+  mrc_redist_place_writers(size, node_of_rank, nr_nodes, nr_writers, writer_ranks);
+  for (int w = 0; w < nr_writers; w++) {
+    if (writer_ranks[w] != expected[w]) {
+      mprintf("%d nodes, %d writers: writer %d is rank %d, expected %d\n",
+	      nr_nodes, nr_writers, w, writer_ranks[w], expected[w]);
+      n_err++;
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// test_place_writers
+
+static void
+test_place_writers()
+{
+  // 3 nodes with 4 ranks each: round robin over the nodes, then evenly
+  // spread within each node
+  int nodes_3x4[12] = { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 };
+  check_writers(12, nodes_3x4, 3, 1, (int []) { 0 });
+  check_writers(12, nodes_3x4, 3, 3, (int []) { 0, 4, 8 });
+  check_writers(12, nodes_3x4, 3, 5, (int []) { 0, 2, 4, 6, 8 });
+  check_writers(12, nodes_3x4, 3, 6, (int []) { 0, 2, 4, 6, 8, 10 });
+  check_writers(12, nodes_3x4, 3, 12, (int []) { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 });
+
+  // ranks placed round robin onto 2 nodes
+  int nodes_rr[8] = { 0, 1, 0, 1, 0, 1, 0, 1 };
+  check_writers(8, nodes_rr, 2, 2, (int []) { 0, 1 });
+  check_writers(8, nodes_rr, 2, 4, (int []) { 0, 1, 4, 5 });
+
+  // a node that's full, the remaining writers go to the other one
+  int nodes_uneven[6] = { 0, 1, 1, 1, 1, 1 };
+  check_writers(6, nodes_uneven, 2, 4, (int []) { 0, 1, 2, 4 });
+}
+
+// ----------------------------------------------------------------------
+// test_select_writers
+//
+// on the nodes we're actually running on
+
+static void
+test_select_writers(MPI_Comm comm)
+{
+  int size;
+  MPI_Comm_size(comm, &size);
+  int nr_nodes = mrc_redist_nr_nodes(comm);
+  CHECK(nr_nodes >= 1 && nr_nodes <= size);
+
+  for (int nr_writers = 1; nr_writers <= size; nr_writers++) {
+    int writer_ranks[nr_writers];
+    mrc_redist_select_writers(comm, nr_writers, writer_ranks);
+    CHECK(writer_ranks[0] == 0);
+    for (int w = 1; w < nr_writers; w++) {
+      CHECK(writer_ranks[w] > writer_ranks[w-1]);
+    }
+    // all ranks need to agree
+    int writer_ranks_0[nr_writers];
+    memcpy(writer_ranks_0, writer_ranks, sizeof(writer_ranks));
+    MPI_Bcast(writer_ranks_0, nr_writers, MPI_INT, 0, comm);
+    CHECK(memcmp(writer_ranks, writer_ranks_0, sizeof(writer_ranks)) == 0);
+    if (nr_nodes == 1) {
+      for (int w = 0; w < nr_writers; w++) {
+	CHECK(writer_ranks[w] == w * size / nr_writers);
+      }
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// test_auto_nr_writers
+
+static void
+test_auto_nr_writers()
+{
+  const double mb = 1024. * 1024.;
+  CHECK(mrc_redist_auto_nr_writers(0., 256, 8) == 1);
+  CHECK(mrc_redist_auto_nr_writers(1., 256, 8) == 1);
+  CHECK(mrc_redist_auto_nr_writers(256. * mb, 256, 8) == 1);
+  CHECK(mrc_redist_auto_nr_writers(256. * mb + 1., 256, 8) == 2);
+  CHECK(mrc_redist_auto_nr_writers(1000. * mb, 256, 8) == 4);
+  CHECK(mrc_redist_auto_nr_writers(1000. * mb, 256, 3) == 3);
+  CHECK(mrc_redist_auto_nr_writers(1e6 * mb, 256, 8) == 8);
+}
+
+// ----------------------------------------------------------------------
+// check_decompose
+//
+// checks the writers' layout over the slab against writer_np_expected, and
+// that their blocks cover each cell of the slab exactly once
+
+static void
+check_decompose(int nr_writers, int gdims[3], int slab_offs[3], int slab_dims[3],
+		int writer_np_expected[3])
+{
+  struct mrc_redist redist = {};
+  redist.nr_writers = nr_writers;
+  for (int d = 0; d < 3; d++) {
+    redist.slab_offs[d] = slab_offs[d];
+    redist.slab_dims[d] = slab_dims[d];
+  }
+  mrc_redist_decompose(nr_writers, gdims, slab_dims, redist.writer_np);
+  for (int d = 0; d < 3; d++) {
+    if (redist.writer_np[d] != writer_np_expected[d]) {
+      mprintf("%d writers on %dx%dx%d: writer_np[%d] = %d, expected %d\n",
+	      nr_writers, slab_dims[0], slab_dims[1], slab_dims[2], d,
+	      redist.writer_np[d], writer_np_expected[d]);
+      n_err++;
+    }
+  }
+
+  int n_cells = slab_dims[0] * slab_dims[1] * slab_dims[2];
+  int *cnt = calloc(n_cells, sizeof(*cnt));
+  for (int w = 0; w < nr_writers; w++) {
+    int off[3], dims[3];
+    mrc_redist_writer_offs_dims(&redist, w, off, dims);
+    for (int k = off[2]; k < off[2] + dims[2]; k++) {
+      for (int j = off[1]; j < off[1] + dims[1]; j++) {
+	for (int i = off[0]; i < off[0] + dims[0]; i++) {
+	  int ii = i - slab_offs[0], jj = j - slab_offs[1], kk = k - slab_offs[2];
+	  assert(ii >= 0 && ii < slab_dims[0] && jj >= 0 && jj < slab_dims[1] &&
+		 kk >= 0 && kk < slab_dims[2]);
+	  cnt[(kk * slab_dims[1] + jj) * slab_dims[0] + ii]++;
+	}
+      }
+    }
+  }
+  for (int n = 0; n < n_cells; n++) {
+    CHECK(cnt[n] == 1);
+  }
+  free(cnt);
+}
+
+// ----------------------------------------------------------------------
+// test_decompose
+
+static void
+test_decompose()
+{
+  // enough cells in z: 1-d slabs, as before
+  check_decompose(4, (int []) { 16, 16, 16 }, (int []) { 0, 0, 0 },
+		  (int []) { 16, 16, 16 }, (int []) { 1, 1, 4 });
+  check_decompose(5, (int []) { 16, 16, 16 }, (int []) { 0, 0, 0 },
+		  (int []) { 16, 16, 16 }, (int []) { 1, 1, 5 });
+  // 2-d (x invariant), z (the slowest) too short for the writers, so y
+  // gets split, too, as close to square blocks as possible
+  check_decompose(8, (int []) { 1, 32, 4 }, (int []) { 0, 0, 0 },
+		  (int []) { 1, 32, 4 }, (int []) { 1, 8, 1 });
+  check_decompose(8, (int []) { 1, 16, 6 }, (int []) { 0, 0, 0 },
+		  (int []) { 1, 16, 6 }, (int []) { 1, 4, 2 });
+  check_decompose(6, (int []) { 1, 9, 4 }, (int []) { 0, 0, 0 },
+		  (int []) { 1, 9, 4 }, (int []) { 1, 3, 2 });
+  // z invariant, so it's y that's the slowest
+  check_decompose(4, (int []) { 16, 2, 1 }, (int []) { 0, 0, 0 },
+		  (int []) { 16, 2, 1 }, (int []) { 4, 1, 1 });
+  // only part of the domain
+  check_decompose(4, (int []) { 1, 32, 8 }, (int []) { 0, 4, 5 },
+		  (int []) { 1, 16, 2 }, (int []) { 1, 4, 1 });
+  // no factorization fits, some writers stay empty
+  check_decompose(7, (int []) { 1, 3, 2 }, (int []) { 0, 0, 0 },
+		  (int []) { 1, 3, 2 }, (int []) { 1, 1, 7 });
+}
+
+// ----------------------------------------------------------------------
+// val
+
+static double
+val(int m, int i, int j, int k)
+{
+  return m + 10. * i + 100. * j + 1000. * k;
+}
+
+// ----------------------------------------------------------------------
+// check_redist
+//
+// redistributes a field onto one writer per rank and checks what the
+// writers got
+
+static void
+check_redist(struct mrc_domain *domain, int slab_offs[3], int slab_dims[3])
+{
+  int size;
+  MPI_Comm_size(mrc_domain_comm(domain), &size);
+
+  struct mrc_fld *fld = mrc_domain_m3_create(domain);
+  mrc_fld_set_type(fld, FLD_TYPE);
+  mrc_fld_set_param_int(fld, "nr_comps", 2);
+  mrc_fld_setup(fld);
+  mrc_fld_foreach_patch(fld, p) {
+    struct mrc_patch_info info;
+    mrc_domain_get_local_patch_info(domain, p, &info);
+    mrc_fld_foreach(fld, i,j,k, 0, 0) {
+      for (int m = 0; m < 2; m++) {
+	M3(fld, m, i,j,k, p) = val(m, info.off[0] + i, info.off[1] + j, info.off[2] + k);
+      }
+    } mrc_fld_foreach_end;
+  }
+
+  struct mrc_redist redist[1];
+  mrc_redist_init(redist, domain, slab_offs, slab_dims, size, NULL);
+  struct mrc_ndarray *nd = mrc_redist_get_ndarray(redist, fld);
+  int n_cells = 0;
+  for (int m = 0; m < 2; m++) {
+    mrc_redist_run(redist, nd, fld, m);
+    if (!redist->is_writer) {
+      continue;
+    }
+    int writer;
+    MPI_Comm_rank(redist->comm_writers, &writer);
+    int off[3], dims[3];
+    mrc_redist_writer_offs_dims(redist, writer, off, dims);
+    for (int k = off[2]; k < off[2] + dims[2]; k++) {
+      for (int j = off[1]; j < off[1] + dims[1]; j++) {
+	for (int i = off[0]; i < off[0] + dims[0]; i++) {
+	  if (MRC_D3(nd, i,j,k) != val(m, i,j,k)) {
+	    if (n_err++ < 10) {
+	      mprintf("writer %d m %d [%d,%d,%d]: %g expected %g\n", writer, m,
+		      i, j, k, MRC_D3(nd, i,j,k), val(m, i,j,k));
+	    }
+	  }
+	  n_cells++;
+	}
+      }
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &n_cells, 1, MPI_INT, MPI_SUM, mrc_domain_comm(domain));
+  CHECK(n_cells == 2 * redist->slab_dims[0] * redist->slab_dims[1] * redist->slab_dims[2]);
+
+  mrc_redist_put_ndarray(redist, nd);
+  mrc_redist_destroy(redist);
+  mrc_fld_destroy(fld);
+}
+
+// ----------------------------------------------------------------------
+// test_redist
+//
+// a 2-d (x invariant) domain short in z, so that with more than 6 ranks,
+// the writers get 2-d blocks
+
+static void
+test_redist(MPI_Comm comm)
+{
+  struct mrc_domain *domain = mrc_domain_create(comm);
+  mrc_domain_set_type(domain, "multi");
+  mrc_domain_set_param_int3(domain, "m", (int [3]) { 1, 16, 6 });
+  mrc_domain_set_param_int3(domain, "np", (int [3]) { 1, 4, 2 });
+  mrc_domain_set_from_options(domain);
+  mrc_domain_setup(domain);
+
+  check_redist(domain, (int []) { 0, 0, 0 }, (int []) { 0, 0, 0 });
+  check_redist(domain, (int []) { 0, 3, 1 }, (int []) { 1, 10, 2 });
+
+  mrc_domain_destroy(domain);
+}
+
+int
+main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+  libmrc_params_init(argc, argv);
+
+  test_place_writers();
+  test_select_writers(MPI_COMM_WORLD);
+  test_auto_nr_writers();
+  test_decompose();
+  test_redist(MPI_COMM_WORLD);
+
+  MPI_Allreduce(MPI_IN_PLACE, &n_err, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  mpi_printf(MPI_COMM_WORLD, "test_mrc_redist: %d errors\n", n_err);
+
+  MPI_Finalize();
+  return n_err ? 1 : 0;
+}
@@ -3,6 +3,8 @@
 #include "psc_fields_as_c.h"
 #include "fields.hxx"
 #include "setup_fields.hxx"
+#include "AsyncWriter.h"
+#include "PatchAffinity.h"
 
 #include <mrc_common.h>
 #include <mrc_params.h>
@@ -75,18 +77,26 @@ _psc_read(struct psc *psc, struct mrc_io *io)
 #endif
 
 // FIXME
-void vpic_base_init(int *pargc, char ***pargv);
+void vpic_base_init(int *pargc, char ***pargv, bool thread_multiple);
 
-void psc_init(int& argc, char**& argv)
+void psc_init(int& argc, char**& argv, bool write_async)
 {
 #if 1
-  vpic_base_init(&argc, &argv);
+  vpic_base_init(&argc, &argv, write_async);
 #else
   MPI_Init(&argc, &argv);
 #endif
   libmrc_params_init(argc, argv);
   mrc_set_flags(MRC_FLAG_SUPPRESS_UNPREFIXED_OPTION_WARNING);
 
+  // keep OpenMP threads from migrating away from the patch data they own
+  bool pin_threads = false;
+  mrc_params_get_option_bool_help("pin_threads", &pin_threads,
+				  "bind each OpenMP thread to one cpu");
+  if (pin_threads) {
+    psc::numa::pinThreads();
+  }
+
   // FIXME, we should use RngPool consistently throughout
   int rank;
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -95,6 +105,7 @@ void psc_init(int& argc, char**& argv)
 
 void psc_finalize()
 {
+  asyncWriter().wait();
   libmrc_params_finalize();
   MPI_Finalize();
 }
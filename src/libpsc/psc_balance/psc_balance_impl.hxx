@@ -7,6 +7,7 @@
 #include "bnd_particles.hxx"
 #include "bnd.hxx"
 #include "mpi_dtype_traits.hxx"
+#include "MemoryPool.h"
 
 #include <mrc_profile.h>
 #include <string.h>
@@ -853,6 +854,9 @@ private:
       prof_start(pr_bal_prts);
       balance_particles(ctx, *new_grid, *mp);
       prof_stop(pr_bal_prts);
+      if (print_loads_) {
+        psc::mem::particlePool().print(old_grid->comm(), "Balance: particle");
+      }
     } else {
       n_prts_by_patch_new = ctx.new_n_prts(n_prts_by_patch_old);
     }
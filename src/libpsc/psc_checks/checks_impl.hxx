@@ -39,7 +39,6 @@ struct Checks_ : ChecksParams, ChecksBase
       comm_{comm},
       rho_{grid, 1, grid.ibn},
       rho_m_{grid, 1, grid.ibn},
-      rho_p_{grid, 1, grid.ibn},
       divj_{grid, 1, grid.ibn}
   {}
   
@@ -69,11 +68,14 @@ struct Checks_ : ChecksParams, ChecksBase
       return;
     }
 
-    rho_p_.assign(Moment_t{mprts});
+    // rho at the new time is kept in rho_, so that gauss() can reuse it
+    rho_.assign(Moment_t{mprts});
+    rho_timestep_ = grid.timestep();
     auto item_divj = Item_divj<MfieldsState>(mflds);
 
-    auto& d_rho = rho_p_;
-    d_rho.axpy(-1., rho_m_);
+    auto& d_rho = rho_m_;
+    d_rho.axpy(-1., rho_);
+    d_rho.scale(-1.);
 
     divj_.assign(item_divj);
     divj_.scale(grid.dt);
@@ -134,7 +136,12 @@ struct Checks_ : ChecksParams, ChecksBase
       return;
     }
 
-    rho_.assign(Moment_t{mprts});
+    // particles don't change between the continuity check and here, so
+    // if it has run this step, there's no need to sweep them again
+    if (rho_timestep_ != grid.timestep()) {
+      rho_.assign(Moment_t{mprts});
+    }
+    rho_timestep_ = -1;
     auto dive = Item_dive<MfieldsState>(mflds);
     
     double eps = gauss_threshold;
@@ -198,9 +205,9 @@ struct Checks_ : ChecksParams, ChecksBase
 
   // state
   MPI_Comm comm_;
-  Mfields rho_p_;
   Mfields rho_m_;
   Mfields rho_;
   Mfields divj_;
+  int rho_timestep_ = -1; // timestep rho_ was last calculated for
 };
 
@@ -55,6 +55,8 @@ struct CollisionHost
   {
     auto& grid = mprts.grid();
 
+    // collisions only change momenta, so cached cell indices stay valid
+    bool has_cidx = mprts.hasCellIndices();
     auto accessor = mprts.accessor_();
     for (int p = 0; p < mprts.n_patches(); p++) {
       auto acc = accessor[p];
@@ -64,7 +66,11 @@ struct CollisionHost
       int *offsets = (int *) calloc(nr_cells + 1, sizeof(*offsets));
       struct psc_collision_stats stats_total = {};
     
-      find_cell_offsets(offsets, acc);
+      if (has_cidx) {
+	find_cell_offsets(offsets, acc, mprts.cellIndices(p));
+      } else {
+	find_cell_offsets(offsets, acc);
+      }
     
       auto F = mflds_stats_[p];
       grid.Foreach_3d(0, 0, [&](int ix, int iy, int iz) {
@@ -96,6 +102,9 @@ struct CollisionHost
   
       free(offsets);
     }
+    if (has_cidx) {
+      mprts.setCellIndicesValid();
+    }
   }
 
   // ----------------------------------------------------------------------
@@ -141,13 +150,26 @@ struct CollisionHost
   // find_cell_offsets
 
   static void find_cell_offsets(int offsets[], /*const*/ AccessorPatch& prts)
+  {
+    std::vector<int> cidx(prts.size());
+    for (size_t n = 0; n < cidx.size(); n++) {
+      cidx[n] = prts[n].validCellIndex();
+    }
+    find_cell_offsets(offsets, prts, cidx);
+  }
+
+  // same, using the given (cached) cell indices
+
+  static void find_cell_offsets(int offsets[], /*const*/ AccessorPatch& prts,
+				const std::vector<int>& cidx)
   {
     const int *ldims = prts.grid().ldims;
     int last = 0;
     offsets[last] = 0;
     int n_prts = prts.size();
+    assert(int(cidx.size()) == n_prts);
     for (int n = 0; n < n_prts; n++) {
-      int cell_index = prts[n].validCellIndex();
+      int cell_index = cidx[n];
       assert(cell_index >= last);
       while (last < cell_index) {
 	offsets[++last] = n;
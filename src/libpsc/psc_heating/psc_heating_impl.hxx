@@ -1,11 +1,25 @@
 
 #include "heating.hxx"
+#include "balance.hxx"
+#include "CounterRng.h"
 
+#include <algorithm>
+#include <cmath>
 #include <functional>
-#include <stdlib.h>
+#include <vector>
 
 // ======================================================================
 // Heating__
+//
+// The heating rate H is evaluated once per cell (at the cell center), and
+// cached until the domain gets rebalanced, rather than evaluating get_H for
+// every particle every time. So the profile is resolved only down to the
+// grid: every particle in a cell is heated at the cell center's rate, which
+// differs from the rate at its exact position unless H is constant over
+// the cell. Patches with no heating at all are skipped entirely. Kicks use a counter-based rng keyed by timestep, patch and
+// particle, so patches can be processed in parallel without shared rng state.
+// The key carries a stream id of its own, so the kicks don't reuse the
+// random numbers SetupParticles draws for the same timestep.
 
 template<typename MP>
 struct Heating__ : HeatingBase
@@ -13,6 +27,11 @@ struct Heating__ : HeatingBase
   using Mparticles = MP;
   using real_t = typename Mparticles::real_t;
   using Particle = typename Mparticles::Particle;
+  using Philox4x32 = psc::rng::Philox4x32;
+
+  // upper half of the rng key, to tell the heating stream apart from others
+  // (SetupParticles keys by seed / timestep)
+  static const uint32_t RNG_STREAM = 0x48454154; // "HEAT"
   
   // ----------------------------------------------------------------------
   // ctor
@@ -27,61 +46,125 @@ struct Heating__ : HeatingBase
   
   // ----------------------------------------------------------------------
   // kick_particle
+  //
+  // Dp is the momentum kick amplitude sqrt(H * heating_dt), r a block of
+  // random numbers unique to this particle
 
-  void kick_particle(Particle& prt, real_t H)
+  void kick_particle(Particle& prt, real_t Dp, const Philox4x32::Counter& r)
   {
-    float ran1, ran2, ran3, ran4, ran5, ran6;
-    do {
-      ran1 = random() / ((float) RAND_MAX + 1);
-      ran2 = random() / ((float) RAND_MAX + 1);
-      ran3 = random() / ((float) RAND_MAX + 1);
-      ran4 = random() / ((float) RAND_MAX + 1);
-      ran5 = random() / ((float) RAND_MAX + 1);
-      ran6 = random() / ((float) RAND_MAX + 1);
-    } while (ran1 >= 1.f || ran2 >= 1.f || ran3 >= 1.f ||
-	     ran4 >= 1.f || ran5 >= 1.f || ran6 >= 1.f);
-
-    real_t ranx = sqrtf(-2.f*logf(1.0-ran1)) * cosf(2.f*M_PI*ran2);
-    real_t rany = sqrtf(-2.f*logf(1.0-ran3)) * cosf(2.f*M_PI*ran4);
-    real_t ranz = sqrtf(-2.f*logf(1.0-ran5)) * cosf(2.f*M_PI*ran6);
-
-    real_t Dpxi = sqrtf(H * heating_dt_);
-    real_t Dpyi = sqrtf(H * heating_dt_);
-    real_t Dpzi = sqrtf(H * heating_dt_);
-
-    prt.u[0] += Dpxi * ranx;
-    prt.u[1] += Dpyi * rany;
-    prt.u[2] += Dpzi * ranz;
+    real_t rho1 = std::sqrt(-2. * std::log(Philox4x32::uniform(r[0])));
+    real_t phi1 = 2. * M_PI * Philox4x32::uniform(r[1]);
+    real_t rho2 = std::sqrt(-2. * std::log(Philox4x32::uniform(r[2])));
+    real_t phi2 = 2. * M_PI * Philox4x32::uniform(r[3]);
+
+    prt.u[0] += Dp * rho1 * std::cos(phi1);
+    prt.u[1] += Dp * rho1 * std::sin(phi1);
+    prt.u[2] += Dp * rho2 * std::cos(phi2);
   }
 
+  // ----------------------------------------------------------------------
+  // operator()
+
   void operator()(Mparticles& mprts)
   {
+    const auto& grid = mprts.grid();
+    if (psc_balance_generation_cnt != balance_generation_cnt_ ||
+	&grid != grid_) {
+      setup_coeffs(grid);
+    }
+
+    auto rng = Philox4x32{(uint64_t(RNG_STREAM) << 32) |
+                          uint32_t(grid.timestep())};
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
     for (int p = 0; p < mprts.n_patches(); p++) {
+      if (!patch_is_heated_[p]) {
+	continue;
+      }
+
       auto&& prts = mprts[p];
-      auto& patch = mprts.grid().patches[p];
+      auto& patch = grid.patches[p];
+      const auto& Dp_by_cell = Dp_by_patch_[p];
+      uint32_t gp = grid.localPatchInfo(p).global_patch;
+      uint32_t n = 0;
       for (auto& prt : prts) {
+	n++;
 	if (prt.kind != kind_) {
 	  continue;
 	}
-      
-	double xx[3] = {
-	  prt.x[0] + patch.xb[0],
-	  prt.x[1] + patch.xb[1],
-	  prt.x[2] + patch.xb[2],
-	};
-
-	double H = get_H_(xx);
-	if (H > 0.f) {
-	  kick_particle(prt, H);
+
+	real_t Dp;
+	int cidx = mprts.particleIndexer().cellIndex(prt.x);
+	if (cidx >= 0) {
+	  Dp = Dp_by_cell[cidx];
+	} else {
+	  // particle is just outside the patch, shouldn't really happen
+	  double xx[3] = {
+	    prt.x[0] + patch.xb[0],
+	    prt.x[1] + patch.xb[1],
+	    prt.x[2] + patch.xb[2],
+	  };
+	  Dp = std::sqrt(std::max(get_H_(xx), 0.) * heating_dt_);
+	}
+
+	if (Dp > 0.f) {
+	  kick_particle(prt, Dp, rng({n, gp, 0, 0}));
 	}
       }
     }
   }
   
 private:
+  // ----------------------------------------------------------------------
+  // setup_coeffs
+  //
+  // evaluates the heating kick amplitude for every cell, using the same
+  // positions as SetupParticles (node-centered in invariant directions)
+
+  void setup_coeffs(const Grid_t& grid)
+  {
+    balance_generation_cnt_ = psc_balance_generation_cnt;
+    grid_ = &grid;
+
+    Dp_by_patch_.resize(grid.n_patches());
+    patch_is_heated_.resize(grid.n_patches());
+    auto ldims = grid.ldims;
+    for (int p = 0; p < grid.n_patches(); p++) {
+      auto& patch = grid.patches[p];
+      auto& Dp_by_cell = Dp_by_patch_[p];
+      Dp_by_cell.resize(ldims[0] * ldims[1] * ldims[2]);
+      patch_is_heated_[p] = false;
+      for (int jz = 0; jz < ldims[2]; jz++) {
+	for (int jy = 0; jy < ldims[1]; jy++) {
+	  for (int jx = 0; jx < ldims[0]; jx++) {
+	    double xx[3] = {
+	      grid.isInvar(0) ? patch.x_nc(jx) : patch.x_cc(jx),
+	      grid.isInvar(1) ? patch.y_nc(jy) : patch.y_cc(jy),
+	      grid.isInvar(2) ? patch.z_nc(jz) : patch.z_cc(jz),
+	    };
+	    double H = get_H_(xx);
+	    real_t Dp = H > 0. ? std::sqrt(H * heating_dt_) : 0.;
+	    Dp_by_cell[(jz * ldims[1] + jy) * ldims[0] + jx] = Dp;
+	    if (Dp > 0.f) {
+	      patch_is_heated_[p] = true;
+	    }
+	  }
+	}
+      }
+    }
+  }
+
   int kind_;
   real_t heating_dt_;
   std::function<double(const double*)> get_H_;
+
+  // cached per-cell kick amplitudes
+  std::vector<std::vector<real_t>> Dp_by_patch_;
+  std::vector<char> patch_is_heated_;
+  int balance_generation_cnt_ = -1;
+  const Grid_t* grid_ = nullptr;
 };
 
 
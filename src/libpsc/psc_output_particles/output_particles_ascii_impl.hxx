@@ -1,5 +1,9 @@
 
 #include "output_particles.hxx"
+#include "particle_indexer.hxx"
+
+#include <algorithm>
+#include <vector>
 
 struct OutputParticlesAscii : OutputParticlesParams, OutputParticlesBase
 {
@@ -26,10 +30,30 @@ struct OutputParticlesAscii : OutputParticlesParams, OutputParticlesBase
 	    basename, grid.timestep(), rank);
     
     FILE *file = fopen(filename, "w");
+    auto selection = OutputParticlesSelection{*this, grid.timestep()};
     auto accessor = mprts.accessor();
+    ParticleIndexer<typename Mparticles::real_t> pi{grid};
+    int n_kinds = grid.kinds.size();
+    std::vector<int> n_by_cell(grid.ldims[0] * grid.ldims[1] * grid.ldims[2] *
+			       n_kinds);
     for (int p = 0; p < mprts.n_patches(); p++) {
+      int gp = grid.localPatchInfo(p).global_patch;
+      std::fill(n_by_cell.begin(), n_by_cell.end(), 0);
       int n = 0;
       for (auto prt : accessor[p]) {
+	// index among the particles of the same cell and kind, in the same
+	// way as OutputParticlesHdf5 counts them
+	Int3 cpos;
+	for (int d = 0; d < 3; d++) {
+	  cpos[d] = std::min(std::max(pi.cellPosition(prt.x()[d], d), 0),
+			     grid.ldims[d] - 1);
+	}
+	int n_in_cell = n_by_cell[pi.cellIndex(cpos) * n_kinds + prt.kind()]++;
+	if (!selection.selectKind(prt.kind()) ||
+	    !selection(prt, n_in_cell, gp, n)) {
+	  n++;
+	  continue;
+	}
 	fprintf(file, "%d %g %g %g %g %g %g %g %d\n",
 		n, prt.x()[0], prt.x()[1], prt.x()[2],
 		prt.u()[0], prt.u()[1], prt.u()[2],
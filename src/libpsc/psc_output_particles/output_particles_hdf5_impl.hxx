@@ -1,11 +1,15 @@
 
 #include "psc.h"
+#include <mrc_io_compress.h>
 #include <mrc_profile.h>
 
 #include <hdf5.h>
 #include <hdf5_hl.h>
 
+#include <memory>
+
 #include "output_particles.hxx"
+#include "AsyncWriter.h"
 
 #include "psc_particles_single.h"
 #include "../libpsc/vpic/mparticles_vpic.hxx"
@@ -88,6 +92,25 @@ private:
   hid_t id_;
 };
 
+// ======================================================================
+// OutputParticlesHdf5Staged
+//
+// everything that's needed to write the particle file, copied out of the
+// particle data structures, so that the write can happen while the particles
+// are being pushed on
+
+struct OutputParticlesHdf5Staged
+{
+  std::string filename;
+  std::vector<hdf5_prt> arr;
+  size_t n_off;
+  size_t n_total;
+  std::vector<size_t> gidx_begin; // only on rank 0
+  std::vector<size_t> gidx_end;
+  int stride;
+  double fraction;
+};
+
 // ======================================================================
 // OutputParticlesHdf5
 
@@ -155,9 +178,22 @@ struct OutputParticlesHdf5
       unsigned int n_prts = prts.size();
 
       // counting sort to get map
-      for (const auto &prt : prts) {
-        int si = get_sort_index(prts, prt);
-        off[p][si]++;
+      // (the sort index is computed only once per particle, using the cached
+      // cell indices if available)
+      std::vector<int> sis(n_prts);
+      if (mprts.hasCellIndices()) {
+        const auto& cidx = mprts.cellIndices(p);
+        for (unsigned int n = 0; n < n_prts; n++) {
+          sis[n] = cidx[n] * nr_kinds + prts[n].kind;
+        }
+      } else {
+        int n = 0;
+        for (const auto& prt : prts) {
+          sis[n++] = get_sort_index(prts, prt);
+        }
+      }
+      for (unsigned int n = 0; n < n_prts; n++) {
+        off[p][sis[n]]++;
       }
       // prefix sum to get offsets
       int o = 0;
@@ -171,10 +207,8 @@ struct OutputParticlesHdf5
 
       // sort a map only, not the actual particles
       map[p] = (int*)malloc(n_prts * sizeof(*map[p]));
-      int n = 0;
-      for (const auto& prt : prts) {
-        int si = get_sort_index(prts, prt);
-        map[p][off2[si]++] = n++;
+      for (unsigned int n = 0; n < n_prts; n++) {
+        map[p][off2[sis[n]]++] = n;
       }
       free(off2);
     }
@@ -198,49 +232,33 @@ struct OutputParticlesHdf5
 
   // ----------------------------------------------------------------------
   // make_local_particle_array
-
-  hdf5_prt* make_local_particle_array(Mparticles& mprts, int** off, int** map,
-                                      size_t** idx, size_t* p_n_write,
-                                      size_t* p_n_off, size_t* p_n_total)
+  //
+  // packs the particles to be written into the output buffer. Selection
+  // happens in the same pass, so unselected particles are never copied. The
+  // idx[] arrays are first filled with local offsets, and shifted to global
+  // offsets once the local total is known.
+
+  std::vector<hdf5_prt> make_local_particle_array(
+    Mparticles& mprts, int** off, int** map, size_t** idx,
+    const OutputParticlesSelection& selection, size_t* p_n_off,
+    size_t* p_n_total)
   {
     const auto& grid = mprts.grid();
     int nr_kinds = grid.kinds.size();
 
-    // count all particles to be written locally
-    size_t n_write = 0;
-    for (int p = 0; p < mprts.n_patches(); p++) {
-      auto& patch = grid.patches[p];
-      int ilo[3], ihi[3], ld[3];
-      int sz = find_patch_bounds(grid.ldims, patch.off, ilo, ihi, ld);
-      for (int jz = ilo[2]; jz < ihi[2]; jz++) {
-        for (int jy = ilo[1]; jy < ihi[1]; jy++) {
-          for (int jx = ilo[0]; jx < ihi[0]; jx++) {
-            for (int kind = 0; kind < nr_kinds; kind++) {
-              int si =
-                cell_index_3_to_1(grid.ldims, jx, jy, jz) * nr_kinds + kind;
-              n_write += off[p][si + 1] - off[p][si];
-            }
-          }
-        }
-      }
-    }
-
-    assert(sizeof(size_t) == sizeof(unsigned long));
-    size_t n_total, n_off = 0;
-    MPI_Allreduce(&n_write, &n_total, 1, MPI_LONG, MPI_SUM, comm_);
-    MPI_Exscan(&n_write, &n_off, 1, MPI_LONG, MPI_SUM, comm_);
-
-    struct hdf5_prt* arr = (struct hdf5_prt*)malloc(n_write * sizeof(*arr));
+    std::vector<hdf5_prt> arr;
+    std::vector<int> sz_by_patch(mprts.n_patches());
 
     // copy particles to be written into temp array
-    int nn = 0;
     {
       auto accessor = mprts.accessor();
       for (int p = 0; p < mprts.n_patches(); p++) {
         auto prts = accessor[p];
         const auto& patch = grid.patches[p];
+        int gp = grid.localPatchInfo(p).global_patch;
         int ilo[3], ihi[3], ld[3];
         int sz = find_patch_bounds(grid.ldims, patch.off, ilo, ihi, ld);
+        sz_by_patch[p] = sz;
         idx[p] = (size_t*)malloc(2 * sz * sizeof(*idx));
 
         for (int jz = ilo[2]; jz < ihi[2]; jz++) {
@@ -252,36 +270,60 @@ struct OutputParticlesHdf5
                 int jj =
                   ((kind * ld[2] + jz - ilo[2]) * ld[1] + jy - ilo[1]) * ld[0] +
                   jx - ilo[0];
-                idx[p][jj] = nn + n_off;
-                idx[p][jj + sz] = nn + n_off + off[p][si + 1] - off[p][si];
-                for (int n = off[p][si]; n < off[p][si + 1]; n++, nn++) {
-                  auto prt = prts[map[p][n]];
-                  arr[nn].x = prt.x()[0] + patch.xb[0];
-                  arr[nn].y = prt.x()[1] + patch.xb[1];
-                  arr[nn].z = prt.x()[2] + patch.xb[2];
-                  arr[nn].px = prt.u()[0];
-                  arr[nn].py = prt.u()[1];
-                  arr[nn].pz = prt.u()[2];
-                  arr[nn].q = prt.q();
-                  arr[nn].m = prt.m();
-                  arr[nn].w = prt.w();
-                  arr[nn].id = prt.id();
-                  arr[nn].tag = prt.tag();
+                idx[p][jj] = arr.size();
+                if (selection.selectKind(kind)) {
+                  for (int n = off[p][si]; n < off[p][si + 1]; n++) {
+                    auto prt = prts[map[p][n]];
+                    if (!selection(prt, n - off[p][si], gp, map[p][n])) {
+                      continue;
+                    }
+                    hdf5_prt h5prt;
+                    h5prt.x = prt.x()[0] + patch.xb[0];
+                    h5prt.y = prt.x()[1] + patch.xb[1];
+                    h5prt.z = prt.x()[2] + patch.xb[2];
+                    h5prt.px = prt.u()[0];
+                    h5prt.py = prt.u()[1];
+                    h5prt.pz = prt.u()[2];
+                    h5prt.q = prt.q();
+                    h5prt.m = prt.m();
+                    h5prt.w = prt.w();
+                    h5prt.id = prt.id();
+                    h5prt.tag = prt.tag();
+                    arr.push_back(h5prt);
+                  }
                 }
+                idx[p][jj + sz] = arr.size();
               }
             }
           }
         }
       }
     }
-    *p_n_write = n_write;
+
+    assert(sizeof(size_t) == sizeof(unsigned long));
+    size_t n_write = arr.size(), n_total, n_off = 0;
+    MPI_Allreduce(&n_write, &n_total, 1, MPI_LONG, MPI_SUM, comm_);
+    MPI_Exscan(&n_write, &n_off, 1, MPI_LONG, MPI_SUM, comm_);
+
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      for (int i = 0; i < 2 * sz_by_patch[p]; i++) {
+        idx[p][i] += n_off;
+      }
+    }
+
     *p_n_off = n_off;
     *p_n_total = n_total;
     return arr;
   }
 
-  void write_particles(size_t n_write, size_t n_off, size_t n_total,
-                       hdf5_prt* arr, hid_t group, hid_t dxpl)
+  // ----------------------------------------------------------------------
+  // write_particles
+  //
+  // returns the number of bytes the particles take up in the file
+
+  size_t write_particles(size_t n_write, size_t n_off, size_t n_total,
+                         const hdf5_prt* arr, hid_t group, hid_t dxpl,
+                         const OutputParticlesParams& params) const
   {
     herr_t ierr;
 
@@ -296,21 +338,37 @@ struct OutputParticlesHdf5
       H5Sselect_hyperslab(filespace, H5S_SELECT_SET, foff, NULL, mdims, NULL);
     CE;
 
+    // with compression, each rank's particles make up about one chunk
+    int size;
+    MPI_Comm_size(comm_, &size);
+    hsize_t chunk[1] = {(n_total + size - 1) / size};
+    hid_t dcpl =
+      mrc_io_compress_dcpl(params.compression, params.compression_level, 1,
+                           fdims, chunk, sizeof(hdf5_prt));
+
     hid_t dset = H5Dcreate(group, "1d", prt_type_, filespace, H5P_DEFAULT,
-                           H5P_DEFAULT, H5P_DEFAULT);
+                           dcpl, H5P_DEFAULT);
     H5_CHK(dset);
     ierr = H5Dwrite(dset, prt_type_, memspace, filespace, dxpl, arr);
     CE;
 
+    size_t stored = n_total * sizeof(hdf5_prt);
+    if (dcpl != H5P_DEFAULT) {
+      stored = H5Dget_storage_size(dset);
+      ierr = H5Pclose(dcpl);
+      CE;
+    }
     ierr = H5Dclose(dset);
     CE;
     ierr = H5Sclose(filespace);
     CE;
     ierr = H5Sclose(memspace);
     CE;
+    return stored;
   }
 
-  void write_idx(size_t* gidx_begin, size_t* gidx_end, hid_t group, hid_t dxpl)
+  void write_idx(const size_t* gidx_begin, const size_t* gidx_end,
+                 hid_t group, hid_t dxpl) const
   {
     herr_t ierr;
 
@@ -360,21 +418,20 @@ struct OutputParticlesHdf5
   }
 
   // ----------------------------------------------------------------------
-  // operator()
+  // stage
+  //
+  // gathers the particles to be written and the global index
 
-  void operator()(Mparticles& mprts, const std::string& filename,
-                  const OutputParticlesParams& params)
+  std::shared_ptr<OutputParticlesHdf5Staged> stage(
+    Mparticles& mprts, const std::string& filename,
+    const OutputParticlesParams& params)
   {
     const auto& grid = mprts.grid();
-    herr_t ierr;
 
-    static int pr_A, pr_B, pr_C, pr_D, pr_E;
+    static int pr_A, pr_B;
     if (!pr_A) {
       pr_A = prof_register("outp: local", 1., 0, 0);
       pr_B = prof_register("outp: comm", 1., 0, 0);
-      pr_C = prof_register("outp: write prep", 1., 0, 0);
-      pr_D = prof_register("outp: write idx", 1., 0, 0);
-      pr_E = prof_register("outp: write prts", 1., 0, 0);
     }
 
     prof_start(pr_A);
@@ -392,31 +449,23 @@ struct OutputParticlesHdf5
 
     size_t** idx = (size_t**)malloc(mprts.n_patches() * sizeof(*idx));
 
-    size_t *gidx_begin = NULL, *gidx_end = NULL;
+    auto staged = std::make_shared<OutputParticlesHdf5Staged>();
+    staged->filename = filename;
+    auto& gidx_begin = staged->gidx_begin;
+    auto& gidx_end = staged->gidx_end;
     if (rank == 0) {
       // alloc global idx array
-      gidx_begin = (size_t*)malloc(nr_kinds * wdims_[0] * wdims_[1] *
-                                   wdims_[2] * sizeof(*gidx_begin));
-      gidx_end = (size_t*)malloc(nr_kinds * wdims_[0] * wdims_[1] * wdims_[2] *
-                                 sizeof(*gidx_end));
-      for (int jz = 0; jz < wdims_[2]; jz++) {
-        for (int jy = 0; jy < wdims_[1]; jy++) {
-          for (int jx = 0; jx < wdims_[0]; jx++) {
-            for (int kind = 0; kind < nr_kinds; kind++) {
-              int ii =
-                ((kind * wdims_[2] + jz) * wdims_[1] + jy) * wdims_[0] + jx;
-              gidx_begin[ii] = -1;
-              gidx_end[ii] = -1;
-            }
-          }
-        }
-      }
+      size_t n_gidx = nr_kinds * wdims_[0] * wdims_[1] * wdims_[2];
+      gidx_begin.resize(n_gidx, size_t(-1));
+      gidx_end.resize(n_gidx, size_t(-1));
     }
 
     // find local particle and idx arrays
-    size_t n_write, n_off, n_total;
-    hdf5_prt* arr = make_local_particle_array(mprts, map, off, idx, &n_write,
-                                              &n_off, &n_total);
+    auto selection = OutputParticlesSelection{params, grid.timestep()};
+    staged->arr = make_local_particle_array(mprts, map, off, idx, selection,
+                                            &staged->n_off, &staged->n_total);
+    staged->stride = selection.stride();
+    staged->fraction = selection.fraction();
     prof_stop(pr_A);
 
     prof_start(pr_B);
@@ -536,7 +585,29 @@ struct OutputParticlesHdf5
     }
     prof_stop(pr_B);
 
-    prof_start(pr_C);
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      free(off[p]);
+      free(map[p]);
+      free(idx[p]);
+    }
+    free(off);
+    free(map);
+    free(idx);
+
+    return staged;
+  }
+
+  // ----------------------------------------------------------------------
+  // write
+  //
+  // writes staged particles to the file, using comm for the parallel I/O.
+  // Doesn't access the particles anymore, so it can be run in the
+  // background.
+
+  void write(const OutputParticlesHdf5Staged& staged,
+             const OutputParticlesParams& params, MPI_Comm comm) const
+  {
+    herr_t ierr;
 
     hid_t plist = H5Pcreate(H5P_FILE_ACCESS);
 
@@ -551,10 +622,10 @@ struct OutputParticlesHdf5
       MPI_Info_set(mpi_info, (char*)"romio_ds_write",
                    (char*)params.romio_ds_write);
     }
-    H5Pset_fapl_mpio(plist, comm_, mpi_info);
+    H5Pset_fapl_mpio(plist, comm, mpi_info);
 #endif
 
-    hid_t file = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist);
+    hid_t file = H5Fcreate(staged.filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist);
     H5_CHK(file);
     H5Pclose(plist);
     MPI_Info_free(&mpi_info);
@@ -570,11 +641,20 @@ struct OutputParticlesHdf5
     CE;
     ierr = H5LTset_attribute_int(group, ".", "hi", hi_, 3);
     CE;
+    // record sub-sampling, so that weights can be corrected for it
+    ierr = H5LTset_attribute_int(group, ".", "stride", &staged.stride, 1);
+    CE;
+    ierr =
+      H5LTset_attribute_double(group, ".", "fraction", &staged.fraction, 1);
+    CE;
 
+    bool compress =
+      params.compression && strcmp(params.compression, "none") != 0;
     hid_t dxpl = H5Pcreate(H5P_DATASET_XFER);
     H5_CHK(dxpl);
 #ifdef H5_HAVE_PARALLEL
-    if (params.use_independent_io) {
+    // filters need collective I/O
+    if (params.use_independent_io && !compress) {
       ierr = H5Pset_dxpl_mpio(dxpl, H5FD_MPIO_INDEPENDENT);
       CE;
     } else {
@@ -582,14 +662,20 @@ struct OutputParticlesHdf5
       CE;
     }
 #endif
-    prof_stop(pr_C);
-
-    prof_start(pr_D);
-    write_idx(gidx_begin, gidx_end, groupp, dxpl);
-    prof_stop(pr_D);
 
-    prof_start(pr_E);
-    write_particles(n_write, n_off, n_total, arr, groupp, dxpl);
+    write_idx(staged.gidx_begin.data(), staged.gidx_end.data(), groupp, dxpl);
+    double t = MPI_Wtime();
+    size_t stored =
+      write_particles(staged.arr.size(), staged.n_off, staged.n_total,
+                      staged.arr.data(), groupp, dxpl, params);
+    t = MPI_Wtime() - t;
+    if (compress) {
+      double raw = staged.n_total * sizeof(hdf5_prt);
+      mpi_printf(comm, "OutputParticlesHdf5: %s: %g MB, stored %g MB "
+                       "(ratio %g), write %g s\n",
+                 staged.filename.c_str(), raw / (1024. * 1024.),
+                 stored / (1024. * 1024.), stored > 0 ? raw / stored : 0., t);
+    }
 
     ierr = H5Pclose(dxpl);
     CE;
@@ -597,20 +683,6 @@ struct OutputParticlesHdf5
     H5Gclose(groupp);
     H5Gclose(group);
     H5Fclose(file);
-    prof_stop(pr_E);
-
-    free(arr);
-    free(gidx_begin);
-    free(gidx_end);
-
-    for (int p = 0; p < mprts.n_patches(); p++) {
-      free(off[p]);
-      free(map[p]);
-      free(idx[p]);
-    }
-    free(off);
-    free(map);
-    free(idx);
   }
 
 private:
@@ -640,6 +712,28 @@ public:
       assert(hi_[d] <= grid.domain.gdims[d]);
     }
     wdims_ = hi_ - lo_;
+
+    write_async_ = prm_.write_async;
+    if (write_async_ && !AsyncWriter::isThreadMultiple()) {
+      mpi_printf(grid.comm(), "OutputParticlesHdf5: MPI_THREAD_MULTIPLE not "
+                              "available, writing synchronously\n");
+      write_async_ = false;
+    }
+    // the main thread keeps using HDF5 (field output, checkpoints, ...)
+    // while the write is going on
+    hbool_t threadsafe = false;
+    H5is_library_threadsafe(&threadsafe);
+    if (write_async_ && !threadsafe) {
+      mpi_printf(grid.comm(), "OutputParticlesHdf5: HDF5 isn't thread-safe, "
+                              "writing synchronously\n");
+      write_async_ = false;
+    }
+  }
+
+  ~OutputParticlesHdf5()
+  {
+    // the job in flight may still be using prt_type_
+    asyncWriter().wait();
   }
 
   template <typename Mparticles>
@@ -651,12 +745,41 @@ public:
       return;
     }
 
+    static int pr_stage, pr_write;
+    if (!pr_stage) {
+      pr_stage = prof_register("outp: stage", 1., 0, 0);
+      pr_write = prof_register("outp: write", 1., 0, 0);
+    }
+
     char filename[strlen(prm_.data_dir) + strlen(prm_.basename) + 20];
     sprintf(filename, "%s/%s.%06d_p%06d.h5", prm_.data_dir, prm_.basename,
             grid.timestep(), 0);
 
+    prof_start(pr_stage);
     detail::OutputParticlesHdf5<Mparticles> impl{grid, lo_, hi_, wdims_, prt_type_};
-    impl(mprts, filename, prm_);
+    auto staged = impl.stage(mprts, filename, prm_);
+    prof_stop(pr_stage);
+
+    // when writing asynchronously, this only covers waiting for the previous
+    // write to finish
+    prof_start(pr_write);
+    if (write_async_) {
+      // the write uses its own communicator, so that its collectives can't
+      // get mixed up with the ones the simulation is doing meanwhile
+      MPI_Comm comm;
+      MPI_Comm_dup(grid.comm(), &comm);
+      auto prm = prm_;
+      asyncWriter().submit(
+        [impl, staged, prm, comm]() mutable {
+          impl.write(*staged, prm, comm);
+          MPI_Comm_free(&comm);
+        },
+        true);
+    } else {
+      asyncWriter().submit(
+        [&]() { impl.write(*staged, prm_, grid.comm()); }, false);
+    }
+    prof_stop(pr_write);
   }
 
   // FIXME, handles MparticlesVpic by conversion for now
@@ -694,6 +817,7 @@ public:
 private:
   const OutputParticlesParams prm_;
   detail::Hdf5ParticleType prt_type_;
+  bool write_async_;
   Int3 lo_; // dimensions of the subdomain we're actually writing
   Int3 hi_;
   Int3 wdims_;
@@ -21,6 +21,9 @@ struct Current1vbSplit
     fnqzs_ = grid.domain.dx[2] * grid.norm.fnqs / grid.dt;
   }
 
+  // curr_cache.add(m, i, s, val) adds to slot s of the 2x2 stencil around
+  // cell i in the directions transverse to m (see curr_accumulator_t)
+
   void calc_j2_one_cell(fields_t curr_cache, real_t qni_wni,
 			real_t xm[3], real_t xp[3], dim_yz tag_dim)
   {
@@ -41,18 +44,18 @@ struct Current1vbSplit
     }
 
     real_t fnqx = qni_wni * fnqxs_;
-    curr_cache.add(0, i[0]  ,i[1]  ,i[2]  , fnqx * (dx[0] * (1.f - xa[1]) * (1.f - xa[2]) + h));
-    curr_cache.add(0, i[0]  ,i[1]+1,i[2]  , fnqx * (dx[0] * (      xa[1]) * (1.f - xa[2]) - h));
-    curr_cache.add(0, i[0]  ,i[1]  ,i[2]+1, fnqx * (dx[0] * (1.f - xa[1]) * (      xa[2]) - h));
-    curr_cache.add(0, i[0]  ,i[1]+1,i[2]+1, fnqx * (dx[0] * (      xa[1]) * (      xa[2]) + h));
+    curr_cache.add(0, i, 0, fnqx * (dx[0] * (1.f - xa[1]) * (1.f - xa[2]) + h));
+    curr_cache.add(0, i, 1, fnqx * (dx[0] * (      xa[1]) * (1.f - xa[2]) - h));
+    curr_cache.add(0, i, 2, fnqx * (dx[0] * (1.f - xa[1]) * (      xa[2]) - h));
+    curr_cache.add(0, i, 3, fnqx * (dx[0] * (      xa[1]) * (      xa[2]) + h));
 
     real_t fnqy = qni_wni * fnqys_;
-    curr_cache.add(1, i[0]  ,i[1]  ,i[2]  , fnqy * (dx[1] * (1.f - xa[2])));
-    curr_cache.add(1, i[0]  ,i[1]  ,i[2]+1, fnqy * (dx[1] * (      xa[2])));
+    curr_cache.add(1, i, 0, fnqy * (dx[1] * (1.f - xa[2])));
+    curr_cache.add(1, i, 2, fnqy * (dx[1] * (      xa[2])));
 
     real_t fnqz = qni_wni * fnqzs_;
-    curr_cache.add(2, i[0]  ,i[1]  ,i[2]  , fnqz * (dx[2] * (1.f - xa[1])));
-    curr_cache.add(2, i[0]  ,i[1]+1,i[2]  , fnqz * (dx[2] * (      xa[1])));
+    curr_cache.add(2, i, 0, fnqz * (dx[2] * (1.f - xa[1])));
+    curr_cache.add(2, i, 2, fnqz * (dx[2] * (      xa[1])));
   }
 
   void calc_j2_one_cell(fields_t curr_cache, real_t qni_wni,
@@ -75,18 +78,18 @@ struct Current1vbSplit
     }
 
     real_t fnqx = qni_wni * fnqxs_;
-    curr_cache.add(0, i[0]  ,i[1]  ,i[2]  , fnqx * (dx[0] * (1.f - xa[2])));
-    curr_cache.add(0, i[0]  ,i[1]  ,i[2]+1, fnqx * (dx[0] * (      xa[2])));
+    curr_cache.add(0, i, 0, fnqx * (dx[0] * (1.f - xa[2])));
+    curr_cache.add(0, i, 2, fnqx * (dx[0] * (      xa[2])));
 
     real_t fnqy = qni_wni * fnqys_;
-    curr_cache.add(1, i[0]  ,i[1]  ,i[2]  , fnqy * (dx[1] * (1.f - xa[0]) * (1.f - xa[2]) + h));
-    curr_cache.add(1, i[0]+1,i[1]  ,i[2]  , fnqy * (dx[1] * (      xa[0]) * (1.f - xa[2]) - h));
-    curr_cache.add(1, i[0]  ,i[1]  ,i[2]+1, fnqy * (dx[1] * (1.f - xa[0]) * (      xa[2]) - h));
-    curr_cache.add(1, i[0]+1,i[1]  ,i[2]+1, fnqy * (dx[1] * (      xa[0]) * (      xa[2]) + h));
+    curr_cache.add(1, i, 0, fnqy * (dx[1] * (1.f - xa[0]) * (1.f - xa[2]) + h));
+    curr_cache.add(1, i, 1, fnqy * (dx[1] * (      xa[0]) * (1.f - xa[2]) - h));
+    curr_cache.add(1, i, 2, fnqy * (dx[1] * (1.f - xa[0]) * (      xa[2]) - h));
+    curr_cache.add(1, i, 3, fnqy * (dx[1] * (      xa[0]) * (      xa[2]) + h));
 
     real_t fnqz = qni_wni * fnqzs_;
-    curr_cache.add(2, i[0]  ,i[1]  ,i[2]  , fnqz * (dx[2] * (1.f - xa[0])));
-    curr_cache.add(2, i[0]+1,i[1]  ,i[2]  , fnqz * (dx[2] * (      xa[0])));
+    curr_cache.add(2, i, 0, fnqz * (dx[2] * (1.f - xa[0])));
+    curr_cache.add(2, i, 1, fnqz * (dx[2] * (      xa[0])));
   }
 
   void calc_j2_one_cell(fields_t curr_cache, real_t qni_wni,
@@ -105,22 +108,22 @@ struct Current1vbSplit
     }
 
     real_t fnqx = qni_wni * fnqxs_;
-    curr_cache.add(0, i[0]  ,i[1]  ,i[2]  , fnqx * (dx[0] * (1.f - xa[1]) * (1.f - xa[2]) + h));
-    curr_cache.add(0, i[0]  ,i[1]+1,i[2]  , fnqx * (dx[0] * (      xa[1]) * (1.f - xa[2]) - h));
-    curr_cache.add(0, i[0]  ,i[1]  ,i[2]+1, fnqx * (dx[0] * (1.f - xa[1]) * (      xa[2]) - h));
-    curr_cache.add(0, i[0]  ,i[1]+1,i[2]+1, fnqx * (dx[0] * (      xa[1]) * (      xa[2]) + h));
+    curr_cache.add(0, i, 0, fnqx * (dx[0] * (1.f - xa[1]) * (1.f - xa[2]) + h));
+    curr_cache.add(0, i, 1, fnqx * (dx[0] * (      xa[1]) * (1.f - xa[2]) - h));
+    curr_cache.add(0, i, 2, fnqx * (dx[0] * (1.f - xa[1]) * (      xa[2]) - h));
+    curr_cache.add(0, i, 3, fnqx * (dx[0] * (      xa[1]) * (      xa[2]) + h));
 
     real_t fnqy = qni_wni * fnqys_;
-    curr_cache.add(1, i[0]  ,i[1]  ,i[2]  , fnqy * (dx[1] * (1.f - xa[0]) * (1.f - xa[2]) + h));
-    curr_cache.add(1, i[0]+1,i[1]  ,i[2]  , fnqy * (dx[1] * (      xa[0]) * (1.f - xa[2]) - h));
-    curr_cache.add(1, i[0]  ,i[1]  ,i[2]+1, fnqy * (dx[1] * (1.f - xa[0]) * (      xa[2]) - h));
-    curr_cache.add(1, i[0]+1,i[1]  ,i[2]+1, fnqy * (dx[1] * (      xa[0]) * (      xa[2]) + h));
+    curr_cache.add(1, i, 0, fnqy * (dx[1] * (1.f - xa[0]) * (1.f - xa[2]) + h));
+    curr_cache.add(1, i, 1, fnqy * (dx[1] * (      xa[0]) * (1.f - xa[2]) - h));
+    curr_cache.add(1, i, 2, fnqy * (dx[1] * (1.f - xa[0]) * (      xa[2]) - h));
+    curr_cache.add(1, i, 3, fnqy * (dx[1] * (      xa[0]) * (      xa[2]) + h));
 
     real_t fnqz = qni_wni * fnqzs_;
-    curr_cache.add(2, i[0]  ,i[1]  ,i[2]  , fnqz * (dx[2] * (1.f - xa[0]) * (1.f - xa[1]) + h));
-    curr_cache.add(2, i[0]+1,i[1]  ,i[2]  , fnqz * (dx[2] * (      xa[0]) * (1.f - xa[1]) - h));
-    curr_cache.add(2, i[0]  ,i[1]+1,i[2]  , fnqz * (dx[2] * (1.f - xa[0]) * (      xa[1]) - h));
-    curr_cache.add(2, i[0]+1,i[1]+1,i[2]  , fnqz * (dx[2] * (      xa[0]) * (      xa[1]) + h));
+    curr_cache.add(2, i, 0, fnqz * (dx[2] * (1.f - xa[0]) * (1.f - xa[1]) + h));
+    curr_cache.add(2, i, 1, fnqz * (dx[2] * (      xa[0]) * (1.f - xa[1]) - h));
+    curr_cache.add(2, i, 2, fnqz * (dx[2] * (1.f - xa[0]) * (      xa[1]) - h));
+    curr_cache.add(2, i, 3, fnqz * (dx[2] * (      xa[0]) * (      xa[1]) + h));
   }
 
   void calc_j2_one_cell(fields_t curr_cache, real_t qni_wni,
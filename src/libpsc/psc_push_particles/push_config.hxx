@@ -12,6 +12,8 @@
 #include "push_particles_esirkepov.hxx"
 #include "push_particles_1vb.hxx"
 
+#include <vector>
+
 #define atomicAdd(addr, val) \
   do { *(addr) += (val); } while (0)
 
@@ -30,6 +32,103 @@ struct curr_cache_t : fields_t
     real_t *addr = &J(JXI+m, i,j,k);
     atomicAdd(addr, val);
   }
+
+  // add to slot s of the 2x2 stencil of component m around cell i (see
+  // curr_accumulator_t)
+  void add(int m, const int* i, int s, real_t val)
+  {
+    int d1 = m == 0 ? 1 : 0, d2 = m == 2 ? 1 : 2;
+    int j[3] = { i[0], i[1], i[2] };
+    j[d1] += s & 1;
+    j[d2] += s >> 1;
+    add(m, j[0], j[1], j[2], val);
+  }
+
+  // nothing to do, the current has been added to J directly
+  void reduce() {}
+};
+
+// ======================================================================
+// curr_accumulator_t
+//
+// Like curr_cache_t, but rather than adding to J directly, the current is
+// collected in a dense per-cell block of 4 values for each component.
+// Component m's values are the contributions to the 2x2 stencil spanned by
+// the two directions transverse to m (slot bit 0 => +1 in the first, bit 1
+// => +1 in the second one), so all of a particle's current in a given cell
+// ends up in 12 consecutive values, rather than in 3 components of J that
+// are far apart. Particles that are sorted by cell hence keep updating the
+// same block. reduce() then adds it all up into J, analogous to
+// PscAccumulatorOps::unload() for vpic.
+
+template<typename fields_t, typename dim_curr>
+struct curr_accumulator_t
+{
+  using real_t = typename fields_t::real_t;
+
+  static const int N_SLOTS = 12;
+
+  curr_accumulator_t(fields_t& f)
+    : flds_(f), ib_(f.ib()), im_(f.im()), a_(buffer())
+  {
+    a_.assign(N_SLOTS * im_[0] * im_[1] * im_[2], real_t(0));
+  }
+
+  void add(int m, const int* i, int s, real_t val)
+  {
+    a_[index(i[0], i[1], i[2]) * N_SLOTS + 4 * m + s] += val;
+  }
+
+  void reduce()
+  {
+    Fields3d<fields_t, dim_curr> J(flds_);
+    int di = dim_curr::InvarX::value ? 0 : 1;
+    int dj = dim_curr::InvarY::value ? 0 : 1;
+    int dk = dim_curr::InvarZ::value ? 0 : 1;
+    for (int k = ib_[2]; k < ib_[2] + im_[2]; k++) {
+      for (int j = ib_[1]; j < ib_[1] + im_[1]; j++) {
+	for (int i = ib_[0]; i < ib_[0] + im_[0]; i++) {
+	  J(JXI, i,j,k) += (A(0, 0, i, j   , k   ) + A(0, 1, i   , j-dj, k   ) +
+			    A(0, 2, i, j   , k-dk) + A(0, 3, i   , j-dj, k-dk));
+	  J(JYI, i,j,k) += (A(1, 0, i, j   , k   ) + A(1, 1, i-di, j   , k   ) +
+			    A(1, 2, i, j   , k-dk) + A(1, 3, i-di, j   , k-dk));
+	  J(JZI, i,j,k) += (A(2, 0, i, j   , k   ) + A(2, 1, i-di, j   , k   ) +
+			    A(2, 2, i, j-dj, k   ) + A(2, 3, i-di, j-dj, k   ));
+	}
+      }
+    }
+  }
+
+private:
+  int index(int i, int j, int k) const
+  {
+    if (dim_curr::InvarX::value) { i = 0; }
+    if (dim_curr::InvarY::value) { j = 0; }
+    if (dim_curr::InvarZ::value) { k = 0; }
+    return ((k - ib_[2]) * im_[1] + (j - ib_[1])) * im_[0] + (i - ib_[0]);
+  }
+
+  // slot s of component m in cell (i,j,k), or zero if that cell is outside
+  // the box (nothing can have been deposited there)
+  real_t A(int m, int s, int i, int j, int k) const
+  {
+    if (i < ib_[0] || j < ib_[1] || k < ib_[2]) {
+      return real_t(0);
+    }
+    return a_[index(i, j, k) * N_SLOTS + 4 * m + s];
+  }
+
+  // reused from patch to patch and step to step, so we don't have to
+  // allocate every time
+  static std::vector<real_t>& buffer()
+  {
+    static thread_local std::vector<real_t> buf;
+    return buf;
+  }
+
+  fields_t& flds_;
+  Int3 ib_, im_;
+  std::vector<real_t>& a_;
 };
 
 template<typename _Mparticles, typename _MfieldsState,
@@ -49,14 +148,15 @@ template<typename _Mparticles, typename _MfieldsState,
 	 typename _InterpolateEM,
 	 typename _Dim, typename _Order,
 	 template<typename, typename, typename> class _Current,
-	 typename dim_curr = dim_xyz>
+	 typename dim_curr = dim_xyz,
+	 template<typename, typename> class _CurrStore = curr_cache_t>
 struct PushpConfigVb
 {
   using Mparticles = _Mparticles;
   using MfieldsState = _MfieldsState;
   using Dim = _Dim;
   using InterpolateEM_t = _InterpolateEM;
-  using Current_t = _Current<_Order, _Dim, curr_cache_t<typename _MfieldsState::fields_view_t, dim_curr>>;
+  using Current_t = _Current<_Order, _Dim, _CurrStore<typename _MfieldsState::fields_view_t, dim_curr>>;
   using AdvanceParticle_t = AdvanceParticle<typename Mparticles::real_t, Dim>;
 };
 
@@ -90,6 +190,14 @@ using Config1vbecSplit = PushpConfigVb<Mparticles, MfieldsState,
 				       dim, opt_order_1st,
 				       Current1vbSplit>;
 
+// same as above, but collects the current in a per-cell accumulator first
+template<typename Mparticles, typename MfieldsState, typename dim>
+using Config1vbecSplitAccumulate = PushpConfigVb<Mparticles, MfieldsState,
+						 InterpolateEM1vbec<Fields3d<typename MfieldsState::fields_view_t>, dim>,
+						 dim, opt_order_1st,
+						 Current1vbSplit, dim_xyz,
+						 curr_accumulator_t>;
+
 template<typename dim>
 using Config1vbecDouble = Config1vbec<MparticlesDouble, MfieldsStateDouble, dim>;
 
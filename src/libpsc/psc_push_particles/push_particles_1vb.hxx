@@ -18,23 +18,61 @@ struct PushParticlesVb
 
   using checks_order = checks_order_1st;
 
+  // ----------------------------------------------------------------------
+  // set_subcycle
+  //
+  // Subcycling: the momentum of particles of kind k is only advanced every
+  // subcycle[k] steps (those where grid.timestep() is a multiple of it), by
+  // subcycle[k] * dt. Positions are still advanced, and current deposited,
+  // every step with the held momentum, so charge is conserved every step
+  // and no per-kind current has to be kept around. Only the field
+  // interpolation and Boris push are saved.
+  //
+  // The held momentum is centered in the interval it's used for, so this is
+  // leapfrog with the long step. As usual, the initial momenta lag the
+  // positions by dt/2 (p^0 vs x^{1/2}), so the first kick (at timestep 0) is
+  // by (subcycle[k] + 1) / 2 * dt, and subcycling needs to be set up before
+  // the first step. Mid-cycle, diagnostics see momenta off by up to
+  // subcycle[k] / 2 * dt.
+  //
+  // subcycle[k] * dt needs to resolve the kind's gyration / plasma period.
+  // Kinds beyond the end of subcycle aren't subcycled.
+
+  void set_subcycle(const std::vector<int>& subcycle)
+  {
+    for (auto n : subcycle) {
+      assert(n >= 1);
+    }
+    subcycle_ = subcycle;
+  }
+
+  int subcycle(int kind) const
+  {
+    return kind < int(subcycle_.size()) ? subcycle_[kind] : 1;
+  }
+
   // ----------------------------------------------------------------------
   // push_mprts
 
-  static void push_mprts(Mparticles& mprts, MfieldsState& mflds)
+  void push_mprts(Mparticles& mprts, MfieldsState& mflds)
   {
     const auto& grid = mprts.grid();
     PI<real_t> pi(grid);
     Real3 dxi = Real3{ 1., 1., 1. } / Real3(grid.domain.dx);
     real_t dq_kind[MAX_NR_KINDS];
+    bool push_p_kind[MAX_NR_KINDS];
     auto& kinds = grid.kinds;
     assert(kinds.size() <= MAX_NR_KINDS);
-    for (int k = 0; k < kinds.size(); k++) {
-      dq_kind[k] = .5f * grid.norm.eta * grid.dt * kinds[k].q / kinds[k].m;
+    for (int k = 0; k < int(kinds.size()); k++) {
+      int n_sub = subcycle(k);
+      real_t fac = grid.timestep() == 0 ? .5f * (n_sub + 1) : n_sub;
+      dq_kind[k] = .5f * grid.norm.eta * grid.dt * fac * kinds[k].q / kinds[k].m;
+      push_p_kind[k] = grid.timestep() % n_sub == 0;
     }
     InterpolateEM_t ip;
     AdvanceParticle_t advance(grid.dt);
     Current current(grid);
+    const auto& prt_idx = mprts.particleIndexer();
 
     auto accessor = mprts.accessor_();
     for (int p = 0; p < mflds.n_patches(); p++) {
@@ -42,6 +80,11 @@ struct PushParticlesVb
       auto prts = accessor[p];
       typename InterpolateEM_t::fields_t EM(flds);
       typename Current::fields_t J(flds);
+      // the new cell is found anyway for the current deposition, so keep it
+      // for the bnd exchange / sort to use
+      auto& cidx = mprts.cellIndices(p);
+      cidx.resize(prts.size());
+      int n = 0;
     
       flds.zero(JXI, JXI + 3);
 
@@ -54,13 +97,15 @@ struct PushParticlesVb
 	}
 	ip.set_coeffs(xm);
       
-	// FIELD INTERPOLATION
-	Real3 E = { ip.ex(EM), ip.ey(EM), ip.ez(EM) };
-	Real3 H = { ip.hx(EM), ip.hy(EM), ip.hz(EM) };
+	if (push_p_kind[prt.kind()]) {
+	  // FIELD INTERPOLATION
+	  Real3 E = { ip.ex(EM), ip.ey(EM), ip.ez(EM) };
+	  Real3 H = { ip.hx(EM), ip.hy(EM), ip.hz(EM) };
 
-	// x^(n+0.5), p^n -> x^(n+0.5), p^(n+1.0)
-	real_t dq = dq_kind[prt.kind()];
-	advance.push_p(prt.u(), E, H, dq);
+	  // x^(n+0.5), p^n -> x^(n+0.5), p^(n+1.0)
+	  real_t dq = dq_kind[prt.kind()];
+	  advance.push_p(prt.u(), E, H, dq);
+	}
 
 	// x^(n+0.5), p^(n+1.0) -> x^(n+1.5), p^(n+1.0)
 	auto v = advance.calc_v(prt.u());
@@ -69,6 +114,7 @@ struct PushParticlesVb
 	int lf[3];
 	real_t of[3], xp[3];
 	pi.find_idx_off_pos_1st_rel(x, lf, of, xp, real_t(0.));
+	cidx[n++] = prt_idx.cellIndex({lf[0], lf[1], lf[2]});
 
 	// CURRENT DENSITY BETWEEN (n+.5)*dt and (n+1.5)*dt
 	int lg[3];
@@ -77,7 +123,9 @@ struct PushParticlesVb
 	if (!Dim::InvarZ::value) { lg[2] = ip.cz.g.l; }
 	current.calc_j(J, xm, xp, lf, lg, prt.qni_wni(), v);
       }
+      J.reduce();
     }
+    mprts.setCellIndicesValid();
   }
 
   // ----------------------------------------------------------------------
@@ -125,5 +173,8 @@ struct PushParticlesVb
       }
     }
   }
+
+private:
+  std::vector<int> subcycle_;
 };
 
@@ -0,0 +1,531 @@
+
+#pragma once
+
+#include "resample.hxx"
+#include "CounterRng.h"
+#include "particle_indexer.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+// ======================================================================
+// Resample_
+//
+// Keeps the number of particles of each kind in each cell between min_ppc
+// and max_ppc (either can be 0 to disable that side), so that injection or
+// plasma compression doesn't let some cells grow without bounds while
+// others run out of particles. This also keeps the particle load that
+// Balance_ works from bounded.
+//
+// Needs the particles sorted by cell (as after SortCountsort2), and leaves
+// them sorted, with the cell index cache valid. Patches are resampled in
+// parallel, each in place in its own buffer.
+//
+// Merging: the particles of a kind in an over-populated cell are ordered
+// by energy and divided into max_ppc / 2 groups of neighbors, each of which
+// is replaced by two particles at the group's center of charge, with half
+// the group's total weight each, and momenta chosen such that total
+// momentum and energy are conserved (the two momenta lie symmetric to the
+// group's mean momentum, in a randomly oriented plane).
+//
+// Splitting: in an under-populated cell, the heaviest particle is
+// repeatedly split into two of half the weight and the same momentum,
+// displaced symmetrically (so the center of charge stays put) within the
+// cell.
+//
+// Particles created by either get new ids (if the particle type has them).
+// The random numbers come from a counter-based generator keyed by time step,
+// global patch, cell and kind, so they differ between ranks and patches but
+// are reproducible regardless of the decomposition into threads.
+//
+// Either way, the charge density seen by the grid changes slightly (though
+// not the cell's total charge), so resampling should be followed by some
+// divergence cleaning (Marder correction) in runs where that matters.
+
+template <typename MP>
+struct Resample_
+{
+  using Mparticles = MP;
+  using Particle = typename Mparticles::Particle;
+  using real_t = typename Mparticles::real_t;
+  using Real3 = typename Mparticles::Real3;
+  using Philox4x32 = psc::rng::Philox4x32;
+
+  // upper half of the rng key, to tell the resampling stream apart from others
+  static const uint32_t RNG_STREAM = 0x52534d50; // "RSMP"
+
+  Resample_(int min_ppc, int max_ppc) : min_ppc_{min_ppc}, max_ppc_{max_ppc}
+  {
+    assert(max_ppc_ == 0 || max_ppc_ >= 2);
+    assert(max_ppc_ == 0 || min_ppc_ <= max_ppc_);
+  }
+
+  // ----------------------------------------------------------------------
+  // operator()
+
+  void operator()(Mparticles& mprts)
+  {
+    const auto& grid = mprts.grid();
+    int n_patches = mprts.n_patches();
+    auto rng = Philox4x32{(uint64_t(RNG_STREAM) << 32) |
+                          uint32_t(grid.timestep())};
+
+    // particles created by merging / splitting, by patch
+    std::vector<std::vector<int>> created(n_patches);
+    int n_merged = 0, n_split = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) reduction(+ : n_merged, n_split)
+#endif
+    for (int p = 0; p < n_patches; p++) {
+      PatchResampler resampler{*this, mprts, p, rng};
+      resampler();
+      created[p] = std::move(resampler.created);
+      n_merged += resampler.n_merged;
+      n_split += resampler.n_split;
+    }
+    n_merged_ = n_merged;
+    n_split_ = n_split;
+
+    // the new particles get new ids (the id generator isn't thread-safe)
+    for (int p = 0; p < n_patches; p++) {
+      auto&& prts = mprts[p];
+      for (int n : created[p]) {
+        setId(prts[n], mprts, 0);
+      }
+    }
+    mprts.setCellIndicesValid();
+  }
+
+  int nMerged() const { return n_merged_; }
+  int nSplit() const { return n_split_; }
+
+private:
+  // ======================================================================
+  // CellRng
+  //
+  // uniform random numbers for one kind in one cell, addressed by global
+  // patch, cell and kind, so they don't depend on the rank, thread or order
+  // the cells are processed in
+
+  struct CellRng
+  {
+    CellRng(const Philox4x32& rng, uint32_t gp, uint32_t c, uint32_t kind)
+      : rng_{rng}, ctr_{gp, c, kind, 0}
+    {}
+
+    double uniform()
+    {
+      if (i_ == 4) {
+        r_ = rng_(ctr_);
+        ctr_[3]++;
+        i_ = 0;
+      }
+      return Philox4x32::uniform(r_[i_++]);
+    }
+
+  private:
+    const Philox4x32& rng_;
+    Philox4x32::Counter ctr_;
+    Philox4x32::Counter r_;
+    int i_ = 4;
+  };
+
+  // ======================================================================
+  // PatchResampler
+  //
+  // resamples one patch in place: every cell's particles get replaced by
+  // their resampled version, which may be more or fewer. The new position of
+  // each cell's particles is known up front, so cells are processed in an
+  // order that never overwrites particles that haven't been read yet: front
+  // to back while the particles are moving down, and runs of cells that
+  // move up back to front, after the cell right after the run (whose
+  // particles the run will overwrite).
+
+  struct PatchResampler
+  {
+    struct Cell
+    {
+      int c;      // cell index
+      int ob, oe; // old range of particles
+      int nb, ne; // new range
+    };
+
+    PatchResampler(Resample_& resample, Mparticles& mprts, int p,
+                   const Philox4x32& rng)
+      : resample_{resample},
+        mprts_{mprts},
+        gp_(mprts.grid().localPatchInfo(p).global_patch),
+        rng_{rng},
+        buf_{mprts.bndBuffers()[p]},
+        cidx_{mprts.cellIndices(p)},
+        by_kind_(mprts.grid().kinds.size())
+    {}
+
+    void operator()()
+    {
+      int n_prts = buf_.size();
+      if (!mprts_.hasCellIndices()) {
+        const auto& pi = mprts_.particleIndexer();
+        cidx_.resize(n_prts);
+        for (int n = 0; n < n_prts; n++) {
+          cidx_[n] = pi.validCellIndex(buf_[n].x);
+        }
+      }
+
+      findCells();
+      int n_prts_new = cells_.empty() ? 0 : cells_.back().ne;
+      if (n_prts_new > n_prts) {
+        buf_.resize(n_prts_new);
+      }
+
+      int n_cells = cells_.size();
+      for (int i = 0; i < n_cells;) {
+        if (cells_[i].ne <= cells_[i].oe) {
+          resampleCell(cells_[i]);
+          i++;
+          continue;
+        }
+        int j = i;
+        while (j < n_cells && cells_[j].ne > cells_[j].oe) {
+          j++;
+        }
+        if (j < n_cells) {
+          resampleCell(cells_[j]);
+        }
+        for (int k = j - 1; k >= i; k--) {
+          resampleCell(cells_[k]);
+        }
+        i = j + 1;
+      }
+
+      buf_.resize(n_prts_new);
+      cidx_.resize(n_prts_new);
+      for (const auto& cell : cells_) {
+        std::fill(cidx_.begin() + cell.nb, cidx_.begin() + cell.ne, cell.c);
+      }
+    }
+
+    // finds the range of particles of each cell, and where they'll go
+    void findCells()
+    {
+      int n_prts = buf_.size(), n_kinds = by_kind_.size();
+      std::vector<int> n_by_kind(n_kinds);
+      int ne = 0;
+      for (int b = 0; b < n_prts;) {
+        int c = cidx_[b], e = b;
+        std::fill(n_by_kind.begin(), n_by_kind.end(), 0);
+        while (e < n_prts && cidx_[e] == c) {
+          n_by_kind[buf_[e].kind]++;
+          e++;
+        }
+        assert(e == n_prts || cidx_[e] > c); // needs to be sorted
+
+        int n_new = 0;
+        for (int n : n_by_kind) {
+          n_new += resample_.nResampled(n);
+        }
+        cells_.push_back({c, b, e, ne, ne + n_new});
+        ne += n_new;
+        b = e;
+      }
+    }
+
+    void resampleCell(const Cell& cell)
+    {
+      // copy the cell's particles out, as the resampled ones may go where
+      // they were
+      prts_.assign(buf_.begin() + cell.ob, buf_.begin() + cell.oe);
+      for (auto& idx : by_kind_) {
+        idx.clear();
+      }
+      int n_prts = prts_.size(), n_kinds = by_kind_.size();
+      for (int n = 0; n < n_prts; n++) {
+        by_kind_[prts_[n].kind].push_back(n);
+      }
+
+      const auto& pi = mprts_.particleIndexer();
+      Int3 cpos = pi.cellPositionFromIndex(cell.c);
+      int n = cell.nb;
+      for (int kind = 0; kind < n_kinds; kind++) {
+        auto& idx = by_kind_[kind];
+        out_.clear();
+        is_new_.clear();
+        CellRng rng{rng_, gp_, uint32_t(cell.c), uint32_t(kind)};
+        resample_.resampleKind(prts_, idx, cpos, pi, rng, *this);
+        int n_out = out_.size();
+        for (int i = 0; i < n_out; i++) {
+          if (is_new_[i]) {
+            created.push_back(n);
+          }
+          buf_[n++] = out_[i];
+        }
+      }
+      assert(n == cell.ne);
+    }
+
+    void keep(const Particle& prt)
+    {
+      out_.push_back(prt);
+      is_new_.push_back(false);
+    }
+
+    void create(const Particle& prt)
+    {
+      out_.push_back(prt);
+      is_new_.push_back(true);
+    }
+
+    std::vector<Particle>& out() { return out_; }
+    std::vector<bool>& isNew() { return is_new_; }
+
+    std::vector<int> created; // indices of particles that need a new id
+    int n_merged = 0;
+    int n_split = 0;
+
+  private:
+    Resample_& resample_;
+    Mparticles& mprts_;
+    uint32_t gp_;
+    const Philox4x32& rng_;
+    typename Mparticles::BndBuffer& buf_;
+    std::vector<int>& cidx_;
+    std::vector<Cell> cells_;
+    std::vector<Particle> prts_, out_;
+    std::vector<bool> is_new_;
+    std::vector<std::vector<int>> by_kind_;
+  };
+
+  // ----------------------------------------------------------------------
+  // nResampled
+  //
+  // how many particles n particles of one kind in one cell become
+
+  int nResampled(int n) const
+  {
+    if (max_ppc_ > 0 && n > max_ppc_) {
+      int n_groups = max_ppc_ / 2, n_new = 0;
+      for (int g = 0; g < n_groups; g++) {
+        int gb = g * n / n_groups, ge = (g + 1) * n / n_groups;
+        n_new += std::min(ge - gb, 2);
+      }
+      return n_new;
+    } else if (n > 0 && n < min_ppc_) {
+      return min_ppc_;
+    }
+    return n;
+  }
+
+  // ----------------------------------------------------------------------
+  // resampleKind
+  //
+  // passes the resampled version of particles idx of prts (all of one kind,
+  // in cell cpos) to out.keep() / out.create()
+
+  template <typename Out>
+  void resampleKind(std::vector<Particle>& prts, std::vector<int>& idx,
+                    const Int3& cpos, const ParticleIndexer<real_t>& pi,
+                    CellRng& rng, Out& out)
+  {
+    int n = idx.size();
+    if (max_ppc_ > 0 && n > max_ppc_) {
+      merge(prts, idx, cpos, pi, rng, out);
+    } else if (n > 0 && n < min_ppc_) {
+      split(prts, idx, cpos, pi, rng, out);
+    } else {
+      for (int i : idx) {
+        out.keep(prts[i]);
+      }
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // setId
+  //
+  // gives a particle that carries an id a new one
+
+  template <typename P>
+  static auto setId(P& prt, Mparticles& mprts, int)
+    -> decltype(prt.id_ = mprts.uid_gen(), void())
+  {
+    prt.id_ = mprts.uid_gen();
+  }
+
+  template <typename P>
+  static void setId(P& prt, Mparticles& mprts, long)
+  {}
+
+  // ----------------------------------------------------------------------
+  // merge
+
+  template <typename Out>
+  void merge(std::vector<Particle>& prts, std::vector<int>& idx,
+             const Int3& cpos, const ParticleIndexer<real_t>& pi,
+             CellRng& rng, Out& out)
+  {
+    // merging particles with similar momenta keeps the distribution function
+    // sharpest
+    std::sort(idx.begin(), idx.end(), [&](int a, int b) {
+      return sqr(prts[a].u[0]) + sqr(prts[a].u[1]) + sqr(prts[a].u[2]) <
+             sqr(prts[b].u[0]) + sqr(prts[b].u[1]) + sqr(prts[b].u[2]);
+    });
+
+    int n = idx.size(), n_groups = max_ppc_ / 2;
+    for (int g = 0; g < n_groups; g++) {
+      int gb = g * n / n_groups, ge = (g + 1) * n / n_groups;
+      if (ge - gb <= 2) {
+        for (int i = gb; i < ge; i++) {
+          out.keep(prts[idx[i]]);
+        }
+        continue;
+      }
+
+      // totals in double precision; all weights of a kind have the same sign
+      double W = 0., E = 0.;
+      Vec3<double> X = {}, P = {};
+      for (int i = gb; i < ge; i++) {
+        const auto& prt = prts[idx[i]];
+        double w = prt.qni_wni;
+        Vec3<double> u(prt.u);
+        W += w;
+        E += w * std::sqrt(1. + sqr(u[0]) + sqr(u[1]) + sqr(u[2]));
+        for (int d = 0; d < 3; d++) {
+          X[d] += w * prt.x[d];
+          P[d] += w * u[d];
+        }
+      }
+
+      // two particles with |u| = u_t, each at angle theta to the mean
+      // momentum
+      double gamma_t = E / W;
+      double u_t = std::sqrt(std::max(sqr(gamma_t) - 1., 0.));
+      double u_mean = std::sqrt(sqr(P[0]) + sqr(P[1]) + sqr(P[2])) / W;
+      double cos_theta = u_t > 0. ? std::min(u_mean / u_t, 1.) : 1.;
+      double sin_theta = std::sqrt(1. - sqr(cos_theta));
+
+      Vec3<double> e1, e2;
+      orthonormalBasis(P, e1, e2, rng);
+
+      Particle prt = prts[idx[gb]];
+      prt.qni_wni = W / 2.;
+      for (int d = 0; d < 3; d++) {
+        prt.x[d] = X[d] / W;
+      }
+      moveIntoCell(prt.x, cpos, pi);
+
+      for (int s = -1; s <= 1; s += 2) {
+        for (int d = 0; d < 3; d++) {
+          prt.u[d] = u_t * (cos_theta * e1[d] + s * sin_theta * e2[d]);
+        }
+        out.create(prt);
+      }
+      out.n_merged += ge - gb - 2;
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // split
+
+  template <typename Out>
+  void split(std::vector<Particle>& prts, const std::vector<int>& idx,
+             const Int3& cpos, const ParticleIndexer<real_t>& pi,
+             CellRng& rng, Out& out)
+  {
+    auto& buf = out.out();
+    auto& is_new = out.isNew();
+    auto begin = buf.size();
+    for (int i : idx) {
+      out.keep(prts[i]);
+    }
+
+    while (int(buf.size() - begin) < min_ppc_) {
+      auto heaviest =
+        std::max_element(buf.begin() + begin, buf.end(),
+                         [](const Particle& a, const Particle& b) {
+                           return std::abs(a.qni_wni) < std::abs(b.qni_wni);
+                         });
+      is_new[heaviest - buf.begin()] = true;
+      Particle prt = *heaviest;
+      prt.qni_wni /= 2;
+      Particle prt2 = prt;
+      for (int d = 0; d < 3; d++) {
+        // stay within the cell on both sides
+        real_t lo = cpos[d] / pi.dxi_[d], hi = (cpos[d] + 1) / pi.dxi_[d];
+        real_t dist = std::min(prt.x[d] - lo, hi - prt.x[d]);
+        real_t delta = .5f * dist * (2 * rng.uniform() - 1);
+        prt.x[d] += delta;
+        prt2.x[d] -= delta;
+      }
+      moveIntoCell(prt.x, cpos, pi);
+      moveIntoCell(prt2.x, cpos, pi);
+      *heaviest = prt;
+      out.create(prt2);
+      out.n_split++;
+    }
+  }
+
+  // ----------------------------------------------------------------------
+  // orthonormalBasis
+  //
+  // e1 along p (or arbitrary if p == 0), e2 perpendicular to it in a random
+  // direction
+
+  void orthonormalBasis(const Vec3<double>& p, Vec3<double>& e1,
+                        Vec3<double>& e2, CellRng& rng)
+  {
+    double p_abs = std::sqrt(sqr(p[0]) + sqr(p[1]) + sqr(p[2]));
+    if (p_abs > 0.) {
+      e1 = (1. / p_abs) * p;
+    } else {
+      e1 = {0., 0., 1.};
+    }
+
+    // a, b perpendicular to e1 and each other
+    int d_min = 0;
+    for (int d = 1; d < 3; d++) {
+      if (std::abs(e1[d]) < std::abs(e1[d_min])) {
+        d_min = d;
+      }
+    }
+    Vec3<double> t = {};
+    t[d_min] = 1.;
+    Vec3<double> a = cross(e1, t);
+    a *= 1. / std::sqrt(sqr(a[0]) + sqr(a[1]) + sqr(a[2]));
+    Vec3<double> b = cross(e1, a);
+
+    double phi = 2. * M_PI * rng.uniform();
+    e2 = std::cos(phi) * a + std::sin(phi) * b;
+  }
+
+  static Vec3<double> cross(const Vec3<double>& a, const Vec3<double>& b)
+  {
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2],
+            a[0] * b[1] - a[1] * b[0]};
+  }
+
+  // ----------------------------------------------------------------------
+  // moveIntoCell
+  //
+  // a weighted average / displacement of positions within a cell is within
+  // the cell, but may round onto its upper boundary
+
+  static void moveIntoCell(Real3& x, const Int3& cpos,
+                           const ParticleIndexer<real_t>& pi)
+  {
+    for (int d = 0; d < 3; d++) {
+      while (pi.cellPosition(x[d], d) > cpos[d]) {
+        x[d] = std::nextafter(x[d], real_t(-1e30));
+      }
+      while (pi.cellPosition(x[d], d) < cpos[d]) {
+        x[d] = std::nextafter(x[d], real_t(1e30));
+      }
+    }
+  }
+
+  int min_ppc_;
+  int max_ppc_;
+  int n_merged_ = 0;
+  int n_split_ = 0;
+};
@@ -2,6 +2,7 @@
 #pragma once
 
 #include "sort.hxx"
+#include "MemoryPool.h"
 
 #include <psc_particles.h>
 
@@ -20,16 +21,25 @@ struct SortCountsort
   void operator()(Mparticles& mprts)
   {
     for (int p = 0; p < mprts.n_patches(); p++) {
-      auto& prts = mprts[p];
+      auto&& prts = mprts[p];
       unsigned int n_prts = prts.size();
 
-      unsigned int n_cells = prts.pi_.n_cells_;
+      unsigned int n_cells = mprts.pi_.n_cells_;
       unsigned int *cnts = new unsigned int[n_cells]{};
+
+      // use the cached cell indices if available, otherwise fill them in
+      auto& cidx = mprts.cellIndices(p);
+      if (!mprts.hasCellIndices()) {
+	cidx.resize(n_prts);
+	int i = 0;
+	for (auto prt_iter = prts.begin(); prt_iter != prts.end(); ++prt_iter, ++i) {
+	  cidx[i] = prts.validCellIndex(*prt_iter);
+	}
+      }
     
       // count
-      for (auto prt_iter = prts.begin(); prt_iter != prts.end(); ++prt_iter) {
-	int cni = prts.validCellIndex(*prt_iter);
-	cnts[cni]++;
+      for (int i = 0; i < n_prts; i++) {
+	cnts[cidx[i]]++;
       }
     
       // calc offsets
@@ -42,19 +52,28 @@ struct SortCountsort
       assert(cur == n_prts);
     
       // move into new position
-      auto particles2 = new Particle[n_prts];
-      for (auto prt_iter = prts.begin(); prt_iter != prts.end(); ++prt_iter) {
-	unsigned int cni = prts.validCellIndex(*prt_iter);
+      psc::mem::PoolAllocator<Particle> alloc;
+      auto particles2 = alloc.allocate(n_prts);
+      int i = 0;
+      for (auto prt_iter = prts.begin(); prt_iter != prts.end(); ++prt_iter, ++i) {
+	unsigned int cni = cidx[i];
 	particles2[cnts[cni]] = *prt_iter;
 	cnts[cni]++;
       }
     
       // back to in-place
       memcpy(&*prts.begin(), particles2, n_prts * sizeof(*particles2));
+      // the particles are now sorted by cell, and so are their cell indices
+      for (unsigned int c = 0, i = 0; c < n_cells; c++) {
+	for (; i < cnts[c]; i++) {
+	  cidx[i] = c;
+	}
+      }
     
-      delete[] particles2;
+      alloc.deallocate(particles2, n_prts);
       delete[] cnts;
     }
+    mprts.setCellIndicesValid();
   }
 };
 
@@ -75,12 +94,16 @@ struct SortCountsort2
       unsigned int n_prts = prts.size();
       
       unsigned int n_cells = mprts.pi_.n_cells_;
-      unsigned int *cnis = new unsigned int[n_prts];
-      // FIXME, might as well merge counting here, too
-      int i = 0;
-      for (auto prt_iter = prts.begin(); prt_iter != prts.end(); ++prt_iter, ++i) {
-	cnis[i] = prts.validCellIndex(*prt_iter);
+      // use the cached cell indices if available, otherwise fill them in
+      auto& cidx = mprts.cellIndices(p);
+      if (!mprts.hasCellIndices()) {
+	cidx.resize(n_prts);
+	int i = 0;
+	for (auto prt_iter = prts.begin(); prt_iter != prts.end(); ++prt_iter, ++i) {
+	  cidx[i] = prts.validCellIndex(*prt_iter);
+	}
       }
+      const int *cnis = cidx.data();
       
       unsigned int *cnts = new unsigned int[n_cells]{};
 	
@@ -100,7 +123,8 @@ struct SortCountsort2
       assert(cur == n_prts);
       
       // move into new position
-      auto particles2 = new Particle[n_prts];
+      psc::mem::PoolAllocator<Particle> alloc;
+      auto particles2 = alloc.allocate(n_prts);
       for (int i = 0; i < n_prts; i++) {
 	unsigned int cni = cnis[i];
 	int n = 1;
@@ -114,11 +138,17 @@ struct SortCountsort2
       
       // back to in-place
       memcpy(&*prts.begin(), particles2, n_prts * sizeof(*particles2));
+      // the particles are now sorted by cell, and so are their cell indices
+      for (unsigned int c = 0, i = 0; c < n_cells; c++) {
+	for (; i < cnts[c]; i++) {
+	  cidx[i] = c;
+	}
+      }
       
-      delete[] particles2;
-      delete[] cnis;
+      alloc.deallocate(particles2, n_prts);
       delete[] cnts;
     }
+    mprts.setCellIndicesValid();
   }
 };
 
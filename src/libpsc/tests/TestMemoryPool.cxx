@@ -0,0 +1,164 @@
+
+#include <MemoryPool.h>
+
+#include "gtest/gtest.h"
+
+#include <thread>
+
+using psc::mem::MemoryPool;
+using psc::mem::PoolAllocator;
+
+TEST(TestMemoryPool, SizeClass)
+{
+  EXPECT_EQ(MemoryPool::binSize(MemoryPool::sizeClass(1)), 256);
+  EXPECT_EQ(MemoryPool::binSize(MemoryPool::sizeClass(256)), 256);
+  EXPECT_EQ(MemoryPool::binSize(MemoryPool::sizeClass(257)), 288);
+  EXPECT_EQ(MemoryPool::binSize(MemoryPool::sizeClass(1000)), 1024);
+  EXPECT_EQ(MemoryPool::binSize(MemoryPool::sizeClass(1025)), 1152);
+  EXPECT_EQ(MemoryPool::binSize(MemoryPool::sizeClass(3 << 20)), 3 << 20);
+
+  // every size fits its class, and wastes at most 1/8 of it
+  for (size_t bytes = 1; bytes < (size_t(1) << 40); bytes = bytes * 9 / 7 + 1) {
+    size_t bin = MemoryPool::sizeClass(bytes);
+    size_t size = MemoryPool::binSize(bin);
+    EXPECT_GE(size, bytes);
+    EXPECT_TRUE(bytes <= 256 || size - bytes < size / 8) << bytes;
+    EXPECT_TRUE(bin == 0 || MemoryPool::binSize(bin - 1) < bytes) << bytes;
+  }
+}
+
+TEST(TestMemoryPool, Reuse)
+{
+  MemoryPool pool;
+  pool.setMaxFree(1 << 20);
+
+  void* p1 = pool.allocate(1000);
+  EXPECT_EQ(pool.stats().in_use, 1024);
+  EXPECT_EQ(pool.stats().held, 1024);
+  pool.deallocate(p1, 1000);
+  EXPECT_EQ(pool.stats().in_use, 0);
+  EXPECT_EQ(pool.stats().held, 1024);
+
+  // same size class, so gets the same block back
+  void* p2 = pool.allocate(980);
+  EXPECT_EQ(p2, p1);
+  EXPECT_EQ(pool.stats().n_reused, 1);
+
+  void* p3 = pool.allocate(3000);
+  EXPECT_NE(p3, p1);
+  EXPECT_EQ(pool.stats().high_water, 1024 + 3072);
+
+  pool.deallocate(p2, 980);
+  pool.deallocate(p3, 3000);
+  EXPECT_EQ(pool.stats().held, 1024 + 3072);
+  pool.trim();
+  EXPECT_EQ(pool.stats().held, 0);
+  EXPECT_EQ(pool.stats().high_water, 1024 + 3072);
+}
+
+TEST(TestMemoryPool, MaxFree)
+{
+  MemoryPool pool;
+
+  // by default, a quarter of the high-water mark is kept for reuse
+  std::vector<void*> ps;
+  for (int i = 0; i < 8; i++) {
+    ps.push_back(pool.allocate(4096));
+  }
+  EXPECT_EQ(pool.maxFree(), 8 * 4096 / 4);
+  for (auto p : ps) {
+    pool.deallocate(p, 4096);
+  }
+  EXPECT_EQ(pool.stats().held, 2 * 4096);
+  EXPECT_EQ(pool.stats().n_trimmed, 6);
+
+  // explicit limit
+  void* p3 = pool.allocate(256);
+  void* p4 = pool.allocate(512);
+  pool.deallocate(p3, 256);
+  pool.deallocate(p4, 512);
+  EXPECT_EQ(pool.stats().held, 2 * 4096);
+  pool.setMaxFree(1024);
+  EXPECT_EQ(pool.stats().held, 0);
+  EXPECT_EQ(pool.maxFree(), 1024);
+
+  void* p1 = pool.allocate(1024);
+  void* p2 = pool.allocate(512);
+  pool.deallocate(p1, 1024);
+  pool.deallocate(p2, 512);
+  EXPECT_EQ(pool.stats().held, 1024);
+  EXPECT_EQ(pool.stats().in_use, 0);
+}
+
+TEST(TestMemoryPool, Threads)
+{
+  MemoryPool pool;
+  pool.setMaxFree(1 << 20);
+
+  // every thread cycles through blocks of a few sizes, some shared with
+  // other threads
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&pool, t]() {
+      for (int i = 0; i < 10000; i++) {
+        size_t bytes = 1000 * (1 + (i + t) % 3);
+        void* p = pool.allocate(bytes);
+        *static_cast<char*>(p) = t;
+        pool.deallocate(p, bytes);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto stats = pool.stats();
+  EXPECT_EQ(stats.in_use, 0);
+  EXPECT_EQ(stats.n_alloc, 40000);
+  EXPECT_GT(stats.n_reused, 0);
+  EXPECT_LE(stats.held, 4 * (1024 + 2048 + 3072));
+  pool.trim();
+  EXPECT_EQ(pool.stats().held, 0);
+}
+
+TEST(TestMemoryPool, HugePage)
+{
+  MemoryPool pool;
+
+  void* p = pool.allocate(3 * MemoryPool::hugePageSize());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % MemoryPool::hugePageSize(), 0);
+  pool.deallocate(p, 3 * MemoryPool::hugePageSize());
+}
+
+TEST(TestMemoryPool, NoPooling)
+{
+  MemoryPool pool;
+  pool.setPooling(false);
+
+  void* p = pool.allocate(1000);
+  pool.deallocate(p, 1000);
+  EXPECT_EQ(pool.stats().held, 0);
+}
+
+TEST(TestMemoryPool, Vector)
+{
+  auto before = psc::mem::particlePool().stats();
+  {
+    std::vector<double, PoolAllocator<double>> vec;
+    for (int i = 0; i < 1000; i++) {
+      vec.push_back(i);
+    }
+    EXPECT_EQ(vec[999], 999.);
+    EXPECT_GT(psc::mem::particlePool().stats().in_use, before.in_use);
+  }
+  EXPECT_EQ(psc::mem::particlePool().stats().in_use, before.in_use);
+}
+
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
@@ -0,0 +1,65 @@
+
+#include <PatchAffinity.h>
+
+#include "gtest/gtest.h"
+
+#include <mpi.h>
+
+TEST(TestPatchAffinity, PatchThread)
+{
+  for (int n_threads = 1; n_threads <= 5; n_threads++) {
+    for (int n_patches = 0; n_patches <= 12; n_patches++) {
+      int p_next = 0;
+      for (int thread = 0; thread < n_threads; thread++) {
+        int p_begin, p_end;
+        psc::numa::patchRange(thread, n_threads, n_patches, &p_begin, &p_end);
+        EXPECT_EQ(p_begin, p_next);
+        for (int p = p_begin; p < p_end; p++) {
+          EXPECT_EQ(psc::numa::patchThread(p, n_patches, n_threads), thread);
+        }
+        p_next = p_end;
+      }
+      EXPECT_EQ(p_next, n_patches);
+    }
+  }
+}
+
+TEST(TestPatchAffinity, PinnedCpu)
+{
+  // 2 ranks x 4 threads on 8 shared cpus: each rank gets its own half
+  for (int thread = 0; thread < 4; thread++) {
+    EXPECT_EQ(psc::numa::pinnedCpu(thread, 4, 0, 2, 8), thread);
+    EXPECT_EQ(psc::numa::pinnedCpu(thread, 4, 1, 2, 8), 4 + thread);
+  }
+  // ranks bound to their own cpus by the launcher
+  EXPECT_EQ(psc::numa::pinnedCpu(3, 4, 0, 1, 4), 3);
+  // not enough cpus to go around
+  EXPECT_EQ(psc::numa::pinnedCpu(0, 4, 0, 3, 8), -1);
+}
+
+TEST(TestPatchAffinity, PinThreads)
+{
+  // whatever it decides, it shouldn't hang or take away all cpus
+  psc::numa::pinThreads();
+  cpu_set_t set;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(set), &set), 0);
+  EXPECT_GT(CPU_COUNT(&set), 0);
+}
+
+TEST(TestPatchAffinity, FirstTouch)
+{
+  std::vector<float, psc::numa::NoInitAllocator<float>> vec(5 * 7, 1.f);
+  psc::numa::firstTouch(vec.data(), 7, 5);
+  for (auto val : vec) {
+    EXPECT_EQ(val, 0.f);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
@@ -0,0 +1,202 @@
+
+#include "gtest/gtest.h"
+
+#include "DiagDistribution.h"
+#include "psc_particles_double.h"
+#include "psc_stats.h"
+#include "DiagnosticsDefault.h"
+
+// ======================================================================
+// DiagDistributionTest
+
+struct DiagDistributionTest : ::testing::Test
+{
+  using Mparticles = MparticlesDouble;
+
+  DiagDistributionTest()
+    : grid_{Grid_t::Domain{{1, 4, 4}, {10., 40., 40.}, {}, {1, 2, 1}},
+            {},
+            {{-1., 1., "e"}, {1., 100., "i"}},
+            {prm()},
+            .1}
+  {}
+
+  static Grid_t::NormalizationParams prm()
+  {
+    auto prm = Grid_t::NormalizationParams::dimensionless();
+    prm.nicell = 1;
+    return prm;
+  }
+
+  // scale applied to a particle's weight
+  double scale() const
+  {
+    return grid_.norm.fnqs * grid_.domain.dx[0] * grid_.domain.dx[1] *
+           grid_.domain.dx[2];
+  }
+
+  Grid_t grid_;
+};
+
+// ----------------------------------------------------------------------
+// KindPositionMomentum
+
+TEST_F(DiagDistributionTest, KindPositionMomentum)
+{
+  Mparticles mprts{grid_};
+  {
+    auto inj = mprts.injector();
+    // patch 0 covers y in [0, 20), patch 1 [20, 40)
+    inj[0]({{5., 5., 5.}, {.5, 0., 0.}, 1., 0});    // y bin 0, ux bin 3
+    inj[0]({{5., 15., 5.}, {-.5, 0., 0.}, 2., 0});  // y bin 1, ux bin 1
+    inj[1]({{5., 25., 5.}, {.5, 0., 0.}, 3., 1});   // y bin 2, ux bin 3
+    inj[1]({{5., 35., 5.}, {2., 0., 0.}, 1., 1});   // ux out of range
+  }
+
+  DiagDistributionParams prm;
+  prm.axes = {{DiagDistributionAxis::KIND},
+              {DiagDistributionAxis::Y, 4, 0., 40.},
+              {DiagDistributionAxis::UX, 4, -1., 1.}};
+  DiagDistribution diag{grid_, MPI_COMM_WORLD, prm};
+  ASSERT_EQ(diag.size(), 2 * 4 * 4);
+
+  auto hist = diag.histogram(mprts);
+  std::vector<double> ref(2 * 4 * 4);
+  ref[(0 * 4 + 0) * 4 + 3] = 1. * scale();
+  ref[(0 * 4 + 1) * 4 + 1] = 2. * scale();
+  ref[(1 * 4 + 2) * 4 + 3] = 3. * scale();
+  for (int i = 0; i < int(hist.size()); i++) {
+    EXPECT_NEAR(hist[i], ref[i], 1e-12) << "bin " << i;
+  }
+}
+
+// ----------------------------------------------------------------------
+// EnergySpectrum
+
+TEST_F(DiagDistributionTest, EnergySpectrum)
+{
+  Mparticles mprts{grid_};
+  {
+    auto inj = mprts.injector();
+    inj[0]({{5., 5., 5.}, {0., 0., 0.}, 1., 0}); // gamma - 1 = 0, not counted
+    inj[0]({{5., 5., 5.}, {0., .05, 0.}, 1., 0});    // ~1.25e-3
+    inj[0]({{5., 5., 5.}, {0., 0., 1.}, 1., 0});     // ~.414
+    inj[1]({{5., 25., 5.}, {10., 0., 0.}, 1., 0});   // ~9.05
+    inj[1]({{5., 25., 5.}, {0., 0., -.5}, 1., 0});   // ~.118
+  }
+
+  DiagDistributionParams prm;
+  prm.axes = {{DiagDistributionAxis::GAMMA_M1, 4, 1e-4, 1e4, true},
+              {DiagDistributionAxis::PITCH, 2, -1., 1.}};
+  DiagDistribution diag{grid_, MPI_COMM_WORLD, prm};
+
+  // decades 1e-4..1e-2, 1e-2..1, 1..1e2, 1e2..1e4; pitch w.r.t. z
+  auto hist = diag.histogram(mprts);
+  std::vector<double> ref(4 * 2);
+  ref[0 * 2 + 1] = 1.; // u perpendicular to z counts as cos = 0 -> upper half
+  ref[1 * 2 + 1] = 1.;
+  ref[1 * 2 + 0] = 1.;
+  ref[2 * 2 + 1] = 1.;
+  for (int i = 0; i < int(hist.size()); i++) {
+    EXPECT_NEAR(hist[i], ref[i] * scale(), 1e-12) << "bin " << i;
+  }
+}
+
+// ----------------------------------------------------------------------
+// Write
+
+TEST_F(DiagDistributionTest, Write)
+{
+  Mparticles mprts{grid_};
+  {
+    auto inj = mprts.injector();
+    inj[0]({{5., 5., 5.}, {.5, 0., 0.}, 1., 0});
+    inj[1]({{5., 25., 5.}, {.5, 0., 0.}, 2., 1});
+  }
+
+  DiagDistributionParams prm;
+  prm.basename = "test_dist";
+  prm.every_step = 1;
+  prm.axes = {{DiagDistributionAxis::KIND}};
+  DiagDistribution diag{grid_, MPI_COMM_WORLD, prm};
+  diag(mprts);
+
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  if (rank == 0) {
+    hid_t file = H5Fopen("./test_dist.000000.h5", H5F_ACC_RDONLY, H5P_DEFAULT);
+    ASSERT_GE(file, 0);
+    double hist[2], edges[3];
+    ASSERT_GE(H5LTread_dataset_double(file, "hist", hist), 0);
+    ASSERT_GE(H5LTread_dataset_double(file, "axis0", edges), 0);
+    H5Fclose(file);
+    EXPECT_NEAR(hist[0], 1. * scale(), 1e-12);
+    EXPECT_NEAR(hist[1], 2. * scale(), 1e-12);
+    EXPECT_EQ(edges[2], 2.);
+  }
+}
+
+// ----------------------------------------------------------------------
+// Diagnostics
+//
+// run along with the other diagnostics, when due
+
+struct FakeOutput
+{
+  template <typename... Args>
+  void operator()(Args&&...)
+  {
+    n_calls++;
+  }
+
+  int n_calls = 0;
+};
+
+TEST_F(DiagDistributionTest, Diagnostics)
+{
+  Mparticles mprts{grid_};
+  {
+    auto inj = mprts.injector();
+    inj[0]({{5., 5., 5.}, {.5, 0., 0.}, 1., 0});
+  }
+
+  DiagDistributionParams prm;
+  prm.basename = "test_dist_diag";
+  prm.every_step = 2;
+  prm.axes = {{DiagDistributionAxis::KIND}};
+  DiagDistribution diag{grid_, MPI_COMM_WORLD, prm};
+
+  FakeOutput outf, outp, oute;
+  auto diagnostics = makeDiagnosticsDefault(outf, outp, oute, diag);
+  int mflds = 0;
+  for (int n = 0; n < 3; n++) {
+    grid_.timestep_ = n;
+    diagnostics(mprts, mflds);
+  }
+  EXPECT_EQ(outf.n_calls, 3);
+  EXPECT_EQ(oute.n_calls, 3);
+
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  if (rank == 0) {
+    for (int n = 0; n < 3; n++) {
+      char filename[100];
+      snprintf(filename, sizeof(filename), "./test_dist_diag.%06d.h5", n);
+      FILE* file = fopen(filename, "r");
+      EXPECT_EQ(file != nullptr, n % 2 == 0) << filename;
+      if (file) {
+        fclose(file);
+        remove(filename);
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
@@ -0,0 +1,153 @@
+
+#include "gtest/gtest.h"
+
+#include "DiagReduction.h"
+#include "psc_particles_double.h"
+
+#include <random>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// ----------------------------------------------------------------------
+// KahanSum
+//
+// many contributions that are each below the rounding error of the total
+
+TEST(DiagReduction, KahanSum)
+{
+  const int n = 10000000;
+  double naive = 1.;
+  KahanSum kahan;
+  kahan += 1.;
+  for (int i = 0; i < n; i++) {
+    naive += 1e-16;
+    kahan += 1e-16;
+  }
+
+  double exact = 1. + n * 1e-16;
+  EXPECT_EQ(naive, 1.); // every single contribution got lost
+  EXPECT_NEAR(kahan.value(), exact, 1e-15);
+}
+
+// ----------------------------------------------------------------------
+// PairwiseSum
+//
+// for 2^k equal values, each level of the pairwise sum is exact, while the
+// running sum accumulates a rounding error at every step
+
+TEST(DiagReduction, PairwiseSum)
+{
+  const int n = 1 << 22;
+  std::vector<double> vals(n, .1);
+  double naive = 0.;
+  for (auto val : vals) {
+    naive += val;
+  }
+
+  double exact = .1 * n;
+  EXPECT_EQ(pairwiseSum(vals, 0, n), exact);
+  EXPECT_GT(std::abs(naive - exact), 1e-12 * exact);
+}
+
+// ----------------------------------------------------------------------
+// ReduceParticles
+//
+// one heavy particle and many light ones, through the fused reduction
+
+struct WeightItem
+{
+  static const int n_vals = 1;
+
+  std::vector<std::string> names() const { return {"w"}; }
+
+  double scale(const Grid_t& grid) const { return 1.; }
+
+  template <typename Particle>
+  void particle(const Particle& prt, KahanSum* sums) const
+  {
+    sums[0] += prt.w();
+  }
+};
+
+TEST(DiagReduction, ReduceParticles)
+{
+  auto prm = Grid_t::NormalizationParams::dimensionless();
+  prm.nicell = 1;
+  Grid_t grid{Grid_t::Domain{{1, 4, 4}, {10., 40., 40.}, {}, {1, 2, 1}},
+              {},
+              {{1., 1., "i"}},
+              {prm},
+              .1};
+
+  const int n = 100000;
+  MparticlesDouble mprts{grid};
+  {
+    auto inj = mprts.injector();
+    inj[0]({{5., 5., 5.}, {}, 1., 0});
+    for (int i = 0; i < n; i++) {
+      inj[0]({{5., 5., 5.}, {}, 1e-17, 0});
+      inj[1]({{5., 25., 5.}, {}, 1e-17, 0});
+    }
+  }
+
+  auto vals = reduceParticles(mprts, WeightItem{});
+  ASSERT_EQ(vals.size(), 1);
+  EXPECT_NEAR(vals[0], 1. + 2 * n * 1e-17, 1e-15);
+  EXPECT_NE(vals[0], 1.);
+}
+
+// ----------------------------------------------------------------------
+// ThreadCountIndependent
+//
+// every patch has its own sums, combined in a fixed order, so the result is
+// the same to the last bit however many threads are used
+
+TEST(DiagReduction, ThreadCountIndependent)
+{
+  auto prm = Grid_t::NormalizationParams::dimensionless();
+  prm.nicell = 1;
+  Grid_t grid{Grid_t::Domain{{1, 8, 8}, {10., 80., 80.}, {}, {1, 4, 4}},
+              {},
+              {{1., 1., "i"}},
+              {prm},
+              .1};
+
+  MparticlesDouble mprts{grid};
+  {
+    std::mt19937 rng;
+    std::uniform_real_distribution<double> w(0., 1.);
+    auto inj = mprts.injector();
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      auto injector = inj[p];
+      auto& xb = grid.patches[p].xb;
+      for (int i = 0; i < 1000; i++) {
+        injector({{xb[0] + 5., xb[1] + 5., xb[2] + 5.},
+                  {},
+                  std::pow(10., -10. * w(rng)),
+                  0});
+      }
+    }
+  }
+
+#ifdef _OPENMP
+  omp_set_num_threads(1);
+#endif
+  auto vals1 = reduceParticles(mprts, WeightItem{});
+#ifdef _OPENMP
+  omp_set_num_threads(4);
+#endif
+  auto vals4 = reduceParticles(mprts, WeightItem{});
+  ASSERT_EQ(vals1.size(), 1);
+  EXPECT_EQ(vals1, vals4);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
@@ -0,0 +1,217 @@
+
+#include "gtest/gtest.h"
+
+#include "../libpsc/psc_heating/psc_heating_impl.hxx"
+#include "psc_particles_double.h"
+
+#include <random>
+
+// ======================================================================
+// HeatingTest
+
+struct HeatingTest : ::testing::Test
+{
+  using Mparticles = MparticlesDouble;
+  using Particle = typename Mparticles::Particle;
+
+  // patch 0 covers y in [0, 20), patch 1 [20, 40)
+  HeatingTest()
+    : grid_{Grid_t::Domain{{1, 4, 4}, {10., 40., 40.}, {}, {1, 2, 1}},
+            {},
+            {{-1., 1., "e"}, {1., 100., "i"}},
+            {prm()},
+            .1}
+  {}
+
+  static Grid_t::NormalizationParams prm()
+  {
+    auto prm = Grid_t::NormalizationParams::dimensionless();
+    prm.nicell = 1;
+    return prm;
+  }
+
+  // heated for y < 20 only, at a rate that changes from cell to cell in z
+  static double H(const double* xx)
+  {
+    return xx[1] < 20. ? 1. + std::floor(xx[2] / 10.) : 0.;
+  }
+
+  // n particles of each kind per cell, at rest
+  void inject(Mparticles& mprts, int n)
+  {
+    std::mt19937 rng;
+    std::uniform_real_distribution<double> pos(0., 1.);
+    auto inj = mprts.injector();
+    for (int iz = 0; iz < 4; iz++) {
+      for (int iy = 0; iy < 4; iy++) {
+        auto injector = inj[iy / 2];
+        for (int i = 0; i < n; i++) {
+          for (int kind = 0; kind < 2; kind++) {
+            Double3 x = {5., 10. * (iy + pos(rng)), 10. * (iz + pos(rng))};
+            injector({x, {}, 1., kind});
+          }
+        }
+      }
+    }
+  }
+
+  // the way Heating__ used to kick, one particle after the other, from a
+  // single rng
+  void heatSerial(Mparticles& mprts, int kind, double heating_dt)
+  {
+    std::mt19937 rng{1234};
+    std::normal_distribution<double> normal;
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      auto& patch = grid_.patches[p];
+      for (auto& prt : mprts[p]) {
+        double xx[3] = {prt.x[0] + patch.xb[0], prt.x[1] + patch.xb[1],
+                        prt.x[2] + patch.xb[2]};
+        double h = H(xx);
+        if (prt.kind != kind || h <= 0.) {
+          continue;
+        }
+        double Dp = std::sqrt(h * heating_dt);
+        for (int d = 0; d < 3; d++) {
+          prt.u[d] += Dp * normal(rng);
+        }
+      }
+    }
+  }
+
+  // mean u^2 of kind 0 per z cell, in the heated region
+  std::vector<double> meanU2(Mparticles& mprts)
+  {
+    std::vector<double> sum(4), cnt(4);
+    for (auto& prt : mprts[0]) {
+      if (prt.kind != 0) {
+        continue;
+      }
+      int iz = prt.x[2] / 10.;
+      sum[iz] += sqr(prt.u[0]) + sqr(prt.u[1]) + sqr(prt.u[2]);
+      cnt[iz]++;
+    }
+    for (int iz = 0; iz < 4; iz++) {
+      sum[iz] /= cnt[iz];
+    }
+    return sum;
+  }
+
+  Grid_t grid_;
+};
+
+// ----------------------------------------------------------------------
+// MeanKickEnergy
+//
+// the cached per-cell amplitudes and parallel counter-based kicks should
+// heat at the same rate as the serial version: every kick adds 3 H dt to
+// u^2 on average
+
+TEST_F(HeatingTest, MeanKickEnergy)
+{
+  const int n = 2000;
+  Mparticles mprts{grid_}, mprts_serial{grid_};
+  inject(mprts, n);
+  inject(mprts_serial, n);
+
+  Heating__<Mparticles> heating{grid_, 1, 0, H};
+  heating(mprts);
+  heatSerial(mprts_serial, 0, grid_.dt);
+
+  auto u2 = meanU2(mprts);
+  auto u2_serial = meanU2(mprts_serial);
+  for (int iz = 0; iz < 4; iz++) {
+    double ref = 3. * (1. + iz) * grid_.dt;
+    // each mean is over 2 * 2000 particles, with relative std dev ~ 1.3%
+    EXPECT_NEAR(u2[iz], u2_serial[iz], .1 * ref) << "iz " << iz;
+    EXPECT_NEAR(u2[iz], ref, .07 * ref) << "iz " << iz;
+  }
+
+  // other kind, and the unheated patch, stay untouched
+  for (int p = 0; p < mprts.n_patches(); p++) {
+    for (auto& prt : mprts[p]) {
+      if (prt.kind == 1 || p == 1) {
+        EXPECT_EQ(prt.u[0], 0.);
+        EXPECT_EQ(prt.u[1], 0.);
+        EXPECT_EQ(prt.u[2], 0.);
+      }
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// Reproducible
+//
+// the kicks don't depend on the order the patches get processed in
+
+TEST_F(HeatingTest, Reproducible)
+{
+  Mparticles mprts{grid_}, mprts2{grid_};
+  inject(mprts, 100);
+  inject(mprts2, 100);
+
+  Heating__<Mparticles> heating{grid_, 1, 0, H};
+  heating(mprts);
+  Heating__<Mparticles> heating2{grid_, 1, 0, H};
+  heating2(mprts2);
+
+  for (int p = 0; p < mprts.n_patches(); p++) {
+    auto prts = mprts[p];
+    auto prts2 = mprts2[p];
+    ASSERT_EQ(prts.size(), prts2.size());
+    for (int n = 0; n < int(prts.size()); n++) {
+      for (int d = 0; d < 3; d++) {
+        EXPECT_EQ(prts[n].u[d], prts2[n].u[d]);
+      }
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// SubCellProfile
+//
+// H varies within a cell, but is sampled at the cell center: particles in
+// the lower and upper half of a cell get the same kicks on average, at the
+// cell center's rate (evaluated per particle, each half would be off by
+// 6 - 25%)
+
+TEST_F(HeatingTest, SubCellProfile)
+{
+  auto H_linear = [](const double* xx) { return 1. + xx[2] / 5.; };
+
+  const int n = 4000;
+  Mparticles mprts{grid_};
+  inject(mprts, n);
+
+  Heating__<Mparticles> heating{grid_, 1, 0, H_linear};
+  heating(mprts);
+
+  std::vector<double> sum(8), cnt(8);
+  for (int p = 0; p < mprts.n_patches(); p++) {
+    for (auto& prt : mprts[p]) {
+      if (prt.kind != 0) {
+        continue;
+      }
+      int half = prt.x[2] / 5.;
+      sum[half] += sqr(prt.u[0]) + sqr(prt.u[1]) + sqr(prt.u[2]);
+      cnt[half]++;
+    }
+  }
+  for (int iz = 0; iz < 4; iz++) {
+    double zc = 10. * iz + 5.;
+    double ref = 3. * (1. + zc / 5.) * grid_.dt;
+    for (int half = 2 * iz; half < 2 * iz + 2; half++) {
+      // each mean is over ~ 4 * 2000 particles, relative std dev ~ 1%
+      EXPECT_NEAR(sum[half] / cnt[half], ref, .05 * ref)
+        << "iz " << iz << " half " << half;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
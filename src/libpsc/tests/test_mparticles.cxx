@@ -18,6 +18,8 @@
 #endif
 #include "particles_simple.inl"
 #include <kg/io.h>
+#include <algorithm>
+#include <array>
 
 #ifdef DO_VPIC
 using VpicConfig = VpicConfigWrap;
@@ -544,6 +546,45 @@ TEST(TestSetupParticles, Tag)
   }
 }
 
+TEST(TestSetupParticles, DecompositionIndependent)
+{
+  using Mparticles = MparticlesDouble;
+
+  auto kinds = Grid_t::Kinds{{1., 100., "i"}, {-1., 1., "e"}};
+  auto prm = Grid_t::NormalizationParams::dimensionless();
+  prm.nicell = 2;
+
+  // returns the particles, shifted into global coordinates and sorted, so
+  // that setups on different decompositions can be compared
+  auto setup = [&](Int3 np) {
+    auto domain = Grid_t::Domain{{1, 4, 4}, {10., 40., 40.}, {}, np};
+    Grid_t grid{domain, {}, kinds, {prm}, .1};
+    Mparticles mprts{grid};
+
+    SetupParticles<Mparticles> setup_particles(grid);
+    setup_particles(mprts, [&](int kind, Double3 crd, psc_particle_npt& npt) {
+      npt.n = 1;
+      npt.T[0] = npt.T[1] = npt.T[2] = .01;
+    });
+
+    std::vector<std::array<double, 6>> prts;
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      auto& patch = grid.patches[p];
+      for (auto& prt : mprts[p]) {
+        prts.push_back({prt.x[0] + patch.xb[0], prt.x[1] + patch.xb[1],
+                        prt.x[2] + patch.xb[2], prt.u[0], prt.u[1], prt.u[2]});
+      }
+    }
+    std::sort(prts.begin(), prts.end());
+    return prts;
+  };
+
+  auto prts1 = setup({1, 1, 1});
+  auto prts2 = setup({1, 2, 2});
+  EXPECT_EQ(prts1.size(), 16 * kinds.size() * prm.nicell);
+  EXPECT_EQ(prts1, prts2);
+}
+
 int main(int argc, char** argv)
 {
   MPI_Init(&argc, &argv);
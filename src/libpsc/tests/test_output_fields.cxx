@@ -0,0 +1,114 @@
+
+#include "gtest/gtest.h"
+
+#include "OutputFieldsView.h"
+#include "psc_fields_c.h"
+
+// ======================================================================
+// OutputFieldsViewTest
+
+struct OutputFieldsViewTest : ::testing::Test
+{
+  // 2 patches in y, x invariant
+  OutputFieldsViewTest()
+    : grid_{Grid_t::Domain{{1, 8, 4}, {10., 80., 40.}, {}, {1, 2, 1}},
+            {},
+            {},
+            {},
+            .1}
+  {}
+
+  // a function that's linear in each direction, so that the block average
+  // is its value at the center of the block
+  static double f(int m, double y, double z) { return m + 10. * y + 100. * z; }
+
+  void setup(MfieldsC& mflds)
+  {
+    for (int p = 0; p < mflds.n_patches(); p++) {
+      auto& off = grid_.patches[p].off;
+      grid_.Foreach_3d(0, 0, [&](int i, int j, int k) {
+        for (int m = 0; m < mflds.n_comps(); m++) {
+          mflds[p](m, i, j, k) = f(m, off[1] + j, off[2] + k);
+        }
+      });
+    }
+  }
+
+  Grid_t grid_;
+};
+
+// ----------------------------------------------------------------------
+// Coarsened
+//
+// 2 x 2 blocks in y, z (x is invariant, so it's not coarsened even if asked
+// to be)
+
+TEST_F(OutputFieldsViewTest, Coarsened)
+{
+  MfieldsC mflds{grid_, 2, grid_.ibn};
+  setup(mflds);
+
+  auto view = OutputFieldsView{"coarse", {2, 2, 2}};
+  OutputFieldsViewWriter writer{"pfd", ".", view};
+  mrc_fld* fld = writer.coarsened(mflds, grid_, "test", {"a", "b"});
+
+  int n_cells = 0;
+  for (int p = 0; p < mflds.n_patches(); p++) {
+    mrc_fld_patch* m3p = mrc_fld_patch_get(fld, p);
+    mrc_patch_info info;
+    mrc_domain_get_local_patch_info(fld->_domain, p, &info);
+    const int* off = info.off;
+    EXPECT_EQ(off[1], grid_.patches[p].off[1] / 2);
+    mrc_fld_foreach(fld, i, j, k, 0, 0)
+    {
+      EXPECT_EQ(i, 0);
+      for (int m = 0; m < 2; m++) {
+        double y = 2 * (off[1] + j) + .5, z = 2 * (off[2] + k) + .5;
+        EXPECT_NEAR(MRC_M3(m3p, m, i, j, k), f(m, y, z), 1e-10)
+          << "p " << p << " j " << j << " k " << k;
+      }
+      n_cells++;
+    }
+    mrc_fld_foreach_end;
+    mrc_fld_patch_put(fld);
+  }
+  EXPECT_EQ(n_cells, 1 * 4 * 2);
+  mrc_fld_destroy(fld);
+
+  // and through the writer
+  writer.open(grid_);
+  writer.write(mflds, grid_, "test", {"a", "b"});
+  writer.close();
+}
+
+// ----------------------------------------------------------------------
+// Uncoarsened
+//
+// a view without coarsening passes the fields through unchanged
+
+TEST_F(OutputFieldsViewTest, Uncoarsened)
+{
+  MfieldsC mflds{grid_, 1, grid_.ibn};
+  setup(mflds);
+
+  auto view = OutputFieldsView{"full"};
+  OutputFieldsViewWriter writer{"pfd", ".", view};
+  mrc_fld* fld = writer.coarsened(mflds, grid_, "test", {"a"});
+  for (int p = 0; p < mflds.n_patches(); p++) {
+    mrc_fld_patch* m3p = mrc_fld_patch_get(fld, p);
+    grid_.Foreach_3d(0, 0, [&](int i, int j, int k) {
+      EXPECT_EQ(MRC_M3(m3p, 0, i, j, k), mflds[p](0, i, j, k));
+    });
+    mrc_fld_patch_put(fld);
+  }
+  mrc_fld_destroy(fld);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
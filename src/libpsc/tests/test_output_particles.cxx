@@ -90,12 +90,214 @@ TYPED_TEST(OutputParticlesTest, Test1)
   outp(mprts);
 }
 
+// ======================================================================
+// Selection
+
+TYPED_TEST(OutputParticlesTest, Selection)
+{
+  using Mparticles = typename TypeParam::Mparticles;
+
+  auto kinds = Grid_t::Kinds{{1., 100., "ion"}, {-1., 1., "electron"}};
+  this->make_psc(kinds);
+  const auto& grid = this->grid();
+
+  Mparticles mprts{grid};
+  {
+    auto injector = mprts.injector();
+    for (int n = 0; n < 100; n++) {
+      injector[0]({{1., 0., 0.}, {double(n), 0., 0.}, 1., n % 2});
+    }
+  }
+
+  auto count = [&](const OutputParticlesParams& params) {
+    auto selection = OutputParticlesSelection{params, grid.timestep()};
+    auto accessor = mprts.accessor();
+    int n = 0, n_selected = 0;
+    for (auto prt : accessor[0]) {
+      if (selection.selectKind(prt.kind()) && selection(prt, n, 0, n)) {
+        n_selected++;
+      }
+      n++;
+    }
+    return n_selected;
+  };
+
+  auto params = OutputParticlesParams{};
+  EXPECT_EQ(count(params), 100);
+
+  params.stride = 10;
+  EXPECT_EQ(count(params), 10);
+
+  params = OutputParticlesParams{};
+  params.kinds = {1};
+  EXPECT_EQ(count(params), 50);
+
+  params = OutputParticlesParams{};
+  params.p_min = 90.;
+  EXPECT_EQ(count(params), 10);
+
+  params = OutputParticlesParams{};
+  params.fraction = .5;
+  int n_selected = count(params);
+  EXPECT_GT(n_selected, 30);
+  EXPECT_LT(n_selected, 70);
+  EXPECT_EQ(count(params), n_selected); // reproducible
+
+  // should also make it through the actual writers
+  params.every_step = 1;
+  params.data_dir = ".";
+  params.basename = "prt_sel";
+  params.stride = 2;
+  auto outp = typename TypeParam::OutputParticles{grid, params};
+  outp(mprts);
+
+  // the stride applies per cell and kind, so with the kinds alternating,
+  // half of each kind gets written
+  params.fraction = 1.;
+  params.basename = "prt_stride";
+  auto outp2 = typename TypeParam::OutputParticles{grid, params};
+  outp2(mprts);
+  if (std::is_same<typename TypeParam::OutputParticles,
+                   OutputParticlesAscii>::value) {
+    FILE* file = fopen("./prt_stride.000000_p000000.asc", "r");
+    ASSERT_TRUE(file);
+    int n_by_kind[2] = {}, n, kind;
+    float x[7];
+    while (fscanf(file, "%d %g %g %g %g %g %g %g %d", &n, &x[0], &x[1], &x[2],
+                  &x[3], &x[4], &x[5], &x[6], &kind) == 9) {
+      n_by_kind[kind]++;
+    }
+    fclose(file);
+    EXPECT_EQ(n_by_kind[0], 25);
+    EXPECT_EQ(n_by_kind[1], 25);
+  }
+}
+
+// ======================================================================
+// WriteAsync
+
+TYPED_TEST(OutputParticlesTest, WriteAsync)
+{
+  using Mparticles = typename TypeParam::Mparticles;
+  using OutputParticles = typename TypeParam::OutputParticles;
+
+  auto kinds = Grid_t::Kinds{{1., 100., "ion"}, {-1., 1., "electron"}};
+  this->make_psc(kinds);
+  const auto& grid = this->grid();
+
+  Mparticles mprts{grid};
+  {
+    auto injector = mprts.injector();
+    for (int n = 0; n < 100; n++) {
+      injector[0]({{1., 0., 0.}, {double(n), 0., 0.}, 1., n % 2});
+    }
+  }
+
+  auto params = OutputParticlesParams{};
+  params.every_step = 1;
+  params.data_dir = ".";
+  params.basename = "prt_async";
+  params.write_async = true;
+
+  auto outp = OutputParticles{grid, params};
+  outp(mprts);
+  // the particles may change while they're being written
+  mprts.reset(grid);
+  asyncWriter().wait();
+}
+
+// ======================================================================
+// Compression
+
+TYPED_TEST(OutputParticlesTest, Compression)
+{
+  using Mparticles = typename TypeParam::Mparticles;
+  using OutputParticles = typename TypeParam::OutputParticles;
+
+  auto kinds = Grid_t::Kinds{{1., 100., "ion"}, {-1., 1., "electron"}};
+  this->make_psc(kinds);
+  const auto& grid = this->grid();
+
+  Mparticles mprts{grid};
+  {
+    auto injector = mprts.injector();
+    for (int n = 0; n < 100; n++) {
+      injector[0]({{1., 0., 0.}, {double(n), 0., 0.}, 1., 0});
+    }
+  }
+
+  // lz4 falls back to deflate if the filter plugin isn't around
+  for (auto compression : {"deflate", "lz4"}) {
+    auto params = OutputParticlesParams{};
+    params.every_step = 1;
+    params.data_dir = ".";
+    params.basename = "prt_compr";
+    params.compression = compression;
+
+    {
+      auto outp = OutputParticles{grid, params};
+      outp(mprts);
+    }
+
+    if (!std::is_same<OutputParticles, OutputParticlesHdf5>::value) {
+      continue;
+    }
+
+    // the particles should read back unchanged, from a filtered dataset
+    hid_t file = H5Fopen("./prt_compr.000000_p000000.h5", H5F_ACC_RDONLY,
+                         H5P_DEFAULT);
+    ASSERT_GE(file, 0);
+    hid_t dset = H5Dopen(file, "particles/p0/1d", H5P_DEFAULT);
+    ASSERT_GE(dset, 0);
+    hid_t dcpl = H5Dget_create_plist(dset);
+    EXPECT_EQ(H5Pget_layout(dcpl), H5D_CHUNKED);
+    EXPECT_EQ(H5Pget_nfilters(dcpl), 2); // shuffle + compressor
+    H5Pclose(dcpl);
+
+    detail::Hdf5ParticleType prt_type;
+    std::vector<hdf5_prt> prts(100);
+    ASSERT_GE(H5Dread(dset, prt_type, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+                      prts.data()),
+              0);
+    std::vector<float> pxs;
+    for (auto& prt : prts) {
+      EXPECT_EQ(prt.x, 1.f);
+      pxs.push_back(prt.px);
+    }
+    std::sort(pxs.begin(), pxs.end());
+    for (int n = 0; n < 100; n++) {
+      EXPECT_EQ(pxs[n], float(n));
+    }
+    H5Dclose(dset);
+    H5Fclose(file);
+  }
+}
+
+// ======================================================================
+// AsyncWriter
+
+TEST(AsyncWriter, Order)
+{
+  auto& writer = asyncWriter();
+  std::vector<int> done;
+  for (int n = 0; n < 10; n++) {
+    writer.submit([&done, n]() { done.push_back(n); }, n % 3 != 0);
+  }
+  writer.wait();
+
+  ASSERT_EQ(done.size(), 10);
+  for (int n = 0; n < 10; n++) {
+    EXPECT_EQ(done[n], n);
+  }
+}
+
 // ----------------------------------------------------------------------
 // main
 
 int main(int argc, char **argv)
 {
-  MPI_Init(&argc, &argv);
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
   ::testing::InitGoogleTest(&argc, argv);
   int rc = RUN_ALL_TESTS();
   MPI_Finalize();
@@ -14,6 +14,8 @@
 using PushParticlesTestTypes = ::testing::Types<TestConfig2ndDoubleYZ,
 						TestConfig1vbec3dSingleYZ,
 						TestConfig1vbec3dSingleXZ,
+						TestConfig1vbec3dSingleYZAcc,
+						TestConfig1vbec3dSingleXZAcc,
 						//TestConfigVpic,
 #ifdef USE_CUDA
 						TestConfig1vbec3dCudaYZ,
@@ -22,7 +24,8 @@ using PushParticlesTestTypes = ::testing::Types<TestConfig2ndDoubleYZ,
 #endif
 						TestConfig2ndDouble,
 						TestConfig2ndSingle,
-						TestConfig1vbec3dSingle>;
+						TestConfig1vbec3dSingle,
+						TestConfig1vbec3dSingleAcc>;
 
 TYPED_TEST_SUITE(PushParticlesTest, PushParticlesTestTypes);
 
@@ -2,9 +2,11 @@
 #include "gtest/gtest.h"
 
 #include "testing.hxx"
+#include "../libpsc/psc_sort/psc_sort_impl.hxx"
 
 using PushParticlesTestTypes = ::testing::Types<TestConfig2ndDoubleYZ
 						,TestConfig1vbec3dSingle
+						,TestConfig1vbec3dSingleAcc
 #ifdef USE_CUDA
 						,TestConfig1vbec3dCudaYZ
 						//,TestConfig1vbec3dCuda444
@@ -167,6 +169,231 @@ TYPED_TEST(PushParticlesTest, Cyclo)
   }
 }
 
+// ======================================================================
+// CellIndices test
+//
+// the cell indices cached by the pusher / bnd exchange / sort need to match
+// what'd be computed from the particle positions
+
+using PushParticlesCellIndicesTest = PushParticlesTest<TestConfig1vbec3dSingle>;
+
+TEST_F(PushParticlesCellIndicesTest, CellIndices)
+{
+  using Mparticles = typename TestConfig1vbec3dSingle::Mparticles;
+  using BndParticles = typename TestConfig1vbec3dSingle::BndParticles;
+
+  const int n_prts = 131;
+  const int n_steps = 10;
+
+  auto kinds = Grid_t::Kinds{Grid_t::Kind(1., 1., "test_species")};
+  make_psc(kinds);
+  const auto& grid = this->grid();
+  
+  auto mflds = MfieldsState{grid};
+  setupFields(mflds, [](int m, double crd[3]) {
+      switch (m) {
+      case EX: return 1.;
+      case HZ: return .1;
+      default: return 0.;
+      }
+    });
+
+  RngPool rngpool;
+  Rng *rng = rngpool[0];
+
+  Mparticles mprts{grid};
+  {
+    auto inj = mprts.injector();
+    for (int p = 0; p < grid.n_patches(); p++) {
+      auto injector = inj[p];
+      for (int n = 0; n < n_prts; n++) {
+	injector({{rng->uniform(0, L), rng->uniform(0, L), rng->uniform(0, L)},
+	      {rng->uniform(-1, 1), rng->uniform(-1, 1), rng->uniform(-1, 1)}, 1., 0});
+      }
+    }
+  }
+  EXPECT_FALSE(mprts.hasCellIndices());
+
+  auto check = [&]() {
+    ASSERT_TRUE(mprts.hasCellIndices());
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      auto&& prts = mprts[p];
+      const auto& cidx = mprts.cellIndices(p);
+      ASSERT_EQ(cidx.size(), prts.size());
+      for (int n = 0; n < int(prts.size()); n++) {
+	EXPECT_EQ(cidx[n], prts.validCellIndex(prts[n]));
+      }
+    }
+  };
+
+  PushParticles pushp_;
+  BndParticles bndp_{grid};
+  SortCountsort2<Mparticles> sort_;
+  for (int n = 0; n < n_steps; n++) {
+    pushp_.push_mprts(mprts, mflds);
+    EXPECT_TRUE(mprts.hasCellIndices());
+    bndp_(mprts);
+    check();
+    sort_(mprts);
+    check();
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      const auto& cidx = mprts.cellIndices(p);
+      EXPECT_TRUE(std::is_sorted(cidx.begin(), cidx.end()));
+    }
+  }
+
+  // anything that might move particles invalidates the cache
+  mprts.accessor_();
+  EXPECT_FALSE(mprts.hasCellIndices());
+  bndp_(mprts);
+  check();
+}
+
+// ======================================================================
+// Subcycle test
+//
+// kind 1's momentum is only pushed every 4th step, by 4 dt (2.5 dt the
+// first time), while its position and current still advance every step, so
+// charge stays conserved
+
+using PushParticlesSubcycleTest = PushParticlesTest<TestConfig1vbec3dSingle>;
+
+TEST_F(PushParticlesSubcycleTest, Accel)
+{
+  using Mparticles = typename TestConfig1vbec3dSingle::Mparticles;
+  using BndParticles = typename TestConfig1vbec3dSingle::BndParticles;
+  using Bnd = typename TestConfig1vbec3dSingle::Bnd;
+  using Checks = typename TestConfig1vbec3dSingle::Checks;
+
+  const int n_prts = 131;
+  const int n_steps = 10;
+  const int n_sub = 4;
+  const real_t eps = 1e-5;
+
+  auto kinds = Grid_t::Kinds{Grid_t::Kind(1., 1., "e"),
+                             Grid_t::Kind(1., 10., "i")};
+  make_psc(kinds);
+  const auto& grid = this->grid();
+
+  auto mflds = MfieldsState{grid};
+  setupFields(mflds, [](int m, double crd[3]) {
+      switch (m) {
+      case EX: return .01;
+      case EY: return .02;
+      case EZ: return .03;
+      default: return 0.;
+      }
+    });
+
+  RngPool rngpool;
+  Rng *rng = rngpool[0];
+
+  Mparticles mprts{grid};
+  {
+    auto inj = mprts.injector();
+    for (int p = 0; p < grid.n_patches(); p++) {
+      auto injector = inj[p];
+      for (int n = 0; n < n_prts; n++) {
+	injector({{rng->uniform(0, L), rng->uniform(0, L), rng->uniform(0, L)},
+	      {}, 1., n % 2});
+      }
+    }
+  }
+
+  PushParticles pushp_;
+  pushp_.set_subcycle({1, n_sub});
+  BndParticles bndp_{grid};
+  Bnd bnd_{grid, ibn};
+  ChecksParams checks_params{};
+  checks_params.continuity_threshold = 1e-10;
+  checks_params.continuity_verbose = false;
+  Checks checks_{grid, MPI_COMM_WORLD, checks_params};
+  for (int n = 0; n < n_steps; n++) {
+    checks_.continuity_before_particle_push(mprts);
+    pushp_.push_mprts(mprts, mflds);
+    bndp_(mprts);
+    bnd_.add_ghosts(mflds, JXI, JXI+3);
+    bnd_.fill_ghosts(mflds, JXI, JXI+3);
+    checks_.continuity_after_particle_push(mprts, mflds);
+    grid_->timestep_++;
+
+    // the ions got the impulse of the whole subcycle on its first step
+    double fac_e = n + 1, fac_i = .1 * (.5 * (n_sub + 1) + n_sub * (n / n_sub));
+    auto accessor = mprts.accessor();
+    for (auto prt : accessor[0]) {
+      double fac = prt.kind() == 0 ? fac_e : fac_i;
+      EXPECT_NEAR(prt.u()[0], .01 * fac, eps);
+      EXPECT_NEAR(prt.u()[1], .02 * fac, eps);
+      EXPECT_NEAR(prt.u()[2], .03 * fac, eps);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// Centered
+//
+// in a uniform E field, subcycled particles should end up exactly where the
+// non-subcycled ones do at the end of every cycle (as both are leapfrog),
+// while a kick that isn't centered would leave them ahead by an amount
+// growing with time (the fields are weak enough for the particles to stay
+// non-relativistic)
+
+TEST_F(PushParticlesSubcycleTest, Centered)
+{
+  using Mparticles = typename TestConfig1vbec3dSingle::Mparticles;
+
+  const int n_prts = 20;
+  const int n_steps = 16;
+  const int n_sub = 4;
+  const real_t eps = 1e-4;
+
+  auto kinds = Grid_t::Kinds{Grid_t::Kind(1., 1., "a"),
+                             Grid_t::Kind(1., 1., "b")};
+  make_psc(kinds);
+  const auto& grid = this->grid();
+
+  auto mflds = MfieldsState{grid};
+  setupFields(mflds, [](int m, double crd[3]) {
+      switch (m) {
+      case EX: return .001;
+      case EY: return -.002;
+      default: return 0.;
+      }
+    });
+
+  RngPool rngpool;
+  Rng *rng = rngpool[0];
+
+  // pairs of particles of either kind at the same position, away from the
+  // boundaries so that no bnd exchange is needed
+  Mparticles mprts{grid};
+  {
+    auto injector = mprts.injector()[0];
+    for (int n = 0; n < n_prts; n++) {
+      Double3 x = {rng->uniform(40, 120), rng->uniform(40, 120), rng->uniform(40, 120)};
+      injector({x, {}, 1., 0});
+      injector({x, {}, 1., 1});
+    }
+  }
+
+  PushParticles pushp_;
+  pushp_.set_subcycle({1, n_sub});
+  for (int n = 0; n < n_steps; n++) {
+    pushp_.push_mprts(mprts, mflds);
+    grid_->timestep_++;
+
+    if ((n + 1) % n_sub != 0) {
+      continue;
+    }
+    auto&& prts = mprts[0];
+    for (int i = 0; i < int(prts.size()); i += 2) {
+      for (int d = 0; d < 3; d++) {
+        EXPECT_NEAR(prts[i + 1].x[d], prts[i].x[d], eps) << "step " << n;
+      }
+    }
+  }
+}
+
 // ======================================================================
 // main
 
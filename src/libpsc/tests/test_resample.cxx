@@ -0,0 +1,336 @@
+
+#include "gtest/gtest.h"
+
+#include "../libpsc/psc_resample/psc_resample_impl.hxx"
+#include "../libpsc/psc_sort/psc_sort_impl.hxx"
+#include "psc_particles_double.h"
+#include "particle_with_id.h"
+
+#include <map>
+#include <random>
+#include <set>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// ======================================================================
+// ResampleTest
+
+struct ResampleTest : ::testing::Test
+{
+  using Mparticles = MparticlesDouble;
+
+  // totals of one kind in one cell
+  struct Moments
+  {
+    int n = 0;
+    double w = 0., e = 0.;
+    Double3 x = {}, u = {};
+  };
+
+  ResampleTest() : grid_{domain({1, 1, 1}), {}, kinds(), {prm()}, .1} {}
+
+  // patch-local cells are 10 x 10 x 10
+  static Grid_t::Domain domain(Int3 np)
+  {
+    return Grid_t::Domain{{1, 4, 4}, {10., 40., 40.}, {}, np};
+  }
+
+  static Grid_t::Kinds kinds() { return {{-1., 1., "e"}, {1., 100., "i"}}; }
+
+  static Grid_t::NormalizationParams prm()
+  {
+    auto prm = Grid_t::NormalizationParams::dimensionless();
+    prm.nicell = 1;
+    return prm;
+  }
+
+  static int cellIndex(const Grid_t& grid, int iy, int iz)
+  {
+    return iz * grid.ldims[1] + iy;
+  }
+
+  // n particles of the given kind, randomly placed in cell (0, iy, iz) of
+  // patch p
+  template <typename MP>
+  void inject(MP& mprts, int iy, int iz, int kind, int n, int p = 0)
+  {
+    std::uniform_real_distribution<double> pos(0., 1.);
+    std::normal_distribution<double> mom(0., .3);
+    const auto& xb = mprts.grid().patches[p].xb;
+    auto inj = mprts.injector();
+    auto injector = inj[p];
+    for (int i = 0; i < n; i++) {
+      Double3 x = {5., xb[1] + 10. * (iy + pos(rng_)),
+                   xb[2] + 10. * (iz + pos(rng_))};
+      Double3 u = {mom(rng_) + .2, mom(rng_), mom(rng_)};
+      injector({x, u, .5 + pos(rng_), kind});
+    }
+  }
+
+  template <typename MP>
+  Moments moments(MP& mprts, int iy, int iz, int kind, int p = 0)
+  {
+    Moments m;
+    auto prts = mprts[p];
+    int cidx = cellIndex(mprts.grid(), iy, iz);
+    for (auto& prt : prts) {
+      if (prts.validCellIndex(prt) != cidx || prt.kind != kind) {
+        continue;
+      }
+      double w = prt.qni_wni;
+      m.n++;
+      m.w += w;
+      m.e += w * std::sqrt(1. + sqr(prt.u[0]) + sqr(prt.u[1]) + sqr(prt.u[2]));
+      for (int d = 0; d < 3; d++) {
+        m.x[d] += w * prt.x[d];
+        m.u[d] += w * prt.u[d];
+      }
+    }
+    return m;
+  }
+
+  // sorted, with valid cell indices
+  template <typename MP>
+  void expectSorted(MP& mprts)
+  {
+    ASSERT_TRUE(mprts.hasCellIndices());
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      auto prts = mprts[p];
+      auto& cidx = mprts.cellIndices(p);
+      ASSERT_EQ(cidx.size(), prts.size());
+      for (int n = 0; n < int(prts.size()); n++) {
+        EXPECT_EQ(cidx[n], prts.validCellIndex(prts[n]));
+        if (n > 0) {
+          EXPECT_GE(cidx[n], cidx[n - 1]);
+        }
+      }
+    }
+  }
+
+  void expectConserved(const Moments& before, const Moments& after)
+  {
+    double eps = 1e-10;
+    EXPECT_NEAR(after.w, before.w, eps * std::abs(before.w));
+    EXPECT_NEAR(after.e, before.e, eps * std::abs(before.e));
+    for (int d = 0; d < 3; d++) {
+      EXPECT_NEAR(after.x[d], before.x[d], eps * 40. * std::abs(before.w));
+      EXPECT_NEAR(after.u[d], before.u[d], eps * std::abs(before.e));
+    }
+  }
+
+  Grid_t grid_;
+  std::mt19937 rng_;
+};
+
+// ----------------------------------------------------------------------
+// MergeSplit
+
+TEST_F(ResampleTest, MergeSplit)
+{
+  Mparticles mprts{grid_};
+  inject(mprts, 1, 2, 0, 100); // to be merged
+  inject(mprts, 1, 2, 1, 10);  // in range, to be left alone
+  inject(mprts, 3, 0, 1, 3);   // to be split
+  inject(mprts, 0, 3, 0, 37);  // to be merged
+
+  SortCountsort2<Mparticles> sort;
+  sort(mprts);
+
+  auto before_e = moments(mprts, 1, 2, 0);
+  auto before_i = moments(mprts, 1, 2, 1);
+  auto before_split = moments(mprts, 3, 0, 1);
+  auto before_e2 = moments(mprts, 0, 3, 0);
+
+  Resample_<Mparticles> resample{8, 16};
+  resample(mprts);
+
+  auto after_e = moments(mprts, 1, 2, 0);
+  auto after_i = moments(mprts, 1, 2, 1);
+  auto after_split = moments(mprts, 3, 0, 1);
+  auto after_e2 = moments(mprts, 0, 3, 0);
+
+  EXPECT_EQ(after_e.n, 16);
+  expectConserved(before_e, after_e);
+  EXPECT_EQ(after_i.n, 10);
+  expectConserved(before_i, after_i);
+  EXPECT_EQ(after_split.n, 8);
+  expectConserved(before_split, after_split);
+  EXPECT_EQ(after_e2.n, 16);
+  expectConserved(before_e2, after_e2);
+
+  EXPECT_EQ(resample.nMerged(), 100 - 16 + 37 - 16);
+  EXPECT_EQ(resample.nSplit(), 8 - 3);
+  EXPECT_EQ(mprts.size(), 16 + 10 + 8 + 16);
+
+  expectSorted(mprts);
+}
+
+// ----------------------------------------------------------------------
+// InPlace
+//
+// two patches, with runs of cells that grow (so the particles get moved up
+// in the buffer) next to cells that shrink, including growth in the last
+// cell
+
+TEST_F(ResampleTest, InPlace)
+{
+  Grid_t grid{domain({1, 2, 1}), {}, kinds(), {prm()}, .1};
+  Mparticles mprts{grid};
+
+  // {iy, iz, kind, n, n after resampling}, cells are ordered by iz, then iy
+  struct Cell
+  {
+    int iy, iz, kind, n, n_new;
+  };
+  std::vector<Cell> cells[2] = {
+    {{0, 0, 0, 1, 8},
+     {1, 0, 0, 2, 8},
+     {1, 0, 1, 5, 8},
+     {0, 1, 0, 50, 16},
+     {1, 1, 1, 10, 10},
+     {0, 2, 0, 3, 8},
+     {1, 3, 0, 7, 8},
+     {1, 3, 1, 1, 8}},
+    {{1, 0, 0, 40, 16},
+     {0, 1, 1, 4, 8},
+     {1, 1, 0, 6, 8},
+     {1, 2, 0, 17, 16},
+     {0, 3, 1, 12, 12}},
+  };
+  int n_prts_new = 0;
+  for (int p = 0; p < 2; p++) {
+    for (auto& c : cells[p]) {
+      inject(mprts, c.iy, c.iz, c.kind, c.n, p);
+      n_prts_new += c.n_new;
+    }
+  }
+
+  SortCountsort2<Mparticles> sort;
+  sort(mprts);
+
+  std::vector<Moments> before[2];
+  for (int p = 0; p < 2; p++) {
+    for (auto& c : cells[p]) {
+      before[p].push_back(moments(mprts, c.iy, c.iz, c.kind, p));
+    }
+  }
+
+  Resample_<Mparticles> resample{8, 16};
+  resample(mprts);
+
+  for (int p = 0; p < 2; p++) {
+    for (int i = 0; i < int(cells[p].size()); i++) {
+      auto& c = cells[p][i];
+      auto after = moments(mprts, c.iy, c.iz, c.kind, p);
+      EXPECT_EQ(after.n, c.n_new) << "p " << p << " cell " << i;
+      expectConserved(before[p][i], after);
+    }
+  }
+  EXPECT_EQ(mprts.size(), n_prts_new);
+  expectSorted(mprts);
+}
+
+// ----------------------------------------------------------------------
+// FreshIds
+//
+// merged / split particles get new ids, the others keep theirs
+
+TEST_F(ResampleTest, FreshIds)
+{
+  using Mparticles = MparticlesSimple<ParticleWithId<double>>;
+
+  Mparticles mprts{grid_};
+  inject(mprts, 1, 2, 0, 100); // to be merged
+  inject(mprts, 1, 2, 1, 10);  // in range, to be left alone
+  inject(mprts, 3, 0, 1, 3);   // to be split
+
+  SortCountsort2<Mparticles> sort;
+  sort(mprts);
+
+  auto prts = mprts[0];
+  int cidx_kept = cellIndex(grid_, 1, 2), cidx_split = cellIndex(grid_, 3, 0);
+  std::map<psc::particle::Id, double> w_before;
+  std::set<psc::particle::Id> ids_kept;
+  for (auto& prt : prts) {
+    w_before[prt.id()] = prt.qni_wni;
+    if (prt.kind == 1 && prts.validCellIndex(prt) == cidx_kept) {
+      ids_kept.insert(prt.id());
+    }
+  }
+
+  Resample_<Mparticles> resample{8, 16};
+  resample(mprts);
+
+  std::set<psc::particle::Id> ids_after;
+  int n_new_merged = 0, n_new_split = 0;
+  for (auto& prt : prts) {
+    EXPECT_TRUE(ids_after.insert(prt.id()).second) << "duplicate id";
+    auto it = w_before.find(prt.id());
+    if (it == w_before.end()) {
+      int cidx = prts.validCellIndex(prt);
+      n_new_merged += cidx != cidx_split;
+      n_new_split += cidx == cidx_split;
+    } else {
+      // kept its id, so it should be unchanged
+      EXPECT_EQ(prt.qni_wni, it->second);
+    }
+  }
+  for (auto id : ids_kept) {
+    EXPECT_EQ(ids_after.count(id), 1);
+  }
+  EXPECT_EQ(n_new_merged, 16);
+  // the 5 new particles, and at least one original that got split
+  EXPECT_GE(n_new_split, 6);
+  EXPECT_LE(n_new_split, 8);
+}
+
+// ----------------------------------------------------------------------
+// Reproducible
+//
+// the same particles get resampled the same way, however many threads are
+// used, while different time steps use different random numbers
+
+TEST_F(ResampleTest, Reproducible)
+{
+  auto run = [&](int timestep, int n_threads = 1) {
+#ifdef _OPENMP
+    omp_set_num_threads(n_threads);
+#endif
+    Grid_t grid{domain({1, 2, 1}), {}, kinds(), {prm()}, .1};
+    grid.timestep_ = timestep;
+    Mparticles mprts{grid};
+    rng_.seed(1);
+    inject(mprts, 0, 1, 0, 40, 0);
+    inject(mprts, 1, 2, 1, 2, 1);
+    SortCountsort2<Mparticles> sort;
+    sort(mprts);
+    Resample_<Mparticles> resample{8, 16};
+    resample(mprts);
+
+    std::vector<double> vals;
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      for (auto& prt : mprts[p]) {
+        for (int d = 0; d < 3; d++) {
+          vals.push_back(prt.x[d]);
+          vals.push_back(prt.u[d]);
+        }
+      }
+    }
+    return vals;
+  };
+
+  EXPECT_EQ(run(0), run(0));
+  EXPECT_EQ(run(0), run(0, 2));
+  EXPECT_NE(run(0), run(1));
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
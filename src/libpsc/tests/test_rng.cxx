@@ -2,6 +2,7 @@
 #include <gtest/gtest.h>
 
 #include "../vpic/PscRng.h"
+#include "CounterRng.h"
 
 using Rng = PscRng;
 using RngPool = PscRngPool<Rng>;
@@ -18,6 +19,42 @@ TEST(Rng, RngPool)
   }
 }
 
+TEST(Rng, Philox4x32KnownAnswer)
+{
+  // known answer test vectors from Random123
+  auto rng0 = psc::rng::Philox4x32{0};
+  auto r0 = rng0({0, 0, 0, 0});
+  EXPECT_EQ(r0[0], 0x6627e8d5);
+  EXPECT_EQ(r0[1], 0xe169c58d);
+  EXPECT_EQ(r0[2], 0xbc57ac4c);
+  EXPECT_EQ(r0[3], 0x9b00dbd8);
+
+  auto rng1 = psc::rng::Philox4x32{0xffffffffffffffff};
+  auto r1 = rng1({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff});
+  EXPECT_EQ(r1[0], 0x408f276d);
+  EXPECT_EQ(r1[1], 0x41c83b0e);
+  EXPECT_EQ(r1[2], 0xa20bc7c6);
+  EXPECT_EQ(r1[3], 0x6d5451fd);
+}
+
+TEST(Rng, Philox4x32Uniform)
+{
+  auto rng = psc::rng::Philox4x32{1234};
+
+  const int N = 10000;
+  double sum = 0.;
+  for (uint32_t n = 0; n < N; n++) {
+    auto r = rng({n, 0, 0, 0});
+    for (int i = 0; i < 4; i++) {
+      double u = psc::rng::Philox4x32::uniform(r[i]);
+      EXPECT_GT(u, 0.);
+      EXPECT_LT(u, 1.);
+      sum += u;
+    }
+  }
+  EXPECT_NEAR(sum / (4 * N), .5, .01);
+}
+
 int main(int argc, char **argv)
 {
   MPI_Init(&argc, &argv);
@@ -0,0 +1,115 @@
+
+#include <gtest/gtest.h>
+
+#include "psc_particles_double.h"
+#include "setup_particles.hxx"
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// This test is built with OpenMP (when available), so that the threaded
+// patch loops in SetupParticles actually run in parallel.
+
+using Mparticles = MparticlesDouble;
+
+// ======================================================================
+// SetupParticlesThreadsTest
+
+struct SetupParticlesThreadsTest : ::testing::Test
+{
+  // 16 patches, so there's work for several threads
+  SetupParticlesThreadsTest()
+    : grid_{Grid_t::Domain{{1, 8, 8}, {10., 80., 80.}, {}, {1, 4, 4}},
+            {},
+            {{1., 100., "i"}, {-1., 1., "e"}},
+            {prm()},
+            .1}
+  {}
+
+  static Grid_t::NormalizationParams prm()
+  {
+    auto prm = Grid_t::NormalizationParams::dimensionless();
+    prm.nicell = 3;
+    return prm;
+  }
+
+  // a density that varies in space, and a fractional number of particles per
+  // cell, so that both the counts and the positions come from the rng
+  static void initNpt(int kind, Double3 crd, psc_particle_npt& npt)
+  {
+    npt.n = 1. + .5 * std::sin(.1 * crd[1]) * std::cos(.2 * crd[2]);
+    npt.T[0] = npt.T[1] = npt.T[2] = .01;
+    npt.p[1] = kind == 0 ? .1 : -.1;
+  }
+
+  // all particles, in storage order
+  std::vector<std::array<double, 8>> setup(int n_threads,
+                                           int* n_threads_used = nullptr)
+  {
+#ifdef _OPENMP
+    omp_set_num_threads(n_threads);
+#endif
+    Mparticles mprts{grid_};
+    SetupParticles<Mparticles> setup_particles(grid_);
+    setup_particles.fractional_n_particles_per_cell = true;
+
+    std::atomic<int> max_thread{0};
+    setup_particles(mprts, [&](int kind, Double3 crd, psc_particle_npt& npt) {
+#ifdef _OPENMP
+      int thread = omp_get_thread_num();
+      int cur = max_thread.load();
+      while (thread > cur && !max_thread.compare_exchange_weak(cur, thread)) {
+      }
+#endif
+      initNpt(kind, crd, npt);
+    });
+    if (n_threads_used) {
+      *n_threads_used = max_thread + 1;
+    }
+
+    auto n_prts_by_patch = setup_particles.partition(grid_, initNpt);
+    EXPECT_EQ(n_prts_by_patch, mprts.sizeByPatch());
+
+    std::vector<std::array<double, 8>> prts;
+    for (int p = 0; p < mprts.n_patches(); p++) {
+      for (auto& prt : mprts[p]) {
+        prts.push_back({prt.x[0], prt.x[1], prt.x[2], prt.u[0], prt.u[1],
+                        prt.u[2], prt.qni_wni, double(prt.kind)});
+      }
+    }
+    return prts;
+  }
+
+  Grid_t grid_;
+};
+
+// ----------------------------------------------------------------------
+// ThreadCountIndependent
+//
+// the same particles, in the same order, however many threads are used
+
+TEST_F(SetupParticlesThreadsTest, ThreadCountIndependent)
+{
+  auto prts1 = setup(1);
+  int n_threads_used;
+  auto prts4 = setup(4, &n_threads_used);
+#ifdef _OPENMP
+  EXPECT_GT(n_threads_used, 1);
+#endif
+  EXPECT_GT(prts1.size(), 0);
+  EXPECT_EQ(prts1, prts4);
+}
+
+int main(int argc, char** argv)
+{
+  MPI_Init(&argc, &argv);
+  ::testing::InitGoogleTest(&argc, argv);
+  int rc = RUN_ALL_TESTS();
+  MPI_Finalize();
+  return rc;
+}
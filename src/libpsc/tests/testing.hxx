@@ -80,6 +80,15 @@ using TestConfig1vbec3dSingleYZ = TestConfig<dim_yz, MfieldsSingle,
 using TestConfig1vbec3dSingleXZ = TestConfig<dim_xz, MfieldsSingle,
 					     PushParticlesVb<Config1vbecSplit<MparticlesSingle, MfieldsStateSingle, dim_xz>>,
 					     checks_order_1st>;
+using TestConfig1vbec3dSingleAcc = TestConfig<dim_xyz, MfieldsSingle,
+					      PushParticlesVb<Config1vbecSplitAccumulate<MparticlesSingle, MfieldsStateSingle, dim_xyz>>,
+					      checks_order_1st>;
+using TestConfig1vbec3dSingleYZAcc = TestConfig<dim_yz, MfieldsSingle,
+						PushParticlesVb<Config1vbecSplitAccumulate<MparticlesSingle, MfieldsStateSingle, dim_yz>>,
+						checks_order_1st>;
+using TestConfig1vbec3dSingleXZAcc = TestConfig<dim_xz, MfieldsSingle,
+						PushParticlesVb<Config1vbecSplitAccumulate<MparticlesSingle, MfieldsStateSingle, dim_xz>>,
+						checks_order_1st>;
 
 using VpicConfig = VpicConfigPsc;
 
@@ -10,7 +10,7 @@ vpic_simulation* simulation; // FIXME, never initialized, just a hack to make th
 // ----------------------------------------------------------------------
 // vpic_base_init
 
-void vpic_base_init(int *pargc, char ***pargv)
+void vpic_base_init(int *pargc, char ***pargv, bool thread_multiple)
 {
   static bool vpic_base_inited = false;
 
@@ -33,7 +33,12 @@ void vpic_base_init(int *pargc, char ***pargv)
     
     boot_mp( pargc, pargv );
 #else
-    MPI_Init(pargc, pargv);
+    if (thread_multiple) {
+      int provided;
+      MPI_Init_thread(pargc, pargv, MPI_THREAD_MULTIPLE, &provided);
+    } else {
+      MPI_Init(pargc, pargv);
+    }
 #endif
     
     MPI_Comm_dup(MPI_COMM_WORLD, &psc_comm_world);
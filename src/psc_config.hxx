@@ -6,6 +6,7 @@
 #include "psc_fields_c.h"
 
 #include "../libpsc/psc_sort/psc_sort_impl.hxx"
+#include "../libpsc/psc_resample/psc_resample_impl.hxx"
 #include "../libpsc/psc_collision/psc_collision_impl.hxx"
 #include "../libpsc/psc_push_particles/1vb/psc_push_particles_1vb.h"
 #include "psc_push_fields_impl.hxx"
@@ -86,6 +87,7 @@ struct PscConfig_
   using PushParticles = typename ConfigPushp::PushParticles;
   using checks_order = typename PushParticles::checks_order;
   using Sort = SortCountsort2<Mparticles>;
+  using Resample = Resample_<Mparticles>;
   using Collision = Collision_<Mparticles, MfieldsState, Mfields>;
   using PushFields = ::PushFields<MfieldsState>;
   using BndParticles = BndParticles_<Mparticles>;
@@ -110,6 +112,7 @@ struct PscConfig_<_Dim, _Mparticles, _MfieldsState, _Mfields, PscConfigPushParti
   using Mfields = _Mfields;
   using PushParticles = PushParticlesCuda<CudaConfig1vbec3d<Dim, BS>>;
   using Sort = SortCuda<BS>;
+  using Resample = ResampleNone;
   using Collision = CollisionCuda<Mparticles>;
   using PushFields = PushFieldsCuda;
   using BndParticles = BndParticlesCuda<Mparticles, Dim>;
@@ -131,6 +134,7 @@ struct PscConfig_<dim_xyz, _Mparticles, _MfieldsState, _Mfields, PscConfigPushPa
   using Mfields = _Mfields;
   using PushParticles = PushParticlesCuda<CudaConfig1vbec3dGmem<Dim, BS>>;
   using Sort = SortCuda<BS>;
+  using Resample = ResampleNone;
   using Collision = CollisionCuda<Mparticles>;
   using PushFields = PushFieldsCuda;
   using BndParticles = BndParticlesCuda<Mparticles, Dim>;
@@ -194,6 +198,7 @@ struct PscConfigVpicWrap
 
   using Balance = Balance_<MparticlesSingle, MfieldsStateSingle, MfieldsSingle>;
   using Sort = SortVpicWrap<Mparticles>;
+  using Resample = ResampleNone;
   using Collision = PscCollisionVpic;
   using PushParticles = PushParticlesVpic<Mparticles, MfieldsState,
 					    typename VpicConfig::ParticlesOps,
@@ -231,6 +236,7 @@ struct PscConfigVpicPsc
   
   using Balance = Balance_<MparticlesSingle, MfieldsStateSingle, MfieldsSingle>;
   using Sort = SortVpic<Mparticles>;
+  using Resample = ResampleNone;
   using Collision = PscCollisionVpic;
   using PushParticles = PushParticlesVpic<Mparticles, MfieldsState,
 					    typename VpicConfig::ParticlesOps,
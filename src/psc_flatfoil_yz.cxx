@@ -399,7 +399,15 @@ void run()
   int oute_interval = 100;
   DiagEnergies oute{grid.comm(), oute_interval};
 
-  auto diagnostics = makeDiagnosticsDefault(outf, outp, oute);
+  // -- distribution function: energy spectra per kind
+  DiagDistributionParams distf_params{};
+  distf_params.every_step = 0;
+  distf_params.basename = "spectrum";
+  distf_params.axes = {{DiagDistributionAxis::KIND},
+                       {DiagDistributionAxis::GAMMA_M1, 100, 1e-4, 10., true}};
+  DiagDistribution distf{grid, grid.comm(), distf_params};
+
+  auto diagnostics = makeDiagnosticsDefault(outf, outp, oute, distf);
 
   // ----------------------------------------------------------------------
   // Set up objects specific to the flatfoil case
@@ -0,0 +1,533 @@
+#include <psc.hxx>
+#include <setup_fields.hxx>
+#include <setup_particles.hxx>
+
+#include "OutputFieldsDefault.h"
+#include "PatchAffinity.h"
+#include "psc_config.hxx"
+
+#include <cstdio>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+// ======================================================================
+// Scaling mini-app
+//
+// Runs a uniform thermal plasma (no physics to speak of) on a domain that is
+// sized from the command line, and writes a machine-readable report of how
+// much time each phase of the time step took, as min / avg / max over ranks.
+//
+// Weak scaling (the default): each rank gets --patches_per_rank patches of
+// --cells_per_patch^d cells, so the domain grows with the number of ranks.
+// Strong scaling (--strong): the global domain is fixed at --global_cells^d
+// cells, and is divided into n_ranks * --patches_per_rank patches.
+//
+// Other options:
+//   --ppc                 particles per cell per species
+//   --n_steps             number of steps to time
+//   --n_warmup            number of steps to run before timing starts
+//   --sort_interval       sort every so many steps (0: never)
+//   --collision_interval  collide every so many steps (0: never)
+//   --output_interval     write fields every so many steps (0: never)
+//   --output_coarsen      write the fields block-averaged over this many
+//                         cells in each direction, rather than at full
+//                         resolution
+//   --report              report file name
+//   --report_format       "json" (overwrites the report) or "csv" (appends
+//                         one row per phase, so a sweep can be collected
+//                         into a single file)
+//   --label               free-form tag, e.g., to tell builds apart
+//
+// e.g.
+//   opts="--report scaling.csv --report_format csv"
+//   for ppc in 25 100 400; do
+//     mpirun -n 8 ./psc_scaling --ppc $ppc $opts
+//   done
+
+// ======================================================================
+// PSC configuration
+//
+// EDIT to change order / floating point type / cuda / 2d/3d
+
+using Dim = dim_yz;
+using PscConfig = PscConfig1vbecSingle<Dim>;
+
+// ----------------------------------------------------------------------
+
+using MfieldsState = PscConfig::MfieldsState;
+using Mparticles = PscConfig::Mparticles;
+using Balance = PscConfig::Balance;
+using Collision = PscConfig::Collision;
+using Checks = PscConfig::Checks;
+using Marder = PscConfig::Marder;
+
+// ======================================================================
+// PscScalingParams
+
+struct PscScalingParams
+{
+  bool strong = false;
+  int cells_per_patch = 32;
+  int global_cells = 256;
+  int patches_per_rank = 4;
+  int ppc = 100;
+  int n_steps = 100;
+  int n_warmup = 10;
+  int sort_interval = 10;
+  int collision_interval = 10;
+  int output_interval = 0;
+  int output_coarsen = 1;
+  const char* report = "psc_scaling.json";
+  const char* report_format = "json";
+  const char* label = "";
+
+  // calculated from the above
+  Int3 gdims;
+  Int3 np;
+};
+
+namespace
+{
+
+PscScalingParams g;
+
+PscParams psc_params;
+
+// ======================================================================
+// Phases
+//
+// What gets reported, and the profiling timer that measures it. Apart from
+// "output", these are the timers in Psc::step_psc().
+
+struct Phase
+{
+  const char* name;
+  const char* timer;
+};
+
+const Phase phases[] = {
+  {"push", "step_push_prts"}, {"push_flds", "step_push_flds"},
+  {"sort", "step_sort"},      {"bnd_prts", "step_bnd_prts"},
+  {"bnd_flds", "step_bnd_flds"}, {"collisions", "step_collision"},
+  {"output", "scaling_output"},
+};
+const int n_phases = sizeof(phases) / sizeof(phases[0]);
+
+// ======================================================================
+// PhaseTimes
+//
+// snapshot of the accumulated time (s) / number of calls of each phase, so
+// that the warm-up steps can be subtracted out
+
+struct PhaseTimes
+{
+  double time[n_phases] = {};
+  int cnt[n_phases] = {};
+  double wall = 0.;
+
+  static PhaseTimes now()
+  {
+    PhaseTimes t;
+    for (int i = 0; i < n_phases; i++) {
+      int pr = prof_find(phases[i].timer);
+      if (pr) {
+        t.time[i] = prof_globals.info[pr - 1].time / 1e6;
+        t.cnt[i] = prof_globals.info[pr - 1].cnt;
+      }
+    }
+    t.wall = MPI_Wtime();
+    return t;
+  }
+};
+
+PhaseTimes start_times;
+
+} // namespace
+
+// ======================================================================
+// ScalingDiagnostics
+//
+// field output (if any), timed as its own phase, and taking the snapshot
+// that marks the end of the warm-up
+
+class ScalingDiagnostics
+{
+public:
+  ScalingDiagnostics(OutputFields& outf) : outf_{outf}
+  {
+    pr_ = prof_register("scaling_output", 1., 0, 0);
+  }
+
+  void operator()(Mparticles& mprts, MfieldsState& mflds)
+  {
+    prof_start(pr_);
+    outf_(mflds, mprts);
+    prof_stop(pr_);
+
+    // (with no warm-up, the zero-initialized start_times are right, as
+    // the timers get reset after the initial diagnostics)
+    if (g.n_warmup > 0 && mprts.grid().timestep() == g.n_warmup) {
+      start_times = PhaseTimes::now();
+    }
+  }
+
+private:
+  OutputFields& outf_;
+  int pr_;
+};
+
+// ======================================================================
+// setupParameters
+
+void setupParameters()
+{
+  mrc_params_get_option_bool_help("strong", &g.strong,
+                                  "strong scaling (fixed global domain)");
+  mrc_params_get_option_int_help("cells_per_patch", &g.cells_per_patch,
+                                 "cells per direction per patch (weak)");
+  mrc_params_get_option_int_help("global_cells", &g.global_cells,
+                                 "global cells per direction (strong)");
+  mrc_params_get_option_int_help("patches_per_rank", &g.patches_per_rank,
+                                 "number of patches per rank");
+  mrc_params_get_option_int_help("ppc", &g.ppc,
+                                 "particles per cell per species");
+  mrc_params_get_option_int_help("n_steps", &g.n_steps,
+                                 "number of steps to time");
+  mrc_params_get_option_int_help("n_warmup", &g.n_warmup,
+                                 "number of untimed steps to run first");
+  mrc_params_get_option_int_help("sort_interval", &g.sort_interval,
+                                 "sort every so many steps");
+  mrc_params_get_option_int_help("collision_interval", &g.collision_interval,
+                                 "collide every so many steps");
+  mrc_params_get_option_int_help("output_interval", &g.output_interval,
+                                 "write fields every so many steps");
+  mrc_params_get_option_int_help("output_coarsen", &g.output_coarsen,
+                                 "coarsen field output by this factor");
+  mrc_params_get_option_string_help("report", &g.report, "report file name");
+  mrc_params_get_option_string_help("report_format", &g.report_format,
+                                    "json or csv");
+  mrc_params_get_option_string_help("label", &g.label,
+                                    "tag to identify this run in the report");
+
+  std::string format = g.report_format;
+  if (format != "json" && format != "csv") {
+    mprintf("ERROR: unknown report_format '%s'\n", g.report_format);
+    abort();
+  }
+
+  // -- divide the patches as evenly as possible among the non-invariant
+  // directions
+  int n_ranks;
+  MPI_Comm_size(MPI_COMM_WORLD, &n_ranks);
+  int n_patches = n_ranks * g.patches_per_rank;
+
+  Int3 invar = {Dim::InvarX::value, Dim::InvarY::value, Dim::InvarZ::value};
+  int dims[3] = {}, n_dims = 0;
+  for (int d = 0; d < 3; d++) {
+    n_dims += !invar[d];
+  }
+  MPI_Dims_create(n_patches, n_dims, dims);
+
+  for (int d = 0, i = 0; d < 3; d++) {
+    if (invar[d]) {
+      g.np[d] = 1;
+      g.gdims[d] = 1;
+      continue;
+    }
+    g.np[d] = dims[i++];
+    if (g.strong) {
+      if (g.global_cells % g.np[d] != 0) {
+        mprintf("ERROR: global_cells %d not divisible into %d patches\n",
+                g.global_cells, g.np[d]);
+        abort();
+      }
+      g.gdims[d] = g.global_cells;
+    } else {
+      g.gdims[d] = g.np[d] * g.cells_per_patch;
+    }
+  }
+
+  psc_params.nmax = g.n_warmup + g.n_steps;
+  psc_params.cfl = .75;
+  psc_params.sort_interval = g.sort_interval;
+  // print_status() resets the timers, so don't let it run until the end
+  psc_params.stats_every = psc_params.nmax + 1;
+
+  mpi_printf(MPI_COMM_WORLD,
+             "psc_scaling: %s scaling, %d ranks, gdims %d x %d x %d, "
+             "np %d x %d x %d, ppc %d\n",
+             g.strong ? "strong" : "weak", n_ranks, g.gdims[0], g.gdims[1],
+             g.gdims[2], g.np[0], g.np[1], g.np[2], g.ppc);
+}
+
+// ======================================================================
+// setupGrid
+
+Grid_t* setupGrid()
+{
+  Grid_t::Kinds kinds(NR_KINDS);
+  kinds[KIND_ELECTRON] = {-1., 1., "e"};
+  kinds[KIND_ION] = {1., 100., "i"};
+
+  // one cell is one Debye length
+  auto domain = Grid_t::Domain{g.gdims, Vec3<double>(g.gdims), {}, g.np};
+
+  auto bc =
+    psc::grid::BC{{BND_FLD_PERIODIC, BND_FLD_PERIODIC, BND_FLD_PERIODIC},
+                  {BND_FLD_PERIODIC, BND_FLD_PERIODIC, BND_FLD_PERIODIC},
+                  {BND_PRT_PERIODIC, BND_PRT_PERIODIC, BND_PRT_PERIODIC},
+                  {BND_PRT_PERIODIC, BND_PRT_PERIODIC, BND_PRT_PERIODIC}};
+
+  auto norm_params = Grid_t::NormalizationParams::dimensionless();
+  norm_params.nicell = g.ppc;
+
+  double dt = psc_params.cfl * courant_length(domain);
+  Grid_t::Normalization norm{norm_params};
+
+  Int3 ibn = {2, 2, 2};
+  for (int d = 0; d < 3; d++) {
+    if (domain.isInvar(d)) {
+      ibn[d] = 0;
+    }
+  }
+
+  return new Grid_t{domain, bc, kinds, norm, dt, -1, ibn};
+}
+
+// ======================================================================
+// initializeParticles
+
+void initializeParticles(Balance& balance, Grid_t*& grid_ptr, Mparticles& mprts)
+{
+  SetupParticles<Mparticles> setup_particles(*grid_ptr);
+
+  partitionAndSetupParticles(setup_particles, balance, grid_ptr, mprts,
+                             [&](int kind, double crd[3], psc_particle_npt& npt) {
+                               npt.n = 1.;
+                               double T = kind == KIND_ELECTRON ? .01 : .001;
+                               npt.T[0] = npt.T[1] = npt.T[2] = T;
+                             });
+}
+
+// ======================================================================
+// jsonString
+//
+// s as a quoted JSON string
+
+std::string jsonString(const char* s)
+{
+  std::string out = "\"";
+  for (; *s; s++) {
+    unsigned char c = *s;
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (c < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += c;
+    }
+  }
+  return out + "\"";
+}
+
+// ======================================================================
+// csvField
+//
+// s as a CSV field, quoted if needed
+
+std::string csvField(const char* s)
+{
+  std::string str = s;
+  if (str.find_first_of(",\"\r\n") == std::string::npos) {
+    return str;
+  }
+  std::string out = "\"";
+  for (char c : str) {
+    if (c == '"') {
+      out += '"';
+    }
+    out += c;
+  }
+  return out + "\"";
+}
+
+// ======================================================================
+// writeReport
+//
+// reduces the per-rank time spent in each phase, and writes it (on rank 0)
+// as seconds per step
+
+void writeReport(const Grid_t& grid, const PhaseTimes& start,
+                 const PhaseTimes& end, size_t n_prts)
+{
+  MPI_Comm comm = grid.comm();
+  int rank, n_ranks;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &n_ranks);
+
+  // the phases, followed by the whole step
+  const int n = n_phases + 1;
+  double t[n], t_min[n], t_max[n], t_sum[n];
+  for (int i = 0; i < n_phases; i++) {
+    t[i] = (end.time[i] - start.time[i]) / g.n_steps;
+  }
+  t[n_phases] = (end.wall - start.wall) / g.n_steps;
+
+  MPI_Reduce(t, t_min, n, MPI_DOUBLE, MPI_MIN, 0, comm);
+  MPI_Reduce(t, t_max, n, MPI_DOUBLE, MPI_MAX, 0, comm);
+  MPI_Reduce(t, t_sum, n, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+  unsigned long long n_prts_local = n_prts, n_prts_total;
+  MPI_Reduce(&n_prts_local, &n_prts_total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+             0, comm);
+
+  if (rank != 0) {
+    return;
+  }
+
+  int n_threads = psc::numa::nThreads();
+  // particles pushed per second, as limited by the slowest rank
+  double prts_per_sec = n_prts_total / t_max[n_phases];
+  std::string format = g.report_format;
+
+  if (format == "json") {
+    FILE* f = fopen(g.report, "w");
+    if (!f) {
+      perror(g.report);
+      return;
+    }
+    fprintf(f, "{\n");
+    fprintf(f, "  \"label\": %s,\n", jsonString(g.label).c_str());
+    fprintf(f, "  \"scaling\": \"%s\",\n", g.strong ? "strong" : "weak");
+    fprintf(f, "  \"n_ranks\": %d,\n", n_ranks);
+    fprintf(f, "  \"n_threads\": %d,\n", n_threads);
+    fprintf(f, "  \"gdims\": [%d, %d, %d],\n", g.gdims[0], g.gdims[1],
+            g.gdims[2]);
+    fprintf(f, "  \"np\": [%d, %d, %d],\n", g.np[0], g.np[1], g.np[2]);
+    fprintf(f, "  \"patches_per_rank\": %d,\n", g.patches_per_rank);
+    fprintf(f, "  \"ppc\": %d,\n", g.ppc);
+    fprintf(f, "  \"n_steps\": %d,\n", g.n_steps);
+    fprintf(f, "  \"n_warmup\": %d,\n", g.n_warmup);
+    fprintf(f, "  \"n_particles\": %llu,\n", n_prts_total);
+    fprintf(f, "  \"particles_per_second\": %g,\n", prts_per_sec);
+    fprintf(f, "  \"phases\": {\n");
+    for (int i = 0; i < n; i++) {
+      fprintf(f,
+              "    \"%s\": {\"calls\": %d, \"min\": %g, \"avg\": %g, "
+              "\"max\": %g}%s\n",
+              i < n_phases ? phases[i].name : "step",
+              i < n_phases ? end.cnt[i] - start.cnt[i] : g.n_steps, t_min[i],
+              t_sum[i] / n_ranks, t_max[i], i < n - 1 ? "," : "");
+    }
+    fprintf(f, "  }\n");
+    fprintf(f, "}\n");
+    fclose(f);
+  } else {
+    struct stat st;
+    bool have_header = stat(g.report, &st) == 0 && st.st_size > 0;
+    FILE* f = fopen(g.report, "a");
+    if (!f) {
+      perror(g.report);
+      return;
+    }
+    if (!have_header) {
+      fprintf(f, "label,scaling,n_ranks,n_threads,gdims_x,gdims_y,gdims_z,"
+                 "patches_per_rank,ppc,n_steps,n_particles,phase,calls,"
+                 "min,avg,max\n");
+    }
+    for (int i = 0; i < n; i++) {
+      fprintf(f, "%s,%s,%d,%d,%d,%d,%d,%d,%d,%d,%llu,%s,%d,%g,%g,%g\n",
+              csvField(g.label).c_str(), g.strong ? "strong" : "weak",
+              n_ranks, n_threads,
+              g.gdims[0], g.gdims[1], g.gdims[2], g.patches_per_rank, g.ppc,
+              g.n_steps, n_prts_total, i < n_phases ? phases[i].name : "step",
+              i < n_phases ? end.cnt[i] - start.cnt[i] : g.n_steps, t_min[i],
+              t_sum[i] / n_ranks, t_max[i]);
+    }
+    fclose(f);
+  }
+
+  printf("psc_scaling: %g s/step (max over ranks), %g particles/s, report "
+         "written to %s\n",
+         t_max[n_phases], prts_per_sec, g.report);
+}
+
+// ======================================================================
+// run
+
+void run()
+{
+  auto comm = MPI_COMM_WORLD;
+
+  mpi_printf(comm, "*** Setting up...\n");
+
+  setupParameters();
+
+  // ----------------------------------------------------------------------
+  // Set up grid, state fields, particles
+
+  auto grid_ptr = setupGrid();
+  auto& grid = *grid_ptr;
+
+  MfieldsState mflds{grid};
+  Mparticles mprts{grid};
+
+  // ----------------------------------------------------------------------
+  // Set up various objects needed to run this case
+
+  psc_params.balance_interval = 0;
+  Balance balance{psc_params.balance_interval};
+
+  Collision collision{grid, g.collision_interval, .1};
+
+  ChecksParams checks_params{};
+  Checks checks{grid, comm, checks_params};
+
+  psc_params.marder_interval = 0;
+  Marder marder(grid, .9, 3, false);
+
+  OutputFieldsParams outf_params{};
+  outf_params.pfield_step = g.output_interval;
+  if (g.output_coarsen > 1) {
+    int c = g.output_coarsen;
+    outf_params.views = {{"coarse", {c, c, c}}};
+  }
+  OutputFields outf{grid, outf_params};
+
+  ScalingDiagnostics diagnostics{outf};
+
+  // ----------------------------------------------------------------------
+  // setup initial conditions
+
+  initializeParticles(balance, grid_ptr, mprts);
+
+  // ----------------------------------------------------------------------
+  // run, and time it
+
+  auto psc =
+    makePscIntegrator<PscConfig>(psc_params, *grid_ptr, mflds, mprts, balance,
+                                 collision, checks, marder, diagnostics);
+  if (g.n_warmup == 0) {
+    start_times.wall = MPI_Wtime();
+  }
+  psc.integrate();
+
+  writeReport(grid, start_times, PhaseTimes::now(), mprts.size());
+}
+
+// ======================================================================
+// main
+
+int main(int argc, char** argv)
+{
+  psc_init(argc, argv);
+
+  run();
+
+  psc_finalize();
+  return 0;
+}